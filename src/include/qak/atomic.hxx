@@ -29,14 +29,30 @@
 //		The standard <atomic> header defines free functions for atomic operations which are not included here.
 //		The standard <atomic> header defines an atomic<bool> specialization which is not defined here.
 //
+//		Class types must be exactly 1, 2, 4, or 8 bytes with no padding. There's no 16-byte form; for a pointer and
+//		a counter updated together, see qak/tagged_ptr.hxx.
+//
 
 #ifndef qak_atomic_hxx_INCLUDED_
 #define qak_atomic_hxx_INCLUDED_
 
 #include "qak/config.hxx"
 
-#include <type_traits> // is_integral, enable_if, is_trivially_copy_constructible
+#include <type_traits> // is_integral, enable_if, is_trivially_copyable
 #include <cstdint> // std::uintN_t
+#include <cstring> // std::memcpy
+
+//	QAK_ATOMIC_INLINE selects whether the operations of azi_stor, which underlies qak::atomic, are defined inline in
+//	this header using the __atomic builtins, or out-of-line in atomic.cxx where they are explicitly instantiated.
+//	Inline is the default where the compiler has the builtins. Every translation unit must agree, so set it from the
+//	build (the QAK_ATOMIC_OUT_OF_LINE CMake option).
+#if !defined(QAK_ATOMIC_INLINE)
+#	if QAK_HAS_GNUC_ATOMIC_BUILTINS
+#		define QAK_ATOMIC_INLINE 1
+#	else
+#		define QAK_ATOMIC_INLINE 0
+#	endif
+#endif
 
 #if defined(_MSC_VER)
 #	pragma warning(push)
@@ -89,8 +105,12 @@ namespace atomic_imp_ns_ { //===================================================
 		typedef typename repr_type_of_size<N>::type repr_type;
 		repr_type repr_;
 
+#if QAK_ATOMIC_INLINE
+		constexpr explicit azi_stor(repr_type val) : repr_(val) { }
+#else
 		explicit azi_stor(repr_type val);
 		~azi_stor();
+#endif
 
 		repr_type load(memory_order mo) const QAK_noexcept;
 		void store(repr_type val, memory_order mo) QAK_noexcept;
@@ -99,6 +119,12 @@ namespace atomic_imp_ns_ { //===================================================
 		repr_type postincrement() QAK_noexcept;
 		repr_type postdecrement() QAK_noexcept;
 
+		repr_type fetch_add(repr_type val, memory_order mo) QAK_noexcept;
+		repr_type fetch_sub(repr_type val, memory_order mo) QAK_noexcept;
+		repr_type fetch_and(repr_type val, memory_order mo) QAK_noexcept;
+		repr_type fetch_or(repr_type val, memory_order mo) QAK_noexcept;
+		repr_type fetch_xor(repr_type val, memory_order mo) QAK_noexcept;
+
 		repr_type exchange(repr_type val, memory_order mo) QAK_noexcept;
 		bool compare_exchange_weak(repr_type & exp, repr_type des, memory_order mo) QAK_noexcept;
 		bool compare_exchange_weak(repr_type & exp, repr_type des, memory_order moS, memory_order moF) QAK_noexcept;
@@ -106,6 +132,122 @@ namespace atomic_imp_ns_ { //===================================================
 		bool compare_exchange_strong(repr_type & exp, repr_type des, memory_order moS, memory_order moF) QAK_noexcept;
 	};
 
+#if QAK_ATOMIC_INLINE
+
+	//	The qak::memory_order enumerators have the same values as the __ATOMIC_* constants.
+	static_assert(int(memory_order::relaxed) == __ATOMIC_RELAXED, "");
+	static_assert(int(memory_order::consume) == __ATOMIC_CONSUME, "");
+	static_assert(int(memory_order::acquire) == __ATOMIC_ACQUIRE, "");
+	static_assert(int(memory_order::release) == __ATOMIC_RELEASE, "");
+	static_assert(int(memory_order::acq_rel) == __ATOMIC_ACQ_REL, "");
+	static_assert(int(memory_order::seq_cst) == __ATOMIC_SEQ_CST, "");
+
+	//	The failure ordering implied for a compare_exchange given a single ordering, as with std::atomic.
+	constexpr int cas_failure_order(memory_order mo)
+	{
+		return mo == memory_order::acq_rel ? __ATOMIC_ACQUIRE
+		     : mo == memory_order::release ? __ATOMIC_RELAXED
+		     : int(mo);
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::load(memory_order mo) const QAK_noexcept
+	{
+		return __atomic_load_n(&repr_, int(mo));
+	}
+
+	template <int N> inline
+	void azi_stor<N>::store(repr_type val, memory_order mo) QAK_noexcept
+	{
+		__atomic_store_n(&repr_, val, int(mo));
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::preincrement() QAK_noexcept
+	{
+		return __atomic_add_fetch(&repr_, 1, __ATOMIC_SEQ_CST);
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::predecrement() QAK_noexcept
+	{
+		return __atomic_sub_fetch(&repr_, 1, __ATOMIC_SEQ_CST);
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::postincrement() QAK_noexcept
+	{
+		return __atomic_fetch_add(&repr_, 1, __ATOMIC_SEQ_CST);
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::postdecrement() QAK_noexcept
+	{
+		return __atomic_fetch_sub(&repr_, 1, __ATOMIC_SEQ_CST);
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::fetch_add(repr_type val, memory_order mo) QAK_noexcept
+	{
+		return __atomic_fetch_add(&repr_, val, int(mo));
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::fetch_sub(repr_type val, memory_order mo) QAK_noexcept
+	{
+		return __atomic_fetch_sub(&repr_, val, int(mo));
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::fetch_and(repr_type val, memory_order mo) QAK_noexcept
+	{
+		return __atomic_fetch_and(&repr_, val, int(mo));
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::fetch_or(repr_type val, memory_order mo) QAK_noexcept
+	{
+		return __atomic_fetch_or(&repr_, val, int(mo));
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::fetch_xor(repr_type val, memory_order mo) QAK_noexcept
+	{
+		return __atomic_fetch_xor(&repr_, val, int(mo));
+	}
+
+	template <int N> inline
+	typename azi_stor<N>::repr_type azi_stor<N>::exchange(repr_type val, memory_order mo) QAK_noexcept
+	{
+		return __atomic_exchange_n(&repr_, val, int(mo));
+	}
+
+	template <int N> inline
+	bool azi_stor<N>::compare_exchange_weak(repr_type & exp, repr_type des, memory_order mo) QAK_noexcept
+	{
+		return __atomic_compare_exchange_n(&repr_, &exp, des, true, int(mo), cas_failure_order(mo));
+	}
+
+	template <int N> inline
+	bool azi_stor<N>::compare_exchange_weak(repr_type & exp, repr_type des, memory_order moS, memory_order moF) QAK_noexcept
+	{
+		return __atomic_compare_exchange_n(&repr_, &exp, des, true, int(moS), int(moF));
+	}
+
+	template <int N> inline
+	bool azi_stor<N>::compare_exchange_strong(repr_type & exp, repr_type des, memory_order mo) QAK_noexcept
+	{
+		return __atomic_compare_exchange_n(&repr_, &exp, des, false, int(mo), cas_failure_order(mo));
+	}
+
+	template <int N> inline
+	bool azi_stor<N>::compare_exchange_strong(repr_type & exp, repr_type des, memory_order moS, memory_order moF) QAK_noexcept
+	{
+		return __atomic_compare_exchange_n(&repr_, &exp, des, false, int(moS), int(moF));
+	}
+
+#else // of if QAK_ATOMIC_INLINE
+
 #if QAK_MINIMUM_ATOMIC_ALIGNMENT == 1
 	extern template struct azi_stor<1>;
 #endif
@@ -119,6 +261,31 @@ namespace atomic_imp_ns_ { //===================================================
 	extern template struct azi_stor<8>;
 #endif
 
+#endif // of else of if QAK_ATOMIC_INLINE
+
+	//	Wait and notify, for all sizes, in atomic.cxx. wait_imp blocks until notified, the deadline (a wallclock_ns
+	//	reading) passes, or it sees that the n bytes at p no longer hold old. It may also return spuriously. It returns
+	//	false iff the deadline passed.
+	std::uint64_t const no_deadline = ~std::uint64_t(0);
+	bool wait_imp(void const * p, int n, std::uint64_t old, std::uint64_t deadline_ns) QAK_noexcept;
+	void notify_imp(void const * p, int n, bool all) QAK_noexcept;
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	std::bit_cast, which is C++20. Without the builtin, To must be default constructible.
+	template <class To, class From> inline
+	To bit_cast(From const & from) QAK_noexcept
+	{
+		static_assert(sizeof(To) == sizeof(From), "");
+#if QAK_HAS_BUILTIN_BIT_CAST
+		return __builtin_bit_cast(To, from);
+#else
+		To to;
+		std::memcpy(&to, &from, sizeof(To));
+		return to;
+#endif
+	}
+
 	//-----------------------------------------------------------------------------------------------------------------|
 
 	//	Converts return types from repr_type
@@ -142,6 +309,23 @@ namespace atomic_imp_ns_ { //===================================================
 		}
 	};
 
+	//	Enums go by way of their underlying type.
+	template <class T> struct load_converter<T, typename std::enable_if<std::is_enum<T>::value>::type>
+	{
+		template <class U> T operator()(U val) {
+			static_assert(sizeof(T) <= sizeof(U), "");
+			return static_cast<T>(static_cast<typename std::underlying_type<T>::type>(val));
+		}
+	};
+
+	//	Class types are copied bit for bit.
+	template <class T> struct load_converter<T, typename std::enable_if<std::is_class<T>::value>::type>
+	{
+		template <class U> T operator()(U val) {
+			return bit_cast<T>(val);
+		}
+	};
+
 	//-----------------------------------------------------------------------------------------------------------------|
 
 	//	Converts T to repr_type
@@ -150,7 +334,7 @@ namespace atomic_imp_ns_ { //===================================================
 	//	Integral types can use a static_cast.
 	template <class T> struct store_converter<T, typename std::enable_if<std::is_integral<T>::value>::type>
 	{
-		template <class U> T operator()(U val) {
+		template <class U> constexpr T operator()(U val) {
 			static_assert(sizeof(T) == sizeof(U), "");
 			return static_cast<T>(val);
 		}
@@ -170,6 +354,26 @@ namespace atomic_imp_ns_ { //===================================================
 		}
 	};
 
+	//	Enums can use a static_cast.
+	template <class T> struct store_converter<T, typename std::enable_if<std::is_enum<T>::value>::type>
+	{
+		typedef typename repr_type_of<T>::type repr_type;
+
+		constexpr repr_type operator()(T val) {
+			return static_cast<repr_type>(val);
+		}
+	};
+
+	//	Class types are copied bit for bit.
+	template <class T> struct store_converter<T, typename std::enable_if<std::is_class<T>::value>::type>
+	{
+		typedef typename repr_type_of<T>::type repr_type;
+
+		repr_type operator()(T const & val) {
+			return bit_cast<repr_type>(val);
+		}
+	};
+
 } // namespace atomic_imp_ns_ =========================================================================================|
 
 	//	An atomic type inspired by std::atomic<>.
@@ -179,16 +383,22 @@ namespace atomic_imp_ns_ { //===================================================
 	template <class T>
 	struct atomic_base
 	{
-	private:
+	protected:
 		typedef atomic_imp_ns_::repr_type_of<T> repr_props_type;
 
 		typedef typename repr_props_type::type repr_type;
 		typedef typename atomic_imp_ns_::azi_stor<repr_props_type::N> stor_type;
 
-		static_assert(std::is_integral<T>::value || std::is_pointer<T>::value, "expecting an integral or pointer type.");
-		static_assert(std::is_trivially_copy_constructible<T>::value, "requires a trivially copyable type.");
+		static_assert(   std::is_integral<T>::value || std::is_pointer<T>::value
+		              || std::is_enum<T>::value || std::is_class<T>::value,
+		              "expecting an integral, pointer, enum, or class type.");
+		static_assert(std::is_trivially_copyable<T>::value, "requires a trivially copyable type.");
 		static_assert(sizeof(T) <= 8, "Only 1, 2, 4, or 8 byte objects are supported for atomics.");
 		static_assert(sizeof(T) <= sizeof(repr_type), "");
+		static_assert(!std::is_class<T>::value || sizeof(T) == sizeof(repr_type),
+		              "A class type must be exactly the size of the representation.");
+		static_assert(!std::is_class<T>::value || std::has_unique_object_representations<T>::value,
+		              "A class type must not have padding, since compare_exchange compares representations.");
 #if !QAK_COMPILER_FAILS_ALIGNOF_OPERATOR // compiler supports alignof operator
 		static_assert(alignof(T) <= alignof(repr_type), "");
 #else // workaround for compilers that don't support alignof operator yet
@@ -201,7 +411,7 @@ namespace atomic_imp_ns_ { //===================================================
 
 		atomic_base() QAK_noexcept : stor_(static_cast<repr_type>(0)) { }
 
-		constexpr atomic_base(T t_in) QAK_noexcept : stor_(static_cast<repr_type>(t_in)) { }
+		constexpr atomic_base(T t_in) QAK_noexcept : stor_(atomic_imp_ns_::store_converter<T>()(t_in)) { }
 
 #if !QAK_COMPILER_FAILS_DELETED_MEMBERS // supports "= delete" syntax
 
@@ -279,17 +489,31 @@ namespace atomic_imp_ns_ { //===================================================
 			return b;
 		}
 
-		// (std::atomic) integral fetch_add(integral, memory_order = memory_order_seq_cst) QAK_noexcept;
-		// (std::atomic) integral fetch_sub(integral, memory_order = memory_order_seq_cst) QAK_noexcept;
-		// (std::atomic) integral fetch_and(integral, memory_order = memory_order_seq_cst) QAK_noexcept;
-		// (std::atomic) integral fetch_or(integral, memory_order = memory_order_seq_cst) QAK_noexcept;
-		// (std::atomic) integral fetch_xor(integral, memory_order = memory_order_seq_cst) QAK_noexcept;
+		//	Waiting and notification, as with C++20 std::atomic.
+		//
+		//	wait returns once it has loaded a value different from old. wait_until also gives up at deadline_ns, a
+		//	time_source::wallclock_ns reading (see now.hxx), and returns false iff it did. Waiters block in the kernel
+		//	(a futex, on Linux) rather than spinning or sleep-polling.
+		//
+		//	notify_one and notify_all are cheap when no thread is waiting. On types of other than 4 bytes, notify_one
+		//	may wake more than one waiter.
+
+		void wait(T old, memory_order mo = memory_order::seq_cst) const QAK_noexcept
+		{
+			wait_until(old, atomic_imp_ns_::no_deadline, mo);
+		}
+
+		bool wait_until(T old, std::uint64_t deadline_ns, memory_order mo = memory_order::seq_cst) const QAK_noexcept
+		{
+			repr_type r_old = atomic_imp_ns_::store_converter<T>()(old);
+			while (this->stor_.load(mo) == r_old)
+				if (!atomic_imp_ns_::wait_imp(&this->stor_, sizeof(repr_type), r_old, deadline_ns))
+					return this->stor_.load(mo) != r_old;
+			return true;
+		}
 
-		// (std::atomic) integral operator+=(integral) QAK_noexcept;
-		// (std::atomic) integral operator-=(integral) QAK_noexcept;
-		// (std::atomic) integral operator&=(integral) QAK_noexcept;
-		// (std::atomic) integral operator|=(integral) QAK_noexcept;
-		// (std::atomic) integral operator^=(integral) QAK_noexcept;
+		void notify_one() QAK_noexcept { atomic_imp_ns_::notify_imp(&this->stor_, sizeof(repr_type), false); }
+		void notify_all() QAK_noexcept { atomic_imp_ns_::notify_imp(&this->stor_, sizeof(repr_type), true); }
 
 	protected:
 		stor_type mutable stor_;
@@ -297,10 +521,25 @@ namespace atomic_imp_ns_ { //===================================================
 
 	//=================================================================================================================|
 
-	template <class T, class Enable = void> struct atomic
+	//	qak::atomic<T> for enum and trivially copyable class types. The value is held in an unsigned integer of the
+	//	same size, so it has the same operations and costs as one, less the arithmetic. State machines can keep an
+	//	enum struct state in one of these and make transitions with compare_exchange rather than under a mutex.
+	template <class T, class Enable = void> struct atomic : atomic_base<T>
 	{
-		//	This default template should always be specialized.
-		static_assert(0*sizeof(Enable), "qak::atomic<T> expecting an integral or pointer type for T.");
+		atomic() QAK_noexcept : atomic_base<T>() { }
+		constexpr atomic(T t_in) QAK_noexcept : atomic_base<T>(t_in) { }
+
+#if !QAK_COMPILER_FAILS_DELETED_MEMBERS // supports "= delete" syntax
+		atomic(atomic const &) = delete;
+		atomic & operator = (atomic const &) = delete;
+#else // workaround for compilers that don't support "= delete" syntax
+	private:
+		atomic(atomic const &); // unimplemented
+		atomic & operator = (atomic const &); // unimplemented
+	public:
+#endif // of workaround for compilers that don't support "= delete" syntax
+
+		T operator = (T val) QAK_noexcept { this->store(val); return val; }
 	};
 
 	//-----------------------------------------------------------------------------------------------------------------|
@@ -346,6 +585,47 @@ namespace atomic_imp_ns_ { //===================================================
 		T operator -- (int) QAK_noexcept { return static_cast<T>(this->stor_.postdecrement()); }
 		T operator ++ () QAK_noexcept    { return static_cast<T>(this->stor_.preincrement());  }
 		T operator -- () QAK_noexcept    { return static_cast<T>(this->stor_.predecrement());  }
+
+		//	Read-modify-write operations. Each is a single atomic instruction where the hardware has one (on x86, a
+		//	lock-prefixed add, sub, and, or, or xor; and, or, and xor need a CAS loop when the old value is used).
+		//	They return the previous value.
+
+		T fetch_add(T val, memory_order mo = memory_order::seq_cst) QAK_noexcept
+		{
+			return static_cast<T>(this->stor_.fetch_add(static_cast<repr_type>(val), mo));
+		}
+
+		T fetch_sub(T val, memory_order mo = memory_order::seq_cst) QAK_noexcept
+		{
+			return static_cast<T>(this->stor_.fetch_sub(static_cast<repr_type>(val), mo));
+		}
+
+		T fetch_and(T val, memory_order mo = memory_order::seq_cst) QAK_noexcept
+		{
+			return static_cast<T>(this->stor_.fetch_and(static_cast<repr_type>(val), mo));
+		}
+
+		T fetch_or(T val, memory_order mo = memory_order::seq_cst) QAK_noexcept
+		{
+			return static_cast<T>(this->stor_.fetch_or(static_cast<repr_type>(val), mo));
+		}
+
+		T fetch_xor(T val, memory_order mo = memory_order::seq_cst) QAK_noexcept
+		{
+			return static_cast<T>(this->stor_.fetch_xor(static_cast<repr_type>(val), mo));
+		}
+
+		//	Compound assignments are seq_cst and return the new value, as with std::atomic.
+		//	Use fetch_* for other orderings.
+
+		T operator += (T val) QAK_noexcept { return static_cast<T>(fetch_add(val) + val); }
+		T operator -= (T val) QAK_noexcept { return static_cast<T>(fetch_sub(val) - val); }
+		T operator &= (T val) QAK_noexcept { return static_cast<T>(fetch_and(val) & val); }
+		T operator |= (T val) QAK_noexcept { return static_cast<T>(fetch_or(val) | val); }
+		T operator ^= (T val) QAK_noexcept { return static_cast<T>(fetch_xor(val) ^ val); }
+
+	private:
+		typedef typename atomic_base<T>::repr_type repr_type;
 	};
 
 	//-----------------------------------------------------------------------------------------------------------------|
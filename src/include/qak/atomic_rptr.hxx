@@ -0,0 +1,172 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/atomic_rptr.hxx"
+//
+//	An rptr that can be read and replaced concurrently, e.g. for configuration that is read on every request and
+//	occasionally swapped out.
+//
+//	Readers use load_pinned(), which pins the epoch (see epoch.hxx) rather than touching the object's reference
+//	count, so many threads can read the same object without bouncing its cache line. load() returns a counted rptr
+//	for readers that need to keep the object beyond the pin.
+//
+//	The atomic_rptr holds one reference to its current object. When the object is replaced, that reference is
+//	released only after every reader pinned at the time has unpinned.
+
+#ifndef qak_atomic_rptr_hxx_INCLUDED_
+#define qak_atomic_rptr_hxx_INCLUDED_
+
+#include "qak/rptr.hxx"
+#include "qak/atomic.hxx"
+#include "qak/epoch.hxx"
+
+#include <utility> // std::move
+
+namespace qak { //=====================================================================================================|
+
+    template <class T>
+    struct atomic_rptr
+    {
+        typedef T element_type;
+
+        //	A pointer to the object that was current when it was loaded, valid for its own lifetime.
+        //	Holds the calling thread's epoch pinned, so keep it short-lived.
+        //
+        struct pinned_ptr
+        {
+            T * get() const QAK_noexcept { return p_; }
+            T & operator * () const QAK_noexcept { return *p_; }
+            T * operator -> () const QAK_noexcept { return p_; }
+            explicit operator bool () const QAK_noexcept { return !!p_; }
+
+            pinned_ptr(pinned_ptr const &) = delete;
+            pinned_ptr & operator = (pinned_ptr const &) = delete;
+
+        private:
+            friend struct atomic_rptr;
+
+            explicit pinned_ptr(qak::atomic<T *> const & ap) :
+                guard_(),
+                p_(ap.load(memory_order::acquire))
+            { }
+
+            epoch_guard guard_;
+            T * p_;
+        };
+
+        //	Construction.
+
+        atomic_rptr() QAK_noexcept { }
+
+        explicit atomic_rptr(rptr<T> rp) QAK_noexcept
+        {
+            ap_.store(release_(rp), memory_order::relaxed);
+        }
+
+        //	Noncopyable, nonmoveable.
+
+        atomic_rptr(atomic_rptr const &) = delete;
+        atomic_rptr & operator = (atomic_rptr const &) = delete;
+
+        //	Destruction. Readers may still be pinned on the current object, so it is retired like any other.
+
+        ~atomic_rptr()
+        {
+            retire_(ap_.load(memory_order::relaxed));
+        }
+
+        //	Reads.
+
+        pinned_ptr load_pinned() const
+        {
+            return pinned_ptr(ap_);
+        }
+
+        rptr<T> load() const
+        {
+            epoch_guard guard;
+            return rptr<T>(ap_.load(memory_order::acquire));
+        }
+
+        //	Writes.
+
+        void store(rptr<T> rp)
+        {
+            retire_(ap_.exchange(release_(rp), memory_order::acq_rel));
+        }
+
+        rptr<T> exchange(rptr<T> rp)
+        {
+            T * p_old = ap_.exchange(release_(rp), memory_order::acq_rel);
+
+            //	Our reference keeps p_old alive until it is retired, so a new one can be made without a pin.
+            rptr<T> rp_old(p_old);
+            retire_(p_old);
+            return rp_old;
+        }
+
+        //	If the current object is 'expected', replaces it with 'desired' and returns true.
+        //	Otherwise loads the current object into 'expected' and returns false.
+        bool compare_exchange_strong(rptr<T> & expected, rptr<T> desired)
+        {
+            epoch_guard guard;
+
+            T * p = expected.get();
+            if (ap_.compare_exchange_strong(p, desired.get(), memory_order::acq_rel, memory_order::acquire))
+            {
+                release_(desired);
+                retire_(p);
+                return true;
+            }
+
+            expected = rptr<T>(p);
+            return false;
+        }
+
+        bool compare_exchange_weak(rptr<T> & expected, rptr<T> desired)
+        {
+            return compare_exchange_strong(expected, std::move(desired));
+        }
+
+    private:
+
+        //	Takes over the reference held by rp.
+        static T * release_(rptr<T> & rp) QAK_noexcept
+        {
+            T * p = rp.p_;
+            rp.p_ = 0;
+            return p;
+        }
+
+        static void release_retired_(void * p) QAK_noexcept
+        {
+            rptr<T> rp(static_cast<T *>(p), typename rptr<T>::adopt_tag_());
+        }
+
+        static void retire_(T * p)
+        {
+            if (p)
+                epoch_retire(const_cast<void *>(static_cast<void const *>(p)), &release_retired_);
+        }
+
+        qak::atomic<T *> ap_;
+    };
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_atomic_rptr_hxx_INCLUDED_
@@ -0,0 +1,79 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/barrier.hxx"
+//
+//	A reusable rendezvous for a fixed number of threads, e.g., the workers of a thread_group running an iterative
+//	algorithm in phases. Each phase, every thread calls arrive_and_wait, and none return until all have arrived.
+//	An optional completion function runs once per phase, on the last thread to arrive, before any are released.
+//
+//	It's sense-reversing: a thread notes the phase number when it arrives, and the last to arrive resets the count
+//	and advances the phase, which is what the others wait on. So threads can go straight on to the next phase's
+//	arrive_and_wait without stepping on the one just finished. Waiters spin for a few microseconds, then park on the
+//	phase number with atomic::wait.
+
+#ifndef qak_barrier_hxx_INCLUDED_
+#define qak_barrier_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/atomic.hxx"
+#include "qak/padded.hxx"
+
+#include <cstdint> // std::uint32_t
+#include <functional> // std::function
+
+namespace qak { //=====================================================================================================|
+
+	struct barrier
+	{
+		typedef std::function<void ()> completion_fn_t;
+
+		//	For cnt_threads threads, which must be at least 1.
+		explicit barrier(std::uint32_t cnt_threads, completion_fn_t completion_fn = completion_fn_t());
+
+		//	Noncopyable, nonmoveable.
+
+		barrier(barrier const &) = delete;
+		barrier(barrier &&) = delete;
+		barrier & operator = (barrier const &) = delete;
+		barrier & operator = (barrier &&) = delete;
+
+		//	Blocks until cnt_threads threads have arrived in this phase. Returns true on exactly one of them, the
+		//	one that ran the completion function. If that throws, the phase still completes, and the exception
+		//	propagates from that thread's call.
+		bool arrive_and_wait();
+
+		std::uint32_t cnt_threads() const QAK_noexcept { return cnt_threads_; }
+
+		//	The number of phases completed. Only a hint, unless called between arrive_and_waits by a participant.
+		std::uint32_t phase() const QAK_noexcept { return phase_->load(memory_order::acquire); }
+
+	private:
+		std::uint32_t const cnt_threads_;
+		completion_fn_t completion_fn_;
+
+		//	Arrivals decrement the count; waiters poll the phase. Separate lines, so polling doesn't slow arrival.
+		padded<atomic<std::uint32_t>> cnt_remaining_;
+		padded<atomic<std::uint32_t>> phase_;
+
+		void complete_phase_(std::uint32_t phase) QAK_noexcept;
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_barrier_hxx_INCLUDED_
@@ -0,0 +1,80 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/bench_macros.hxx"
+//
+//	Support for the *__bench programs. These are built like the *__test programs, on test_app, but are not run as
+//	part of the tests. Numbers from a Debug build are mostly meaningless.
+
+#ifndef qak_bench_macros_hxx_INCLUDED_
+#define qak_bench_macros_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/stopwatch.hxx"
+
+#include <cstdint> // std::uint64_t
+#include <cstdio> // std::fprintf
+
+//=====================================================================================================================|
+
+namespace zz_int_qak_bench_macros {
+
+    //	Prevents the optimizer from discarding the computation of a value.
+    template <class T> inline void keep(T const & val)
+    {
+#if QAK_INLINEASM_GCC
+        __asm__ __volatile__ ("" : : "r"(&val) : "memory");
+#else
+        static_cast<void>(*static_cast<T const volatile *>(&val));
+#endif
+    }
+
+    //	Prints a result line with the mean time per operation.
+    inline void report(char const * psz_what, std::uint64_t cnt_ops, std::int64_t elapsed_ns)
+    {
+        std::fprintf(stderr, "    %-56s %10.2f ns/op %12llu ops %8.3f s\n",
+            psz_what,
+            cnt_ops ? double(elapsed_ns)/double(cnt_ops) : 0.0,
+            static_cast<unsigned long long>(cnt_ops),
+            double(elapsed_ns)/1.0e9 );
+    }
+}
+
+//	Prevents the optimizer from discarding the computation of the value.
+#define QAK_bench_keep(v) zz_int_qak_bench_macros::keep(v)
+
+//	Reports the mean time per operation for cnt_ops operations that took elapsed_ns.
+#define QAK_bench_report(psz_what, cnt_ops, elapsed_ns) \
+    zz_int_qak_bench_macros::report((psz_what), (cnt_ops), (elapsed_ns))
+
+//	Runs the statements cnt_iters times and reports the mean time per iteration.
+//	The current iteration number is available as 'bench_ix'.
+#define QAK_bench_loop(psz_what, cnt_iters, ...)                                      \
+    do {                                                                               \
+        std::uint64_t const bench_cnt_iters_ = (cnt_iters);                            \
+        qak::stopwatch bench_sw_;                                                      \
+        for (std::uint64_t bench_ix = 0; bench_ix < bench_cnt_iters_; ++bench_ix)     \
+        {                                                                              \
+            __VA_ARGS__;                                                               \
+        }                                                                              \
+        QAK_bench_report((psz_what), bench_cnt_iters_, bench_sw_.elapsed_ns());        \
+    } while (false)
+
+//=====================================================================================================================|
+#endif // ndef qak_bench_macros_hxx_INCLUDED_
@@ -0,0 +1,100 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/condition.hxx"
+//
+//	A condition variable for use with qak::mutex.
+//
+//	A waiter holds a mutex_lock while it checks the state it's waiting on, then waits, which releases the mutex and
+//	blocks until notified. The lock is held again by the time wait returns, and the mutex's record of its owning
+//	thread is correct throughout. To not miss a notification, whoever changes the state must do so while holding
+//	the mutex, though it can notify after releasing it.
+//
+//	Waits can end without a notification, so check the state in a loop, or use the forms taking a predicate.
+//
+//	It's a sequence number which notifiers bump and waiters block on with atomic::wait (a futex, on Linux).
+
+#ifndef qak_condition_hxx_INCLUDED_
+#define qak_condition_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/atomic.hxx"
+#include "qak/mutex.hxx"
+
+#include <cstdint> // std::int64_t, std::uint32_t, std::uint64_t
+
+namespace qak { //=====================================================================================================|
+
+	struct condition
+	{
+		condition() : seq_(0) { }
+
+		//	Noncopyable, nonmoveable.
+
+		condition(condition const &) = delete;
+		condition(condition &&) = delete;
+		condition & operator = (condition const &) = delete;
+		condition & operator = (condition &&) = delete;
+
+		//	Releases the mutex locked by lock and blocks until notified, then locks it again.
+		//	Throws if lock doesn't hold a mutex locked by the calling thread.
+		void wait(mutex_lock & lock);
+
+		//	As wait, but gives up after max_wait_ns or at deadline_ns, a time_source::wallclock_ns reading (see
+		//	now.hxx). Returns false iff it gave up. The mutex is locked again either way.
+		bool wait_for_ns(mutex_lock & lock, std::int64_t max_wait_ns);
+		bool wait_until_ns(mutex_lock & lock, std::uint64_t deadline_ns);
+
+		//	Waits until pred() returns true. pred is called with the mutex locked.
+		template <class Pred>
+		void wait(mutex_lock & lock, Pred pred)
+		{
+			while (!pred())
+				wait(lock);
+		}
+
+		//	Waits until pred() returns true or deadline_ns passes, returning the last result of pred().
+		template <class Pred>
+		bool wait_until_ns(mutex_lock & lock, std::uint64_t deadline_ns, Pred pred)
+		{
+			while (!pred())
+				if (!wait_until_ns(lock, deadline_ns))
+					return pred();
+			return true;
+		}
+
+		//	Wakes one waiting thread, or all of them. Cheap when none are waiting.
+		void notify_one() QAK_noexcept
+		{
+			seq_.fetch_add(1, memory_order::seq_cst);
+			seq_.notify_one();
+		}
+
+		void notify_all() QAK_noexcept
+		{
+			seq_.fetch_add(1, memory_order::seq_cst);
+			seq_.notify_all();
+		}
+
+	private:
+		atomic<std::uint32_t> seq_;
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_condition_hxx_INCLUDED_
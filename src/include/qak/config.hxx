@@ -189,6 +189,12 @@ static_assert(QAK_pointer_bits == sizeof(void *)*8, "Confused about pointer size
     //	The CPU has an RDTSC instruction which may read a TSC.
 #	define QAK_CPU_HAS_RDTSC 1
 
+#endif
+
+    //	The size of a cache line, the unit in which CPUs share memory. Data written by different threads should be
+    //	at least this far apart. A compile-time guess; 64 for every CPU listed above.
+#if !defined(QAK_CACHE_LINE_SIZE)
+#	define QAK_CACHE_LINE_SIZE 64
 #endif
 
 //=====================================================================================================================|
@@ -213,6 +219,9 @@ static_assert(QAK_pointer_bits == sizeof(void *)*8, "Confused about pointer size
     //	We have the MEM_FULL_BARRIER() intrinsic.
 #	define QAK_HAS_GNUC_MEM_FULL_BARRIER 1
 
+    //	We have the __atomic_* builtins with C++11 memory model semantics.
+#	define QAK_HAS_GNUC_ATOMIC_BUILTINS 1
+
 #undef QAK_COMPILER_FAILS_EXPLICIT_CONVERSIONS
 
 #define QAK_explicit explicit
@@ -239,6 +248,9 @@ static_assert(QAK_pointer_bits == sizeof(void *)*8, "Confused about pointer size
     //	We have the MEM_FULL_BARRIER() intrinsic.
 #	define QAK_HAS_GNUC_MEM_FULL_BARRIER 1
 
+    //	We have the __atomic_* builtins with C++11 memory model semantics.
+#	define QAK_HAS_GNUC_ATOMIC_BUILTINS 1
+
 #define QAK_COMPILER_FAILS_EXPLICIT_CONVERSIONS 1
 
 #	if !defined(QAK_explicit)
@@ -288,6 +300,19 @@ static_assert(QAK_pointer_bits == sizeof(void *)*8, "Confused about pointer size
 
 #endif // of defined(QAK_MSC)
 
+//=====================================================================================================================|
+//
+//	Builtins the compiler can tell us about directly.
+
+#if defined(__has_builtin)
+#	if __has_builtin(__builtin_bit_cast)
+
+    //	We have __builtin_bit_cast, the compiler half of C++20 std::bit_cast (gcc 11, clang 9).
+#		define QAK_HAS_BUILTIN_BIT_CAST 1
+
+#	endif
+#endif
+
 //=====================================================================================================================|
 //
 //	Standard library settings.
@@ -0,0 +1,74 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/epoch.hxx"
+//
+//	Epoch-based reclamation.
+//
+//	Readers pin the current epoch for the duration of a read with an epoch_guard. Writers unlink an object so no
+//	new reader can find it, then hand it to epoch_retire(). The object is reclaimed once every thread that was
+//	pinned at the time has unpinned. Pinning touches only a per-thread word, so readers of shared data do not
+//	contend with each other.
+//
+//	Pins nest. Don't block for long while pinned: it holds up reclamation for every thread.
+
+#ifndef qak_epoch_hxx_INCLUDED_
+#define qak_epoch_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+
+namespace qak_epoch_imp_ { //==========================================================================================|
+
+	struct thread_rec;
+
+	thread_rec * pin();
+	void unpin(thread_rec * p_rec) QAK_noexcept;
+
+} // namespace qak_epoch_imp_
+namespace qak { //=====================================================================================================|
+
+	//	Pins the calling thread's epoch for the lifetime of the object.
+	//
+	struct epoch_guard
+	{
+		epoch_guard() : p_rec_(qak_epoch_imp_::pin()) { }
+
+		~epoch_guard() { qak_epoch_imp_::unpin(p_rec_); }
+
+		//	Noncopyable, nonmoveable.
+
+		epoch_guard(epoch_guard const &) = delete;
+		epoch_guard(epoch_guard &&) = delete;
+		epoch_guard & operator = (epoch_guard const &) = delete;
+		epoch_guard & operator = (epoch_guard &&) = delete;
+
+	private:
+		qak_epoch_imp_::thread_rec * p_rec_;
+	};
+
+	//	Arranges for fn(p) to be called once no thread can still be reading p through a pin taken before now.
+	//	The call is made later from some thread's epoch_retire() or epoch_synchronize(). fn must not throw.
+	void epoch_retire(void * p, void (* fn)(void *));
+
+	//	Waits until everything retired so far by the calling thread, or left behind by threads that have exited, has
+	//	been reclaimed. Mainly for tests and shutdown. Must not be called while the calling thread is pinned.
+	void epoch_synchronize();
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_epoch_hxx_INCLUDED_
@@ -0,0 +1,241 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/executor.hxx"
+//
+//	A work-stealing pool for running many short tasks, hosted by a thread_group.
+//
+//	Each worker has a Chase-Lev deque. It pushes and takes tasks at the bottom, in LIFO order, and idle workers
+//	steal from the top of a random victim's deque. Tasks submitted by threads that aren't workers go to a shared
+//	injection queue. A worker finding nothing to do spins a while, then parks until a task is submitted.
+//
+//	A closure of up to task_inline_bytes is stored in the task itself, which comes from a fixed_pool, so submitting
+//	one doesn't touch the heap once the pool is warm. Larger closures are copied to the heap.
+//
+//	For fork-join, a task_group counts the tasks run through it, and its wait() runs queued tasks until they're
+//	all done:
+//
+//		qak::task_group tg(ex);
+//		tg.run([&]() { a = fib(n - 1); });
+//		b = fib(n - 2);
+//		tg.wait();
+
+#ifndef qak_executor_hxx_INCLUDED_
+#define qak_executor_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/atomic.hxx"
+#include "qak/thread_group.hxx"
+
+#include <cstddef> // std::size_t, std::max_align_t
+#include <cstdint> // std::uint32_t
+#include <exception> // std::exception_ptr
+#include <new> // placement new
+#include <type_traits> // std::decay
+#include <utility> // std::forward
+
+namespace qak { //=====================================================================================================|
+
+	struct executor;
+	struct task_group;
+
+} // namespace qak
+namespace qak_executor_imp_ { //=======================================================================================|
+
+	struct executor_data;
+
+	std::size_t const task_node_bytes = 128;
+
+	//	A task, in a block from a fixed_pool.
+	struct task_node
+	{
+		task_node * p_next; // in the injection queue
+		qak::task_group * p_group;
+
+		//	Runs the closure and destroys it, even if it throws.
+		void (* p_run_fn)(task_node * p);
+
+		alignas(std::max_align_t) unsigned char buf[
+			task_node_bytes - (3*sizeof(void *) + alignof(std::max_align_t) - 1)/alignof(std::max_align_t)
+			                  *alignof(std::max_align_t) ];
+	};
+
+	static_assert(sizeof(task_node) == task_node_bytes, "");
+
+	task_node * alloc_task_node();
+	void free_task_node(task_node * p) QAK_noexcept;
+
+	//	Stores Fn in the task and runs it from there.
+	template <class Fn, bool fits_inline = sizeof(Fn) <= sizeof(task_node::buf)
+	                                       && alignof(Fn) <= alignof(std::max_align_t)>
+	struct task_closure
+	{
+		template <class Arg>
+		static void construct(task_node * p, Arg && arg)
+		{
+			new (p->buf) Fn(std::forward<Arg>(arg));
+		}
+
+		static void run(task_node * p)
+		{
+			Fn & fn = *reinterpret_cast<Fn *>(p->buf);
+			struct destroyer { Fn & fn; ~destroyer() { fn.~Fn(); } } d = { fn };
+			fn();
+		}
+	};
+
+	//	Too big, so stores a pointer to a copy on the heap.
+	template <class Fn>
+	struct task_closure<Fn, false>
+	{
+		template <class Arg>
+		static void construct(task_node * p, Arg && arg)
+		{
+			*reinterpret_cast<Fn **>(p->buf) = new Fn(std::forward<Arg>(arg));
+		}
+
+		static void run(task_node * p)
+		{
+			Fn * p_fn = *reinterpret_cast<Fn **>(p->buf);
+			struct destroyer { Fn * p_fn; ~destroyer() { delete p_fn; } } d = { p_fn };
+			(*p_fn)();
+		}
+	};
+
+	template <class Fn>
+	task_node * make_task(Fn && fn, qak::task_group * p_group)
+	{
+		typedef task_closure<typename std::decay<Fn>::type> closure;
+
+		task_node * p = alloc_task_node();
+		try
+		{
+			closure::construct(p, std::forward<Fn>(fn));
+		}
+		catch (...)
+		{
+			free_task_node(p);
+			throw;
+		}
+
+		p->p_next = 0;
+		p->p_group = p_group;
+		p->p_run_fn = &closure::run;
+		return p;
+	}
+
+} // namespace qak_executor_imp_
+namespace qak { //=====================================================================================================|
+
+	struct executor
+	{
+		//	The largest closure stored without a heap allocation.
+		static std::size_t const task_inline_bytes = sizeof(qak_executor_imp_::task_node::buf);
+
+		//	Starts cnt_threads workers, or one per recommended thread (see host_info) if 0, each with opts.
+		explicit executor(std::size_t cnt_threads = 0, thread_options const & opts = thread_options());
+
+		//	Stops the workers and waits for them to exit, then runs any tasks still queued on the calling thread.
+		~executor();
+
+		//	Noncopyable, nonmoveable.
+
+		executor(executor const &) = delete;
+		executor(executor &&) = delete;
+		executor & operator = (executor const &) = delete;
+		executor & operator = (executor &&) = delete;
+
+		//	Queues fn() to be run on some worker. Submitted from a worker, it goes on that worker's own deque.
+		//	fn must not throw; if it does, the program terminates, as with an exception escaping a thread. To
+		//	wait for tasks or get their exceptions, use a task_group.
+		template <class Fn>
+		void submit(Fn && fn)
+		{
+			submit_(qak_executor_imp_::make_task(std::forward<Fn>(fn), 0));
+		}
+
+		//	Runs one queued task on the calling thread, if it can find one. Returns true iff it did.
+		bool run_one();
+
+		//	The thread_group hosting the workers, e.g., to set_target_cnt_threads. With no workers, tasks run only
+		//	when some thread calls run_one or waits on a task_group.
+		thread_group & threads();
+
+	private:
+		friend struct task_group;
+
+		void submit_(qak_executor_imp_::task_node * p) QAK_noexcept;
+
+		qak_executor_imp_::executor_data * p_data_;
+	};
+
+	//	A process-wide executor with one worker per recommended thread, started on first use. Never destroyed, so
+	//	it's still usable from static destructors.
+	executor & default_executor();
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	A set of tasks to wait for. Any thread may run tasks through it, including its own tasks, which keeps the
+	//	group from seeming done until those finish too. Only one thread at a time should wait.
+	//
+	struct task_group
+	{
+		explicit task_group(executor & ex) : ex_(ex), cnt_pending_(0), has_exception_(false) { }
+
+		//	Waits for the tasks, discarding any exception.
+		~task_group();
+
+		//	Noncopyable, nonmoveable.
+
+		task_group(task_group const &) = delete;
+		task_group(task_group &&) = delete;
+		task_group & operator = (task_group const &) = delete;
+		task_group & operator = (task_group &&) = delete;
+
+		//	Queues fn() on the executor, as part of this group.
+		template <class Fn>
+		void run(Fn && fn)
+		{
+			qak_executor_imp_::task_node * p = qak_executor_imp_::make_task(std::forward<Fn>(fn), this);
+
+			//	Counted before it's queued, as it may run at once. submit_ doesn't throw, so it's always queued.
+			cnt_pending_.fetch_add(1, memory_order::relaxed);
+			ex_.submit_(p);
+		}
+
+		//	Blocks until every task run through the group has finished, running queued tasks (of any group) on
+		//	the calling thread meanwhile. If any threw, rethrows the first exception.
+		void wait();
+
+	private:
+		friend struct qak_executor_imp_::executor_data;
+
+		executor & ex_;
+		atomic<std::uint32_t> cnt_pending_;
+
+		//	The first exception, written only by the thread that sets has_exception_.
+		atomic<bool> has_exception_;
+		std::exception_ptr ep_;
+
+		void task_done_() QAK_noexcept;
+		void wait_imp_();
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_executor_hxx_INCLUDED_
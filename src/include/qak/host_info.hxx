@@ -44,5 +44,16 @@ namespace qak {
 	//	The value returned will be greater than 0.
 	unsigned cnt_threads_recommended();
 
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	Returns the number of NUMA nodes, numbered from 0. If the host doesn't say, it's treated as a single node.
+	unsigned cnt_numa_nodes();
+
+	//	Returns the NUMA node of the CPU with the specified index, or 0 if unknown.
+	unsigned numa_node_of_cpu(unsigned cpu_ix);
+
+	//	Returns the OS's ID for the NUMA node with the specified index. They differ where the OS's IDs have gaps.
+	unsigned numa_node_os_id(unsigned node_ix);
+
 } } // namespace qak..host_info =======================================================================================|
 #endif // ndef qak_host_info_hxx_INCLUDED_
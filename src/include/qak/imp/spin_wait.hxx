@@ -0,0 +1,65 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2011,2017 Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/imp/spin_wait.hxx"
+//
+//	Pieces shared by the synchronization primitives that spin a while before parking with atomic::wait.
+
+#ifndef qak_imp_spin_wait_hxx_INCLUDED_
+#define qak_imp_spin_wait_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/host_info.hxx"
+
+namespace qak { //=====================================================================================================|
+
+	//	Tells the CPU we're polling, so it can go easier on the memory system and a sibling hyperthread.
+	inline void spin_pause() QAK_noexcept
+	{
+#if QAK_CPU_x64 && QAK_INLINEASM_GCC
+		__asm__ __volatile__ ("pause");
+#endif
+	}
+
+	//	On a single CPU, whatever we're waiting for can't happen while we spin, so there waiters park right away.
+	inline bool spinning_can_help()
+	{
+		static bool const b = 1 < host_info::cnt_cpus_available();
+		return b;
+	}
+
+	//	Polls pred() up to cnt_spins times (none, if spinning can't help), pausing between. Returns true iff it
+	//	returned true.
+	template <class Pred>
+	bool spin_until(unsigned cnt_spins, Pred pred)
+	{
+		if (!spinning_can_help())
+			return pred();
+
+		for (unsigned n = 0; n < cnt_spins; ++n)
+		{
+			if (pred())
+				return true;
+			spin_pause();
+		}
+		return pred();
+	}
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_imp_spin_wait_hxx_INCLUDED_
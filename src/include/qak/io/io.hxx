@@ -25,6 +25,7 @@
 
 #include "qak/config.hxx"
 #include "qak/thread_group.hxx"
+#include "qak/pool.hxx"
 #include "qak/rptr.hxx"
 
 namespace qak { namespace io { //======================================================================================|
@@ -57,7 +58,7 @@ namespace qak { namespace io { //===============================================
 	//	General events.
 
 	//	Notifies of an error. The condition may or may not be clearable.
-	struct error : rpointee_derived<error>, virtual event { };
+	struct error : rpointee_derived<error>, rpointee_pooled<error>, virtual event { };
 
 	//	Notifies that the underlying OS handle has closed.
 	//	readable: this will only be sent after eod or error.
@@ -83,17 +84,17 @@ namespace qak { namespace io { //===============================================
 	//	'buffered', general support for buffered objects.
 
 	//	Notifies that the buffered object has become empty.
-	struct buffer_empty : rpointee_derived<buffer_empty>, virtual event { };
+	struct buffer_empty : rpointee_derived<buffer_empty>, rpointee_pooled<buffer_empty>, virtual event { };
 
 	//	C.f. Node.js 0.10 'drain' event.
 	//	Notifies that the buffered object has passed at or below its low-water mark.
-	struct buffer_lowwater : rpointee_derived<buffer_lowwater>, virtual event { };
+	struct buffer_lowwater : rpointee_derived<buffer_lowwater>, rpointee_pooled<buffer_lowwater>, virtual event { };
 
 	//	Notifies that the buffered object has passed above its high-water mark.
-	struct buffer_highwater : rpointee_derived<buffer_highwater>, virtual event { };
+	struct buffer_highwater : rpointee_derived<buffer_highwater>, rpointee_pooled<buffer_highwater>, virtual event { };
 
 	//	Notifies that the buffered object has become full.
-	struct buffer_full : rpointee_derived<buffer_full>, virtual event { };
+	struct buffer_full : rpointee_derived<buffer_full>, rpointee_pooled<buffer_full>, virtual event { };
 
 	struct buffered_NTB :
 		rpointee_base<buffered_NTB>,
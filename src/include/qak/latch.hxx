@@ -0,0 +1,80 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/latch.hxx"
+//
+//	A single-use countdown: threads count it down, and threads waiting on it are released when it reaches zero.
+//	E.g., a thread starting workers can wait until each has finished setting up.
+//
+//	Waiters spin a while, then park on the count with atomic::wait.
+
+#ifndef qak_latch_hxx_INCLUDED_
+#define qak_latch_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/atomic.hxx"
+
+#include <cassert>
+#include <cstdint> // std::uint32_t, std::uint64_t
+
+namespace qak { //=====================================================================================================|
+
+	struct latch
+	{
+		explicit latch(std::uint32_t cnt) : cnt_(cnt) { }
+
+		//	Noncopyable, nonmoveable.
+
+		latch(latch const &) = delete;
+		latch(latch &&) = delete;
+		latch & operator = (latch const &) = delete;
+		latch & operator = (latch &&) = delete;
+
+		//	Subtracts cnt, which must not take it below zero, releasing the waiters if it reaches zero.
+		void count_down(std::uint32_t cnt = 1) QAK_noexcept
+		{
+			std::uint32_t prev = cnt_.fetch_sub(cnt, memory_order::acq_rel);
+			assert(cnt <= prev);
+			if (prev == cnt)
+				cnt_.notify_all();
+		}
+
+		//	Returns true iff it has reached zero. Does not block.
+		bool try_wait() const QAK_noexcept { return !cnt_.load(memory_order::acquire); }
+
+		//	Blocks until it reaches zero.
+		void wait() const QAK_noexcept;
+
+		//	As wait, but gives up at deadline_ns, a time_source::wallclock_ns reading (see now.hxx). Returns false
+		//	iff it gave up.
+		bool wait_until_ns(std::uint64_t deadline_ns) const QAK_noexcept;
+
+		//	count_down, then wait.
+		void arrive_and_wait(std::uint32_t cnt = 1) QAK_noexcept
+		{
+			count_down(cnt);
+			wait();
+		}
+
+	private:
+		atomic<std::uint32_t> cnt_;
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_latch_hxx_INCLUDED_
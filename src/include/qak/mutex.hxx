@@ -20,14 +20,40 @@
 //#include "qak/mutex.hxx"
 //
 //	A minimal mutex facility.
+//
+//	On pthreads platforms the mutex is a 4-byte state word managed with qak::atomic, parking contending threads with
+//	atomic::wait (a futex on Linux). Locking and unlocking without contention are each a single atomic RMW, inline.
+//
+//	Building with QAK_MUTEX_PROFILING (the CMake option of that name) makes each mutex record its acquisitions, time
+//	spent waiting for it, and time it's held, totalled across all mutexes of the same name. See mutex_profiling.hxx
+//	for the report. Without it, the name is ignored and none of this is compiled in.
 
 #ifndef qak_mutex_hxx_INCLUDED_
 #define qak_mutex_hxx_INCLUDED_
 
 #include "qak/config.hxx"
+#include "qak/atomic.hxx"
+#include "qak/fail.hxx"
 #include "qak/optional.hxx"
 #include "qak/imp/pthread.hxx"
 
+#include <cassert>
+#include <cstdint> // std::uint32_t, std::uint64_t
+
+//	Every translation unit must agree, so set it from the build.
+#if !defined(QAK_MUTEX_PROFILING)
+#	define QAK_MUTEX_PROFILING 0
+#endif
+
+#if QAK_MUTEX_PROFILING
+#	include "qak/now.hxx"
+#endif
+
+namespace qak_mutex_imp_ { //==========================================================================================|
+
+	struct prof_record;
+
+} // namespace qak_mutex_imp_
 namespace qak { //=====================================================================================================|
 
 	struct mutex;
@@ -41,7 +67,16 @@ namespace qak { //==============================================================
 	{
 		typedef mutex_lock lock_type;
 
+#if QAK_THREAD_PTHREAD
+		//	Constant-initialized, so a mutex at namespace scope works even before dynamic initialization.
+		constexpr mutex();
+
+		//	psz_name identifies the mutex in profiling reports. It must outlive the program; use a literal.
+		constexpr explicit mutex(char const * psz_name);
+#else
 		mutex();
+		explicit mutex(char const * psz_name);
+#endif
 		~mutex();
 
 		//	Noncopyable, nonmoveable.
@@ -65,16 +100,46 @@ namespace qak { //==============================================================
 
 	private:
 		friend struct mutex_lock;
+		friend struct condition;
 
-#if QAK_THREAD_PTHREAD
+		//	Lock and unlock, without mutex_lock. The caller makes sure they pair up.
+		void acquire_();
+		void release_() QAK_noexcept;
 
-		typedef unsigned long long imp_elem_t;
-		typedef imp_elem_t imp_t[
-				  1 // atomic owning thread ID
+#if QAK_THREAD_PTHREAD
 
-				//	Actual pthread mutex is 24 or 40 bytes
-				+ (24 + 4*(QAK_pointer_bits - 32)/8 + sizeof(unsigned long long) - 1)/sizeof(unsigned long long)
-			];
+		enum : std::uint32_t {
+			state_unlocked = 0,
+			state_locked = 1,
+			state_locked_waiters = 2 // locked, and threads may be parked waiting on state_
+		};
+
+		atomic<std::uint32_t> state_;
+
+		//	The holder's thread ID, or invalid_thread_id_value. Only the holder stores its own ID here, so a relaxed
+		//	load is enough for a thread to tell whether it's the holder. The lock itself is ordered by state_ alone.
+		//	It's kept in every build, not just debug ones, because is_locked_by_this_thread() and the recursion
+		//	checks need it. That costs a word per mutex and a relaxed store on each lock and unlock.
+		atomic<pthread_t> owner_;
+
+		bool try_acquire_() QAK_noexcept;
+		void acquire_contended_();
+
+		//	Profiling hooks, called by the thread acquiring or about to release it.
+#if QAK_MUTEX_PROFILING
+		//	Despite the name, wallclock_ns is the monotonic clock (CLOCK_MONOTONIC on POSIX).
+		static std::uint64_t prof_now_ns_() { return read_time_source(time_source::wallclock_ns); }
+		void prof_acquired_(bool contended, std::uint64_t t_wait_begin_ns) QAK_noexcept;
+		void prof_releasing_() QAK_noexcept;
+
+		char const * prof_psz_name_;
+		qak_mutex_imp_::prof_record * p_prof_rec_; // looked up by the first thread to acquire it
+		std::uint64_t prof_t_acquired_ns_;
+#else
+		static constexpr std::uint64_t prof_now_ns_() { return 0; }
+		void prof_acquired_(bool, std::uint64_t) QAK_noexcept { }
+		void prof_releasing_() QAK_noexcept { }
+#endif
 
 #elif QAK_THREAD_WIN32
 
@@ -86,11 +151,11 @@ namespace qak { //==============================================================
 				+ (24 + 4*(QAK_pointer_bits - 32)/8 + sizeof(unsigned long long) - 1)/sizeof(unsigned long long)
 			];
 
+		imp_t imp_;
+
 #else
 #	error "port me"
 #endif
-
-		imp_t imp_;
 	};
 
 	//-----------------------------------------------------------------------------------------------------------------|
@@ -126,6 +191,7 @@ namespace qak { //==============================================================
 
 	private:
 		friend struct mutex;
+		friend struct condition;
 
 		struct private_construct_tag { };
 		mutex_lock(private_construct_tag const &, mutex * pm);
@@ -133,5 +199,117 @@ namespace qak { //==============================================================
 		mutex * p_m_;
 	};
 
+#if QAK_THREAD_PTHREAD
+
+	//=================================================================================================================|
+	//
+	//	Inline implementation.
+
+	constexpr mutex::mutex() : mutex(nullptr) { }
+
+	constexpr mutex::mutex(char const * psz_name) :
+		state_(state_unlocked),
+		owner_(invalid_thread_id_value)
+#if QAK_MUTEX_PROFILING
+		, prof_psz_name_(psz_name),
+		p_prof_rec_(0),
+		prof_t_acquired_ns_(0)
+#endif
+	{
+		QAK_unused(psz_name);
+	}
+
+	inline mutex::~mutex()
+	{
+		//	There is no conceivable circumstance in which it's valid to destroy the mutex while any mutex_lock owns it.
+		assert(state_.load(memory_order::relaxed) == state_unlocked);
+	}
+
+	inline bool mutex::try_acquire_() QAK_noexcept
+	{
+		std::uint32_t st = state_unlocked;
+		if (!state_.compare_exchange_strong(st, state_locked, memory_order::acquire, memory_order::relaxed))
+			return false;
+
+		assert(owner_.load(memory_order::relaxed) == invalid_thread_id_value);
+		owner_.store(::pthread_self(), memory_order::relaxed);
+		return true;
+	}
+
+	inline void mutex::acquire_()
+	{
+		if (try_acquire_())
+			prof_acquired_(false, 0);
+		else
+			acquire_contended_();
+	}
+
+	inline void mutex::release_() QAK_noexcept
+	{
+		prof_releasing_();
+
+		assert(owner_.load(memory_order::relaxed) == ::pthread_self());
+		owner_.store(invalid_thread_id_value, memory_order::relaxed);
+
+		if (state_.exchange(state_unlocked, memory_order::release) == state_locked_waiters)
+			state_.notify_one();
+	}
+
+	inline mutex::lock_type mutex::lock()
+	{
+		acquire_();
+		return mutex_lock(mutex_lock::private_construct_tag(), this);
+	}
+
+	inline bool mutex::is_locked_by_this_thread() const
+	{
+		return !! ::pthread_equal(owner_.load(memory_order::relaxed), ::pthread_self());
+	}
+
+	inline optional<mutex::lock_type> mutex::try_lock()
+	{
+		if (!try_acquire_())
+		{
+			//	We might be failing because we hold it ourselves.
+			if (is_locked_by_this_thread())
+				fail(); //	Already owns the mutex.
+
+			return optional<mutex_lock>();
+		}
+
+		prof_acquired_(false, 0);
+		return mutex_lock(mutex_lock::private_construct_tag(), this);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	inline mutex_lock::mutex_lock(mutex & m) : p_m_(&m)
+	{
+		m.acquire_();
+	}
+
+	inline mutex_lock::mutex_lock(private_construct_tag const &, mutex * p_m) : p_m_(p_m) { }
+
+	inline mutex_lock::mutex_lock(mutex_lock && that) : p_m_(that.p_m_)
+	{
+		that.p_m_ = 0;
+
+		//	Verify we have a lock on mutex *p_m_.
+		assert(p_m_ && p_m_->is_locked_by_this_thread());
+	}
+
+	inline mutex_lock::~mutex_lock()
+	{
+		if (p_m_)
+			p_m_->release_();
+	}
+
+	inline bool mutex_lock::is_locking(mutex const & m) const
+	{
+		return &m == p_m_;
+	}
+
+#endif // QAK_THREAD_PTHREAD
+
 } // namespace qak ====================================================================================================|
 #endif // ndef qak_mutex_hxx_INCLUDED_
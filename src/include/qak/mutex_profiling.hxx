@@ -0,0 +1,71 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/mutex_profiling.hxx"
+//
+//	Reports on mutex contention, for finding the hot one when latency spikes.
+//
+//	Only available when built with QAK_MUTEX_PROFILING (see mutex.hxx). Stats are kept per mutex name: every mutex
+//	constructed with the same name adds to the same totals, and those constructed without one add to "(unnamed)".
+//	Times are from time_source::wallclock_ns.
+
+#ifndef qak_mutex_profiling_hxx_INCLUDED_
+#define qak_mutex_profiling_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/mutex.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdint> // std::uint64_t
+#include <cstdio> // std::FILE
+
+namespace qak { //=====================================================================================================|
+
+	constexpr bool mutex_profiling_enabled() { return QAK_MUTEX_PROFILING != 0; }
+
+	struct mutex_stats
+	{
+		char const * psz_name;
+
+		std::uint64_t cnt_acquisitions;
+
+		//	Acquisitions which found the mutex locked and had to spin or park.
+		std::uint64_t cnt_contended;
+
+		//	From the start of a contended acquisition until it acquired.
+		std::uint64_t wait_ns_total;
+		std::uint64_t wait_ns_max;
+
+		//	From acquisition until release.
+		std::uint64_t hold_ns_total;
+		std::uint64_t hold_ns_max;
+	};
+
+	//	A copy of the stats for every name, hottest first: by total wait time, then by count of acquisitions.
+	//	Empty when profiling is not enabled.
+	vector<mutex_stats> mutex_stats_snapshot();
+
+	//	Writes the snapshot as a table, one line per name.
+	void write_mutex_stats_report(std::FILE * fp);
+
+	//	Zeroes all stats. Acquisitions and releases racing with this may be counted partly before and partly after.
+	void reset_mutex_stats();
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_mutex_profiling_hxx_INCLUDED_
@@ -0,0 +1,54 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/padded.hxx"
+//
+//	A T alone on its own cache line(s), so that writes to it don't slow down threads using its neighbors.
+
+#ifndef qak_padded_hxx_INCLUDED_
+#define qak_padded_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+
+#include <cstddef> // std::size_t
+#include <utility> // std::forward
+
+namespace qak { //=====================================================================================================|
+
+	std::size_t const cache_line_size = QAK_CACHE_LINE_SIZE;
+
+	//	Aligned to, and a multiple of, cache_line_size. Arrays of these put each element on separate lines.
+	//	Heap allocation of over-aligned types needs C++17 operator new, which we have.
+	//
+	template <class T>
+	struct alignas(QAK_CACHE_LINE_SIZE) padded
+	{
+		T value;
+
+		template <class ... Args>
+		explicit padded(Args && ... args) : value(std::forward<Args>(args)...) { }
+
+		T & operator * () { return value; }
+		T const & operator * () const { return value; }
+		T * operator -> () { return &value; }
+		T const * operator -> () const { return &value; }
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_padded_hxx_INCLUDED_
@@ -0,0 +1,293 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/parallel.hxx"
+//
+//	Data-parallel algorithms on an executor: for, reduce, inclusive scan, and merge sort.
+//
+//	Each splits its range in halves, running one half as a task and recursing on the other, until the pieces are
+//	no bigger than the grain size, so idle workers steal big pieces first and the load evens out on its own. The
+//	grain adapts to the range and the pool: about chunks_per_thread pieces for every worker and the caller, but
+//	never fewer than min_grain elements, so a range of min_grain or fewer runs inline with no tasks at all. Bodies
+//	that do much more than a few nanoseconds of work per element should pass a smaller grain explicitly.
+//
+//	The calling thread takes part, so these may be called from within tasks on the same executor. If a body
+//	throws, the call waits for the pieces already started and rethrows the first exception.
+
+#ifndef qak_parallel_hxx_INCLUDED_
+#define qak_parallel_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/executor.hxx"
+#include "qak/min_max.hxx"
+#include "qak/vector.hxx"
+
+#include <algorithm> // std::lower_bound, std::upper_bound, std::merge, std::sort
+#include <cstddef> // std::size_t
+#include <functional> // std::less
+#include <iterator> // std::make_move_iterator
+#include <utility> // std::move
+
+namespace qak_parallel_imp_ { //=======================================================================================|
+
+	using qak::executor;
+	using qak::task_group;
+
+	std::size_t const chunks_per_thread = 8;
+	std::size_t const min_grain = 1024;
+
+	inline std::size_t auto_grain(executor & ex, std::size_t cnt, std::size_t grain)
+	{
+		if (grain)
+			return grain;
+
+		std::size_t cnt_threads = ex.threads().get_current_cnt_threads() + 1;
+		std::size_t g = cnt/(chunks_per_thread*cnt_threads);
+		return g < min_grain ? min_grain : g;
+	}
+
+	template <class Fn>
+	void for_ranges(executor & ex, std::size_t ix_b, std::size_t ix_e, std::size_t grain, Fn const & fn)
+	{
+		if (ix_e - ix_b <= grain)
+			return fn(ix_b, ix_e);
+
+		task_group tg(ex);
+		while (grain < ix_e - ix_b)
+		{
+			std::size_t ix_m = ix_b + (ix_e - ix_b)/2;
+			tg.run([&ex, ix_m, ix_e, grain, &fn]() { for_ranges(ex, ix_m, ix_e, grain, fn); });
+			ix_e = ix_m;
+		}
+		fn(ix_b, ix_e);
+		tg.wait();
+	}
+
+	template <class R, class Leaf, class Combine>
+	R reduce_ranges(
+		executor & ex, std::size_t ix_b, std::size_t ix_e, std::size_t grain,
+		R const & identity, Leaf const & leaf, Combine const & combine )
+	{
+		if (ix_e - ix_b <= grain)
+			return leaf(ix_b, ix_e);
+
+		std::size_t ix_m = ix_b + (ix_e - ix_b)/2;
+		R r_hi = identity;
+
+		task_group tg(ex);
+		tg.run([&]() { r_hi = reduce_ranges(ex, ix_m, ix_e, grain, identity, leaf, combine); });
+		R r_lo = reduce_ranges(ex, ix_b, ix_m, grain, identity, leaf, combine);
+		tg.wait();
+
+		return combine(std::move(r_lo), std::move(r_hi));
+	}
+
+	//	Merges the sorted [p_a, p_a_e) and [p_b, p_b_e), moving the elements to p_out. Splits the larger at its
+	//	middle element and the other where that would go, and merges the two pairs in parallel.
+	template <class T, class Less>
+	void merge(
+		executor & ex, T * p_a, T * p_a_e, T * p_b, T * p_b_e, T * p_out,
+		std::size_t grain, Less const & less )
+	{
+		std::size_t cnt_a = p_a_e - p_a;
+		std::size_t cnt_b = p_b_e - p_b;
+		if (cnt_a + cnt_b <= grain)
+		{
+			std::merge(
+				std::make_move_iterator(p_a), std::make_move_iterator(p_a_e),
+				std::make_move_iterator(p_b), std::make_move_iterator(p_b_e),
+				p_out, less );
+			return;
+		}
+
+		//	Equal elements keep a's before b's.
+		T * p_a_m;
+		T * p_b_m;
+		if (cnt_b <= cnt_a)
+		{
+			p_a_m = p_a + cnt_a/2;
+			p_b_m = std::lower_bound(p_b, p_b_e, *p_a_m, less);
+		}
+		else
+		{
+			p_b_m = p_b + cnt_b/2;
+			p_a_m = std::upper_bound(p_a, p_a_e, *p_b_m, less);
+		}
+		T * p_out_m = p_out + (p_a_m - p_a) + (p_b_m - p_b);
+
+		task_group tg(ex);
+		tg.run([&]() { merge(ex, p_a_m, p_a_e, p_b_m, p_b_e, p_out_m, grain, less); });
+		merge(ex, p_a, p_a_m, p_b, p_b_m, p_out, grain, less);
+		tg.wait();
+	}
+
+	//	Sorts [p_b, p_e), leaving the result there if in_place, otherwise at p_tmp, the same size. The halves are
+	//	sorted into the other buffer from the one we want, so each level merges from one to the other with no
+	//	copying back.
+	template <class T, class Less>
+	void sort(executor & ex, T * p_b, T * p_e, T * p_tmp, bool in_place, std::size_t grain, Less const & less)
+	{
+		std::size_t cnt = p_e - p_b;
+		if (cnt <= grain)
+		{
+			std::sort(p_b, p_e, less);
+			if (!in_place)
+				std::move(p_b, p_e, p_tmp);
+			return;
+		}
+
+		std::size_t cnt_lo = cnt/2;
+		{
+			task_group tg(ex);
+			tg.run([&]() { sort(ex, p_b + cnt_lo, p_e, p_tmp + cnt_lo, !in_place, grain, less); });
+			sort(ex, p_b, p_b + cnt_lo, p_tmp, !in_place, grain, less);
+			tg.wait();
+		}
+
+		T * p_src = in_place ? p_tmp : p_b;
+		T * p_dst = in_place ? p_b : p_tmp;
+		merge(ex, p_src, p_src + cnt_lo, p_src + cnt_lo, p_src + cnt, p_dst, grain, less);
+	}
+
+} // namespace qak_parallel_imp_
+namespace qak { //=====================================================================================================|
+
+	//	Calls fn(ix_b, ix_e) for subranges that together cover [ix_b, ix_e) once each, concurrently. Pieces are
+	//	at most grain long, or as described above if grain is 0.
+	template <class Fn>
+	void parallel_for_ranges(executor & ex, std::size_t ix_b, std::size_t ix_e, Fn const & fn, std::size_t grain = 0)
+	{
+		if (ix_b < ix_e)
+			qak_parallel_imp_::for_ranges(ex, ix_b, ix_e, qak_parallel_imp_::auto_grain(ex, ix_e - ix_b, grain), fn);
+	}
+
+	//	Calls fn(ix) for each ix in [ix_b, ix_e).
+	template <class Fn>
+	void parallel_for(executor & ex, std::size_t ix_b, std::size_t ix_e, Fn const & fn, std::size_t grain = 0)
+	{
+		parallel_for_ranges(ex, ix_b, ix_e, [&fn](std::size_t b, std::size_t e) {
+				for (std::size_t ix = b; ix < e; ++ix)
+					fn(ix);
+			},
+			grain );
+	}
+
+	//	Calls fn(elem) for each element of v.
+	template <class T, class Fn>
+	void parallel_for(executor & ex, vector<T> & v, Fn const & fn, std::size_t grain = 0)
+	{
+		T * p = v.data();
+		parallel_for_ranges(ex, 0, v.size(), [p, &fn](std::size_t b, std::size_t e) {
+				for (std::size_t ix = b; ix < e; ++ix)
+					fn(p[ix]);
+			},
+			grain );
+	}
+
+	//	Folds map(ix) for each ix in [ix_b, ix_e) with combine, which must be associative, with identity as its
+	//	identity element. It needn't be commutative: values are combined in index order, only grouped differently.
+	template <class R, class Map, class Combine>
+	R parallel_reduce(
+		executor & ex, std::size_t ix_b, std::size_t ix_e, R const & identity, Map const & map,
+		Combine const & combine, std::size_t grain = 0 )
+	{
+		if (ix_e <= ix_b)
+			return identity;
+
+		return qak_parallel_imp_::reduce_ranges(
+			ex, ix_b, ix_e, qak_parallel_imp_::auto_grain(ex, ix_e - ix_b, grain), identity,
+			[&](std::size_t b, std::size_t e) {
+				R r = identity;
+				for (std::size_t ix = b; ix < e; ++ix)
+					r = combine(std::move(r), map(ix));
+				return r;
+			},
+			combine );
+	}
+
+	//	Folds the elements of v, as above.
+	template <class T, class Combine>
+	T parallel_reduce(executor & ex, vector<T> const & v, T const & identity, Combine const & combine)
+	{
+		T const * p = v.data();
+		return parallel_reduce(ex, 0, v.size(), identity, [p](std::size_t ix) -> T const & { return p[ix]; }, combine);
+	}
+
+	//	Replaces each element of v with the combination of it and all those before it, e.g., with +, the running
+	//	sums. combine must be associative. Two passes: each piece is scanned on its own, then, after a serial scan
+	//	of the pieces' totals, each is combined with the total of those before it.
+	template <class T, class Combine>
+	void parallel_inclusive_scan(executor & ex, vector<T> & v, Combine const & combine)
+	{
+		std::size_t cnt = v.size();
+		T * p = v.data();
+
+		auto scan_piece = [p, &combine](std::size_t b, std::size_t e) {
+			for (std::size_t ix = b + 1; ix < e; ++ix)
+				p[ix] = combine(p[ix - 1], p[ix]);
+		};
+
+		std::size_t grain = qak_parallel_imp_::auto_grain(ex, cnt, 0);
+		if (cnt <= grain)
+			return scan_piece(0, cnt);
+
+		std::size_t cnt_pieces = (cnt + grain - 1)/grain;
+		parallel_for(ex, 0, cnt_pieces, [&](std::size_t ix_piece) {
+				scan_piece(ix_piece*grain, qak::min(cnt, (ix_piece + 1)*grain));
+			},
+			1 );
+
+		//	carries[k] is the total of the pieces before piece k + 1.
+		vector<T> carries;
+		carries.reserve(cnt_pieces - 1);
+		carries.push_back(p[grain - 1]);
+		for (std::size_t ix_piece = 1; ix_piece + 1 < cnt_pieces; ++ix_piece)
+			carries.push_back(combine(carries.back(), p[(ix_piece + 1)*grain - 1]));
+
+		parallel_for(ex, 1, cnt_pieces, [&](std::size_t ix_piece) {
+				T const & carry = carries[ix_piece - 1];
+				std::size_t e = qak::min(cnt, (ix_piece + 1)*grain);
+				for (std::size_t ix = ix_piece*grain; ix < e; ++ix)
+					p[ix] = combine(carry, p[ix]);
+			},
+			1 );
+	}
+
+	//	Sorts v by less, with a merge sort whose merges are parallel too. Not stable. Needs a temporary vector
+	//	the size of v, so T must be default-constructible.
+	template <class T, class Less>
+	void parallel_sort(executor & ex, vector<T> & v, Less const & less)
+	{
+		std::size_t cnt = v.size();
+		std::size_t grain = qak_parallel_imp_::auto_grain(ex, cnt, 0);
+		if (cnt <= grain)
+			return std::sort(v.begin(), v.end(), less);
+
+		vector<T> tmp(cnt);
+		qak_parallel_imp_::sort(ex, v.data(), v.data() + cnt, tmp.data(), true, grain, less);
+	}
+
+	template <class T>
+	void parallel_sort(executor & ex, vector<T> & v)
+	{
+		parallel_sort(ex, v, std::less<T>());
+	}
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_parallel_hxx_INCLUDED_
@@ -25,11 +25,14 @@
 #include "qak/config.hxx"
 #include "qak/vector.hxx"
 
+#include <cstddef> // std::size_t
 #include <cstdint>
 #include <type_traits> // is_integral
 
 namespace qak { //=====================================================================================================|
 
+	struct prng64;
+
 namespace permutation_imp {
 
 	template <int N> struct size_type_of;
@@ -94,6 +97,8 @@ namespace permutation_imp {
 
 		void set_identity();
 		void reset(uint_type n);
+		void reset_random(uint_type n, prng64 & prng);
+		void reset_random_parallel(uint_type n, prng64 & prng, std::size_t cnt_threads);
 		void invert();
 		void extend(uint_type n);
 		void swap_two(uint_type ix_a, uint_type ix_b);
@@ -209,6 +214,20 @@ namespace permutation_imp {
 		//	Resets the permutation to the identity mapping of the specified count of elements.
 		void reset(size_type n) { imp_.reset(n); }
 
+		//	Resets the permutation to a uniformly random mapping of the specified count of elements.
+		//	Fills the forward and reverse mappings together in a single pass.
+		void reset_random(size_type n, prng64 & prng) { assert(0 <= n); imp_.reset_random(to_imp(n), prng); }
+
+		//	Like reset_random(), but spreads the work over multiple threads. Worthwhile for millions of elements.
+		//	A cnt_threads of 0 uses host_info::cnt_threads_recommended(). Small counts are done on the calling thread.
+		//	The result is a function of the prng state, n, and the count of threads actually used, but it will differ
+		//	from what reset_random() produces.
+		void reset_random_parallel(size_type n, prng64 & prng, std::size_t cnt_threads = 0)
+		{
+			assert(0 <= n);
+			imp_.reset_random_parallel(to_imp(n), prng, cnt_threads);
+		}
+
 		//	Modifies the permutation in-place to represent the inverse mapping.
 		//	This amounts to just some pointer swaps in the current implementation.
 		void invert() { imp_.invert(); }
@@ -331,6 +350,28 @@ namespace permutation_imp {
 
 	//-----------------------------------------------------------------------------------------------------------------|
 
+	//	Returns a uniformly random permutation of n elements.
+	template <class size_type_T>
+	inline index_permutation<size_type_T> random_permutation(size_type_T n, prng64 & prng)
+	{
+		index_permutation<size_type_T> p;
+		p.reset_random(n, prng);
+		return p;
+	}
+
+	//	Returns a uniformly random permutation of n elements, generated using multiple threads.
+	//	See index_permutation::reset_random_parallel().
+	template <class size_type_T>
+	inline index_permutation<size_type_T> parallel_random_permutation(
+		size_type_T n,
+		prng64 & prng,
+		std::size_t cnt_threads = 0 )
+	{
+		index_permutation<size_type_T> p;
+		p.reset_random_parallel(n, prng, cnt_threads);
+		return p;
+	}
+
 	//=================================================================================================================|
 
 } // namespace qak ====================================================================================================|
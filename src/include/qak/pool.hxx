@@ -0,0 +1,134 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/pool.hxx"
+//
+//	Pooled allocation of fixed-size blocks, and rpointee_pooled<T>, which gives a class its own pool.
+//
+//	Each thread allocates from its own free list, refilled by carving blocks from slabs it owns. A block freed by a
+//	thread other than the slab's owner is held in a per-owner batch and handed back a batch at a time, so
+//	cross-thread frees (e.g., events produced on one thread and consumed on another) don't contend per block.
+//	Slabs are never returned to the system.
+
+#ifndef qak_pool_hxx_INCLUDED_
+#define qak_pool_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+
+namespace qak_pool_imp_ { //===========================================================================================|
+
+	struct pool_data;
+
+} // namespace qak_pool_imp_
+namespace qak { //=====================================================================================================|
+
+	//	Allocation statistics, summed over all threads.
+	//
+	struct pool_stats
+	{
+		std::uint64_t cnt_allocs;
+
+		//	Includes blocks freed on other threads whose batches have not yet been handed back.
+		std::uint64_t cnt_frees;
+
+		//	Frees made on a thread other than the one that allocated the block.
+		std::uint64_t cnt_remote_frees;
+
+		std::uint64_t cnt_slabs;
+		std::uint64_t cnt_bytes_reserved;
+
+		std::uint64_t cnt_in_use() const { return cnt_allocs - cnt_frees; }
+	};
+
+	//=================================================================================================================|
+
+	//	A pool of blocks of one size. Pools live for the life of the process, so create them with 'new' and
+	//	never delete them.
+	//
+	struct fixed_pool
+	{
+		fixed_pool(std::size_t block_bytes, std::size_t block_align);
+
+		//	Noncopyable, nonmoveable.
+
+		fixed_pool(fixed_pool const &) = delete;
+		fixed_pool(fixed_pool &&) = delete;
+		fixed_pool & operator = (fixed_pool const &) = delete;
+		fixed_pool & operator = (fixed_pool &&) = delete;
+
+		//	Throws std::bad_alloc if a new slab is needed and can't be had.
+		void * allocate();
+
+		//	p may have been allocated by any thread.
+		void deallocate(void * p) QAK_noexcept;
+
+		std::size_t block_size() const QAK_noexcept;
+
+		pool_stats stats() const;
+
+		//	Hands back any partial batches of blocks this thread has freed on behalf of other threads.
+		//	This also happens automatically when the thread exits.
+		void flush_this_thread() QAK_noexcept;
+
+	private:
+		~fixed_pool() = delete;
+
+		qak_pool_imp_::pool_data * p_data_;
+	};
+
+	//=================================================================================================================|
+
+	//	Opt-in mixin giving T a fixed_pool of its own:
+	//
+	//		struct foo : qak::rpointee_base<foo>, qak::rpointee_pooled<foo> { ... };
+	//
+	//	Classes derived from T with a different size fall back to the global operator new.
+	//
+	template <class T>
+	struct rpointee_pooled
+	{
+		static void * operator new (std::size_t sz)
+		{
+			if (sz != sizeof(T))
+				return ::operator new(sz);
+			return the_pool().allocate();
+		}
+
+		static void operator delete (void * p, std::size_t sz) QAK_noexcept
+		{
+			if (sz != sizeof(T))
+				::operator delete(p);
+			else
+				the_pool().deallocate(p);
+		}
+
+		static qak::pool_stats pool_stats() { return the_pool().stats(); }
+
+		static fixed_pool & the_pool()
+		{
+			static fixed_pool & pool = *new fixed_pool(sizeof(T), alignof(T));
+			return pool;
+		}
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_pool_hxx_INCLUDED_
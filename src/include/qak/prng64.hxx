@@ -171,6 +171,23 @@ namespace imp_prng64_ {
 			return gen_imp_<gen_type>()(*this);
 		}
 
+		//	Generate a uniformly distributed value in the range [0, bound) for the specified integral type.
+		//	The bound must be positive.
+		//	Unbiased. Uses Lemire's multiply-and-reject method, so the expected number of draws is barely over 1
+		//	and there's no division except in the rare case of a draw landing in the rejection zone.
+		template <class T> inline T generate_below(T bound)
+		{
+			static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value, "Expecting integral type.");
+			assert(0 < bound);
+
+			typedef typename std::make_unsigned<typename std::remove_cv<T>::type>::type ubound_type;
+			typedef typename std::conditional<
+					sizeof(ubound_type) <= sizeof(std::uint32_t), std::uint32_t, std::uint64_t
+				>::type draw_type;
+
+			return static_cast<T>(below_imp_(static_cast<draw_type>(static_cast<ubound_type>(bound))));
+		}
+
 		//	Swap.
 		void swap(prng64 & that)
 		{
@@ -193,6 +210,49 @@ private:
 			return z_ >> 32;
 		}
 
+		//	Implements generate_below() for bounds up to 32 bits.
+		std::uint32_t below_imp_(std::uint32_t bound)
+		{
+			std::uint64_t m = std::uint64_t(gen32_())*bound;
+			std::uint32_t lo = std::uint32_t(m);
+			if (lo < bound)
+			{
+				std::uint32_t const threshold = std::uint32_t(0u - bound) % bound;
+				while (lo < threshold)
+				{
+					m = std::uint64_t(gen32_())*bound;
+					lo = std::uint32_t(m);
+				}
+			}
+			return std::uint32_t(m >> 32);
+		}
+
+		//	Implements generate_below() for bounds of 33 to 64 bits.
+		std::uint64_t below_imp_(std::uint64_t bound)
+		{
+#if defined(QAK_UINT128_TYPE)
+			typedef QAK_UINT128_TYPE wide_type;
+			wide_type m = wide_type(generate<std::uint64_t>())*bound;
+			std::uint64_t lo = std::uint64_t(m);
+			if (lo < bound)
+			{
+				std::uint64_t const threshold = (0u - bound) % bound;
+				while (lo < threshold)
+				{
+					m = wide_type(generate<std::uint64_t>())*bound;
+					lo = std::uint64_t(m);
+				}
+			}
+			return std::uint64_t(m >> 64);
+#else
+			//	Plain rejection sampling from the largest multiple of the bound.
+			std::uint64_t const threshold = (0u - bound) % bound;
+			std::uint64_t x;
+			do x = generate<std::uint64_t>(); while (x < threshold);
+			return x % bound;
+#endif
+		}
+
 		//	Using class templates here because member template specialization is weird
 		//	and this is technically partial specialization.
 
@@ -0,0 +1,183 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/queue_mutex.hxx"
+//
+//	A fair mutex for heavy contention across many CPUs.
+//
+//	qak::mutex is one word which every waiting thread polls, and whichever thread gets to it first when it's released
+//	wins. That's fine until many CPUs are contending. queue_mutex is a CLH queue lock: an arriving thread appends a
+//	node of its own to a queue and waits on its predecessor's node, each on its own cache line, so threads acquire
+//	in arrival order and a release disturbs only the next thread in line. Waiters spin a while and then park with
+//	atomic::wait. Nodes are recycled through a per-thread cache.
+//
+//	The numa_cohort mode keeps a queue per NUMA node plus a global lock held by whichever node's queue is active.
+//	A thread releasing it passes the global lock directly to the next thread in its node's queue, up to a limit
+//	of consecutive handoffs, so the data it protects tends to stay in one node's caches. Order is FIFO within each
+//	node, and the limit keeps other nodes from starving.
+//
+//	This costs more than qak::mutex without contention; use qak::mutex unless you've measured.
+
+#ifndef qak_queue_mutex_hxx_INCLUDED_
+#define qak_queue_mutex_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/atomic.hxx"
+#include "qak/optional.hxx"
+#include "qak/padded.hxx"
+#include "qak/thread.hxx" // thread_id_t
+
+#include <cstdint> // std::uint32_t
+
+namespace qak_queue_mutex_imp_ { //====================================================================================|
+
+	enum : std::uint32_t {
+		node_released = 0,
+		node_locked = 1,
+		node_locked_parked = 2,     // locked, and the successor is parked waiting on it
+		node_released_global = 3    // released, and the global lock passes to the successor (numa_cohort mode)
+	};
+
+	struct alignas(QAK_CACHE_LINE_SIZE) qnode
+	{
+		qak::atomic<std::uint32_t> state;
+		qnode * p_next_free;
+	};
+
+	//	From and to the calling thread's cache of nodes.
+	qnode * alloc_qnode();
+	void free_qnode(qnode * p) QAK_noexcept;
+
+} // namespace qak_queue_mutex_imp_
+namespace qak { //=====================================================================================================|
+
+	struct queue_mutex;
+	struct queue_mutex_lock;
+
+	enum struct queue_mutex_mode { fifo, numa_cohort };
+
+	//=================================================================================================================|
+
+	//	Nonrecursive, like mutex.
+	//
+	struct queue_mutex
+	{
+		typedef queue_mutex_lock lock_type;
+
+		explicit queue_mutex(queue_mutex_mode mode = queue_mutex_mode::fifo);
+		~queue_mutex();
+
+		//	Noncopyable, nonmoveable.
+
+		queue_mutex(queue_mutex const &) = delete;
+		queue_mutex(queue_mutex &&) = delete;
+		queue_mutex & operator = (queue_mutex const &) = delete;
+		queue_mutex & operator = (queue_mutex &&) = delete;
+
+		//	Blocks forever, or until the mutex is acquired, whichever comes first.
+		//	Throws if the mutex is already locked by the current thread.
+		lock_type lock();
+
+		//	Detects if the mutex is already locked by the calling thread.
+		bool is_locked_by_this_thread() const;
+
+		//	Acquires the mutex iff no thread holds it or is waiting for it. Does not block, except that on rare
+		//	occasions it may find itself in line and wait briefly for its turn.
+		//	Throws if the mutex is already locked by the current thread.
+		optional<lock_type> try_lock();
+
+		queue_mutex_mode mode() const { return cnt_cohorts_ ? queue_mutex_mode::numa_cohort : queue_mutex_mode::fifo; }
+
+	private:
+		friend struct queue_mutex_lock;
+
+		typedef qak_queue_mutex_imp_::qnode qnode;
+
+		struct cohort
+		{
+			atomic<qnode *> p_tail;
+
+			//	Consecutive passes of the global lock within this cohort. Only the holder touches it.
+			unsigned cnt_handoffs;
+		};
+
+		void acquire_(queue_mutex_lock & lk);
+		bool try_acquire_(queue_mutex_lock & lk);
+		void release_(queue_mutex_lock & lk) QAK_noexcept;
+
+		cohort & cohort_for(unsigned cohort_ix) { return *p_cohorts_[cohort_ix]; }
+
+		//	0 in fifo mode, which uses the one queue in p_cohorts_[0] and no global lock.
+		unsigned cnt_cohorts_;
+		padded<cohort> * p_cohorts_;
+
+		//	The global lock of numa_cohort mode. Released by whichever thread holds it last, not necessarily the one
+		//	that acquired it. 0: unlocked, 1: locked, 2: locked and cohort leaders may be parked waiting.
+		atomic<std::uint32_t> global_state_;
+
+		//	The holder's thread ID, or invalid_thread_id_value.
+		atomic<thread_id_t> owner_;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	Like mutex_lock, the existence of a queue_mutex_lock means that a queue_mutex is actually locked, except for
+	//	the source object after a std::move.
+	//
+	struct queue_mutex_lock
+	{
+		//	Blocks forever, or until the mutex is acquired, whichever comes first.
+		explicit queue_mutex_lock(queue_mutex & m);
+
+		//	Noncopyable.
+
+		queue_mutex_lock() = delete;
+		queue_mutex_lock(queue_mutex_lock const &) = delete;
+		queue_mutex_lock & operator = (queue_mutex_lock const &) = delete;
+		queue_mutex_lock & operator = (queue_mutex_lock &&) = delete;
+
+		//	Move-constructable (but be careful).
+		queue_mutex_lock(queue_mutex_lock &&) QAK_noexcept;
+
+		//	Releases the lock held on the mutex.
+		~queue_mutex_lock();
+
+		//	Returns true iff the caller identifies the mutex on which this object holds a lock.
+		bool is_locking(queue_mutex const & m) const { return &m == p_m_; }
+
+	private:
+		friend struct queue_mutex;
+
+		struct private_construct_tag { };
+		explicit queue_mutex_lock(private_construct_tag const &) : p_m_(0), p_node_(0), p_pred_(0), cohort_ix_(0) { }
+
+		queue_mutex * p_m_;
+
+		//	Ours, which our successor waits on. Released when we release the mutex.
+		qak_queue_mutex_imp_::qnode * p_node_;
+
+		//	Our predecessor's, which we wait on. Once we've acquired it's no longer anyone else's, and we recycle
+		//	it when we release the mutex.
+		qak_queue_mutex_imp_::qnode * p_pred_;
+
+		unsigned cohort_ix_;
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_queue_mutex_hxx_INCLUDED_
@@ -26,6 +26,7 @@
 #include "qak/atomic.hxx"
 
 #include <cassert>
+#include <climits> // CHAR_BIT
 #include <cstdint> // std::uintptr_t
 #include <type_traits> // std::is_convertible
 
@@ -36,38 +37,465 @@ namespace qak { //==============================================================
     //	Forward refs.
     //
     template <class T> struct rptr;
+    template <class T> struct weak_rptr;
+    template <class T> struct atomic_rptr;
 
 } // namespace qak
 namespace qak_rptr_imp_ { // ==========================================================================================|
 
-    struct qak_rptr_imp__rpointee_NTB_ // nontemplate base
+    //	Support for weak_rptr, implemented in weak_rptr.cxx.
+    //	Weak references go through a control block which is allocated the first time a weak_rptr is made to an object.
+    //	The control block is found from the address of the object's reference counter.
+
+    struct weak_ctl;
+
+    //	Finds or creates the control block for the counter and adds a weak reference to it.
+    weak_ctl * weak_ctl_acquire(void const * p_refcnt);
+
+    //	Marks the control block of the counter as expired. Called when the strong count reaches zero, but only if a
+    //	weak reference was ever made.
+    void weak_ctl_expire(void const * p_refcnt) QAK_noexcept;
+
+    //	Flag in the count word recording that the object has a control block.
+    //	Strong counts are kept in the bits below it.
+    std::intptr_t const refcnt_weak_flag = std::intptr_t(1) << (sizeof(std::intptr_t)*CHAR_BIT - 2);
+    std::intptr_t const refcnt_cnt_mask = refcnt_weak_flag - 1;
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    //	Reference counters. These are members of the pointee; rptr reaches them through the pointee's base.
+    //	Methods are const on the theory that newly referencing or forgetting an object does not logically change the
+    //	object's state.
+
+    //	Atomic reference count.
+    //
+    //	The increment can be relaxed. A new reference is only ever made from an existing one, which keeps the object
+    //	alive and was itself synchronized with whatever published the object.
+    //	The decrement releases, so that everything done through this reference happens-before the delete. The thread
+    //	that takes the count to zero acquires, so it sees all the other threads' releases.
+    //
+    struct atomic_refcnt
+    {
+        atomic_refcnt() : cnt_(0) { }
+
+#if QAK_HAS_GNUC_ATOMIC_BUILTINS
+
+        void inc() const QAK_noexcept
+        {
+            __atomic_fetch_add(&cnt_, 1, __ATOMIC_RELAXED);
+        }
+
+        //	Returns true iff the count reached zero.
+        bool dec() const QAK_noexcept
+        {
+            std::intptr_t prev = __atomic_fetch_sub(&cnt_, 1, __ATOMIC_RELEASE);
+            if (1 == (prev & refcnt_cnt_mask))
+            {
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (prev & refcnt_weak_flag)
+                    weak_ctl_expire(this);
+                return true;
+            }
+            return false;
+        }
+
+        std::intptr_t load() const QAK_noexcept
+        {
+            return __atomic_load_n(&cnt_, __ATOMIC_RELAXED) & refcnt_cnt_mask;
+        }
+
+        //	Increments the count unless it has already reached zero. Returns true iff it was incremented.
+        bool try_inc() const QAK_noexcept
+        {
+            std::intptr_t c = __atomic_load_n(&cnt_, __ATOMIC_RELAXED);
+            do {
+                if (!(c & refcnt_cnt_mask))
+                    return false;
+            } while (!__atomic_compare_exchange_n(&cnt_, &c, c + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+            return true;
+        }
+
+        void set_weak_flag() const QAK_noexcept
+        {
+            __atomic_fetch_or(&cnt_, refcnt_weak_flag, __ATOMIC_RELAXED);
+        }
+
+    private:
+        std::intptr_t mutable cnt_;
+
+#else // of if QAK_HAS_GNUC_ATOMIC_BUILTINS
+
+        void inc() const QAK_noexcept { cnt_.fetch_add(1, qak::memory_order::relaxed); }
+
+        bool dec() const QAK_noexcept
+        {
+            std::intptr_t prev = cnt_.fetch_sub(1, qak::memory_order::release);
+            if (1 != (prev & refcnt_cnt_mask))
+                return false;
+            qak::atomic_thread_fence(qak::memory_order::acquire);
+            if (prev & refcnt_weak_flag)
+                weak_ctl_expire(this);
+            return true;
+        }
+
+        std::intptr_t load() const QAK_noexcept { return cnt_.load() & refcnt_cnt_mask; }
+
+        bool try_inc() const QAK_noexcept
+        {
+            std::intptr_t c = cnt_.load();
+            do {
+                if (!(c & refcnt_cnt_mask))
+                    return false;
+            } while (!cnt_.compare_exchange_weak(c, c + 1));
+            return true;
+        }
+
+        void set_weak_flag() const QAK_noexcept { cnt_.fetch_or(refcnt_weak_flag, qak::memory_order::relaxed); }
+
+    private:
+        qak::atomic<std::intptr_t> mutable cnt_;
+
+#endif // of else of if QAK_HAS_GNUC_ATOMIC_BUILTINS
+
+        atomic_refcnt(atomic_refcnt const &) = delete;
+        atomic_refcnt & operator = (atomic_refcnt const &) = delete;
+    };
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    //	Single-threaded reference count.
+    //	The count is a plain integer, so every rptr to the object must be created, copied, and destroyed on the thread
+    //	that constructed the object. Debug builds assert this.
+    //
+    struct single_thread_refcnt
+    {
+        single_thread_refcnt() :
+            cnt_(0)
+#ifndef NDEBUG
+          , owner_thread_(current_thread_id_())
+#endif
+        { }
+
+        void inc() const QAK_noexcept
+        {
+            assert(is_owner_thread_() || !"single-threaded rpointee referenced from another thread");
+            ++cnt_;
+        }
+
+        //	Returns true iff the count reached zero.
+        bool dec() const QAK_noexcept
+        {
+            assert(is_owner_thread_() || !"single-threaded rpointee released from another thread");
+            std::intptr_t c = --cnt_;
+            if (c & refcnt_cnt_mask)
+                return false;
+            if (c & refcnt_weak_flag)
+                weak_ctl_expire(this);
+            return true;
+        }
+
+        std::intptr_t load() const QAK_noexcept
+        {
+            assert(is_owner_thread_() || !"single-threaded rpointee examined from another thread");
+            return cnt_ & refcnt_cnt_mask;
+        }
+
+        //	Increments the count unless it has already reached zero. Returns true iff it was incremented.
+        bool try_inc() const QAK_noexcept
+        {
+            assert(is_owner_thread_() || !"single-threaded rpointee referenced from another thread");
+            if (!(cnt_ & refcnt_cnt_mask))
+                return false;
+            ++cnt_;
+            return true;
+        }
+
+        void set_weak_flag() const QAK_noexcept { cnt_ |= refcnt_weak_flag; }
+
+    private:
+        std::intptr_t mutable cnt_;
+
+#ifndef NDEBUG
+        //	Identifies the thread that constructed the object.
+        std::uintptr_t const owner_thread_;
+
+        static std::uintptr_t current_thread_id_() QAK_noexcept;
+        bool is_owner_thread_() const QAK_noexcept { return current_thread_id_() == owner_thread_; }
+#endif
+
+        single_thread_refcnt(single_thread_refcnt const &) = delete;
+        single_thread_refcnt & operator = (single_thread_refcnt const &) = delete;
+    };
+
+#if QAK_HAS_GNUC_ATOMIC_BUILTINS
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    //	Biased reference count, after Choi, Shull, and Torrellas, "Biased Reference Counting" (PACT 2018).
+    //
+    //	The thread that constructs the object is its owner. The owner's references are counted in a plain integer,
+    //	everyone else's in an atomic shared count. When the owner's count drops to zero the two are merged and from
+    //	then on all threads use the shared count.
+    //
+    //	If references made by the owner are released by other threads, the shared count goes negative. The object
+    //	is then queued for the owner to merge, which it does when it next constructs a biased object, when it calls
+    //	qak::refcnt_biased_merge_queued(), or when it exits.
+    //
+    //	weak_rptr is not supported.
+    //
+    struct biased_refcnt;
+
+    //	Per-thread state for biased reference counts, in rptr.cxx. Never freed, so never confused with a newer thread.
+    struct biased_owner;
+
+    //	The calling thread's biased_owner, or null if it has never constructed a biased object. It's read on every
+    //	inc and dec, so it's __thread rather than thread_local: that can't have a dynamic initializer, so reading it
+    //	is a plain TLS load instead of a call through the thread_local initialization wrapper.
+    extern __thread biased_owner * biased_this_thread_owner;
+
+    //	Returns the calling thread's biased_owner, creating it if needed, after merging anything queued for it.
+    biased_owner * biased_owner_construct();
+
+    //	Queues the counter for its owner to merge.
+    void biased_enqueue(biased_owner * p_owner,
+        biased_refcnt const * p_refcnt, void (* fn_destroy)(void const *), void const * p_obj) QAK_noexcept;
+
+    struct biased_refcnt
+    {
+        biased_refcnt() :
+            owner_(biased_owner_construct()), biased_(0), shared_(0), fn_destroy_(0), p_obj_(0), p_queue_next_(0)
+        { }
+
+        void inc() const QAK_noexcept
+        {
+            if (is_owner_thread_())
+            {
+                std::intptr_t b = load_biased_();
+                if (0 < b)
+                {
+                    store_biased_(b + 1);
+                    return;
+                }
+                if (!b)
+                {
+                    //	The owner's first reference.
+                    __atomic_fetch_or(&shared_, owner_used, __ATOMIC_RELAXED);
+                    store_biased_(1);
+                    return;
+                }
+            }
+
+            __atomic_fetch_add(&shared_, cnt_one, __ATOMIC_RELAXED);
+        }
+
+        //	Returns true iff the count reached zero. If the object needs its owner to merge it, it's queued with
+        //	fn_destroy(p_obj) to be called if the merged count is zero.
+        bool dec(void (* fn_destroy)(void const *), void const * p_obj) const QAK_noexcept
+        {
+            if (is_owner_thread_())
+            {
+                std::intptr_t b = load_biased_();
+                if (1 < b)
+                {
+                    store_biased_(b - 1);
+                    return false;
+                }
+                if (1 == b)
+                {
+                    //	Merge. A queued object is left for its queue entry to destroy.
+                    store_biased_(-1);
+                    std::intptr_t prev = __atomic_fetch_or(&shared_, merged, __ATOMIC_ACQ_REL);
+                    return !(prev & queued) && !(prev >> flag_bits);
+                }
+
+                //	A reference the owner received from another thread, or the count is already merged.
+            }
+
+            std::intptr_t prev = __atomic_fetch_sub(&shared_, cnt_one, __ATOMIC_RELEASE);
+            std::intptr_t cnt = (prev >> flag_bits) - 1;
+
+            if ((prev & merged) || !(prev & owner_used))
+            {
+                if (cnt || (prev & queued))
+                    return false;
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                return true;
+            }
+
+            //	The owner holds some references that were released here.
+            if (cnt < 0 && !(prev & queued) && !(__atomic_fetch_or(&shared_, queued, __ATOMIC_RELAXED) & queued))
+                biased_enqueue(owner_, this, fn_destroy, p_obj);
+            return false;
+        }
+
+        //	Exact on the owner thread, approximate elsewhere.
+        std::intptr_t load() const QAK_noexcept
+        {
+            std::intptr_t b = load_biased_();
+            return (0 < b ? b : 0) + (__atomic_load_n(&shared_, __ATOMIC_RELAXED) >> flag_bits);
+        }
+
+    private:
+        friend struct biased_owner;
+
+        static std::intptr_t const merged = 1;
+        static std::intptr_t const queued = 2;
+        static std::intptr_t const owner_used = 4;
+        static int const flag_bits = 3;
+        static std::intptr_t const cnt_one = std::intptr_t(1) << flag_bits;
+
+        bool is_owner_thread_() const QAK_noexcept { return biased_this_thread_owner == owner_; }
+
+        //	Only the owner writes biased_, but others may read it for load(). Relaxed loads and stores compile to
+        //	plain moves.
+        std::intptr_t load_biased_() const QAK_noexcept { return __atomic_load_n(&biased_, __ATOMIC_RELAXED); }
+        void store_biased_(std::intptr_t b) const QAK_noexcept { __atomic_store_n(&biased_, b, __ATOMIC_RELAXED); }
+
+        //	Called by the owner, or by any thread once the owner has exited.
+        //	Returns true iff the merged count is zero.
+        bool merge_queued_() const QAK_noexcept;
+
+        biased_owner * const owner_;
+
+        //	The owner's count. 0 until the owner's first reference, -1 once merged.
+        std::intptr_t mutable biased_;
+
+        //	Everyone else's count, shifted left by flag_bits, plus flags.
+        std::intptr_t mutable shared_;
+
+        //	The counter's entry in its owner's queue. A counter is queued at most once, as it's merged by the time
+        //	it leaves the queue, so enqueueing never needs to allocate.
+        mutable void (* fn_destroy_)(void const *);
+        mutable void const * p_obj_;
+        mutable biased_refcnt const * p_queue_next_;
+
+        biased_refcnt(biased_refcnt const &) = delete;
+        biased_refcnt & operator = (biased_refcnt const &) = delete;
+    };
+
+#endif // QAK_HAS_GNUC_ATOMIC_BUILTINS
+
+    //	Decrements the counter and returns true iff the object should be destroyed.
+    //	Only biased_refcnt needs to know how to destroy the object later.
+    template <class refcnt_T> inline
+    bool refcnt_dec(refcnt_T const & refcnt, void (*)(void const *), void const *) QAK_noexcept
+    {
+        return refcnt.dec();
+    }
+
+#if QAK_HAS_GNUC_ATOMIC_BUILTINS
+    inline bool refcnt_dec(biased_refcnt const & refcnt, void (* fn_destroy)(void const *), void const * p_obj) QAK_noexcept
+    {
+        return refcnt.dec(fn_destroy, p_obj);
+    }
+#endif
+
+    //=================================================================================================================|
+
+    //	Nontemplate bases for rpointee_base, one per reference counter type.
+    //	The refcount lives in the virtual base so that a whole class hierarchy shares a single count.
+    //
+    template <class refcnt_T>
+    struct qak_rptr_imp__rpointee_NTB_imp_
     {
-        virtual ~qak_rptr_imp__rpointee_NTB_() { }
+        virtual ~qak_rptr_imp__rpointee_NTB_imp_() { }
 
     protected:
 
         //	Default constructible.
-        qak_rptr_imp__rpointee_NTB_() { }
+        qak_rptr_imp__rpointee_NTB_imp_() { }
 
     private:
 
-        template <class T> friend struct rpointee_base;
+        template <class T, class P> friend struct rpointee_base;
         template <class T> friend struct qak::rptr;
 
-        //	These are const on the theory that newly referencing or forgetting
-        //	an object does not logically change the object's state.
-        void tpointee_inc_ref_() const QAK_noexcept;
-        void tpointee_dec_ref_() const QAK_noexcept;
+        void tpointee_inc_ref_() const QAK_noexcept { qak_rptr_imp__refcnt_.inc(); }
+
+        void tpointee_dec_ref_() const QAK_noexcept
+        {
+            if (refcnt_dec(qak_rptr_imp__refcnt_, &destroy_, this))
+                delete this;
+        }
+
+        static void destroy_(void const * p) QAK_noexcept
+        {
+            delete static_cast<qak_rptr_imp__rpointee_NTB_imp_ const *>(p);
+        }
+
+        std::intptr_t tpointee_use_count_() const QAK_noexcept { return qak_rptr_imp__refcnt_.load(); }
+
+        //	Support for weak_rptr.
+        template <class T> friend struct qak::weak_rptr;
+
+        bool tpointee_try_inc_ref_() const QAK_noexcept { return qak_rptr_imp__refcnt_.try_inc(); }
+
+        //	The flag goes up only once the control block is in the table, as the last release expires it from there.
+        weak_ctl * tpointee_weak_ctl_acquire_() const
+        {
+            weak_ctl * p_ctl = weak_ctl_acquire(&qak_rptr_imp__refcnt_);
+            qak_rptr_imp__refcnt_.set_weak_flag();
+            return p_ctl;
+        }
 
         //	Reference count.
-        qak::atomic<std::intptr_t> qak_rptr_imp__refcnt_;
+        refcnt_T qak_rptr_imp__refcnt_;
 
         //	Noncopyable and nonmoveable.
     private:
-        qak_rptr_imp__rpointee_NTB_(qak_rptr_imp__rpointee_NTB_ const &) = delete;
-        qak_rptr_imp__rpointee_NTB_(qak_rptr_imp__rpointee_NTB_ &&) = delete;
-        qak_rptr_imp__rpointee_NTB_ & operator = (qak_rptr_imp__rpointee_NTB_ const &) = delete;
-        qak_rptr_imp__rpointee_NTB_ & operator = (qak_rptr_imp__rpointee_NTB_ &&) = delete;
+        qak_rptr_imp__rpointee_NTB_imp_(qak_rptr_imp__rpointee_NTB_imp_ const &) = delete;
+        qak_rptr_imp__rpointee_NTB_imp_(qak_rptr_imp__rpointee_NTB_imp_ &&) = delete;
+        qak_rptr_imp__rpointee_NTB_imp_ & operator = (qak_rptr_imp__rpointee_NTB_imp_ const &) = delete;
+        qak_rptr_imp__rpointee_NTB_imp_ & operator = (qak_rptr_imp__rpointee_NTB_imp_ &&) = delete;
+    };
+
+    typedef qak_rptr_imp__rpointee_NTB_imp_<atomic_refcnt> qak_rptr_imp__rpointee_NTB_;
+    typedef qak_rptr_imp__rpointee_NTB_imp_<single_thread_refcnt> qak_rptr_imp__rpointee_st_NTB_;
+
+    extern template struct qak_rptr_imp__rpointee_NTB_imp_<atomic_refcnt>;
+    extern template struct qak_rptr_imp__rpointee_NTB_imp_<single_thread_refcnt>;
+
+#if QAK_HAS_GNUC_ATOMIC_BUILTINS
+    //	Not explicitly instantiated, since it lacks the weak_rptr support.
+    typedef qak_rptr_imp__rpointee_NTB_imp_<biased_refcnt> qak_rptr_imp__rpointee_biased_NTB_;
+#endif
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    //	Empty base identifying rpointee_final classes.
+    struct qak_rptr_imp__rpointee_final_tag_ { };
+
+    //=================================================================================================================|
+
+    //	Reference counting policies for rpointee_base and rpointee_final.
+
+    //	The default. The refcount is atomic, so the object may be shared between threads.
+    struct refcnt_atomic
+    {
+        typedef atomic_refcnt refcnt_type;
+        typedef qak_rptr_imp__rpointee_NTB_ ntb_type;
+    };
+
+    //	The refcount is a plain integer. For objects that never leave the thread that constructed them,
+    //	e.g., parse trees and per-request data. Saves a locked instruction on every rptr copy and destruction.
+    struct refcnt_single_thread
+    {
+        typedef single_thread_refcnt refcnt_type;
+        typedef qak_rptr_imp__rpointee_st_NTB_ ntb_type;
+    };
+
+    //	Biased toward the thread that constructs the object: its references are counted without atomic operations,
+    //	and other threads' with them. For objects that are mostly, but not only, used by the thread that made them.
+    //	Where the compiler lacks the GNU atomic builtins, this is the same as refcnt_atomic.
+    struct refcnt_biased
+    {
+#if QAK_HAS_GNUC_ATOMIC_BUILTINS
+        typedef biased_refcnt refcnt_type;
+        typedef qak_rptr_imp__rpointee_biased_NTB_ ntb_type;
+#else
+        typedef atomic_refcnt refcnt_type;
+        typedef qak_rptr_imp__rpointee_NTB_ ntb_type;
+#endif
     };
 
     //=================================================================================================================|
@@ -76,9 +504,11 @@ namespace qak_rptr_imp_ { // ===================================================
     //	It's in a special namespace to prevent ADL surprises with the derived types.
     //	It will cause pointee classes to have a vtable and be noncopyable and nonmoveable.
     //	Destruction will be performed via the virtual destructor.
+    //	The refcnt_policy_T determines how the reference count is maintained. All classes in a hierarchy share the
+    //	policy of the first rpointee_base.
     //
-    template <class T>
-    struct rpointee_base : virtual qak_rptr_imp__rpointee_NTB_
+    template <class T, class refcnt_policy_T = refcnt_atomic>
+    struct rpointee_base : virtual refcnt_policy_T::ntb_type
     {
         //	Add some handy typedefs to rpointee classes.
         typedef qak::rptr<T> RP;
@@ -107,6 +537,70 @@ namespace qak_rptr_imp_ { // ===================================================
         typedef qak::rptr<T const> RPC;
     };
 
+    //=================================================================================================================|
+
+    //	Inherit from qak::rpointee_final to enable management by rptr of a class T which is declared 'final'.
+    //	It's leaner than rpointee_base: no vtable, no virtual base, just the refcount word at a fixed offset.
+    //	Destruction is performed by deleting through a T *, so T's destructor must be accessible to rptr.
+    //	Intended for small, hot types such as events and buffers.
+    //
+    template <class T, class refcnt_policy_T = refcnt_atomic>
+    struct rpointee_final : qak_rptr_imp__rpointee_final_tag_
+    {
+        //	Add some handy typedefs to rpointee classes.
+        typedef qak::rptr<T> RP;
+        typedef qak::rptr<T const> RPC;
+
+    protected:
+        rpointee_final() = default;
+
+        //	Not virtual. Protected, so the object can't be deleted through this base.
+        ~rpointee_final() = default;
+
+    private:
+
+        template <class U> friend struct qak::rptr;
+
+        void tpointee_inc_ref_() const QAK_noexcept { qak_rptr_imp__refcnt_.inc(); }
+
+        void tpointee_dec_ref_() const QAK_noexcept
+        {
+            static_assert(std::is_final<T>::value, "T should be declared 'final' to derive from rpointee_final<T>");
+            static_assert(std::is_base_of<rpointee_final, T>::value, "T should be derived from rpointee_final<T>");
+
+            if (refcnt_dec(qak_rptr_imp__refcnt_, &destroy_, this))
+                delete static_cast<T const *>(this);
+        }
+
+        static void destroy_(void const * p) QAK_noexcept
+        {
+            delete static_cast<T const *>(static_cast<rpointee_final const *>(p));
+        }
+
+        std::intptr_t tpointee_use_count_() const QAK_noexcept { return qak_rptr_imp__refcnt_.load(); }
+
+        //	Support for weak_rptr.
+        template <class U> friend struct qak::weak_rptr;
+
+        bool tpointee_try_inc_ref_() const QAK_noexcept { return qak_rptr_imp__refcnt_.try_inc(); }
+
+        //	The flag goes up only once the control block is in the table, as the last release expires it from there.
+        weak_ctl * tpointee_weak_ctl_acquire_() const
+        {
+            weak_ctl * p_ctl = weak_ctl_acquire(&qak_rptr_imp__refcnt_);
+            qak_rptr_imp__refcnt_.set_weak_flag();
+            return p_ctl;
+        }
+
+        //	Reference count.
+        typename refcnt_policy_T::refcnt_type qak_rptr_imp__refcnt_;
+
+        rpointee_final(rpointee_final const &) = delete;
+        rpointee_final(rpointee_final &&) = delete;
+        rpointee_final & operator = (rpointee_final const &) = delete;
+        rpointee_final & operator = (rpointee_final &&) = delete;
+    };
+
 } // namespace qak_rptr_imp_
 namespace qak { //=====================================================================================================|
 
@@ -115,6 +609,15 @@ namespace qak { //==============================================================
     //
     using qak_rptr_imp_::rpointee_base;
     using qak_rptr_imp_::rpointee_derived;
+    using qak_rptr_imp_::rpointee_final;
+    using qak_rptr_imp_::refcnt_atomic;
+    using qak_rptr_imp_::refcnt_single_thread;
+    using qak_rptr_imp_::refcnt_biased;
+
+    //	Merges any biased reference counts owned by the calling thread that other threads have queued for it.
+    //	Long-lived threads that hand objects off to other threads may call this at convenient points, e.g., once per
+    //	event loop iteration. It also happens when the thread constructs a refcnt_biased object and when it exits.
+    void refcnt_biased_merge_queued() QAK_noexcept;
 
     //	Intrusive strong-reference smart pointer with an interface modeled on std::shared_ptr.
     //
@@ -123,8 +626,11 @@ namespace qak { //==============================================================
     {
         //static_assert(std::is_base_of<rpointee_base<T>, T>::value, "T should be dervied from qak::rpointee_base<T>");
         static_assert(
-            std::is_base_of<qak_rptr_imp_::qak_rptr_imp__rpointee_NTB_, T>::value,
-            "T should be dervied from qak::rpointee_base<T>" );
+               std::is_base_of<qak_rptr_imp_::qak_rptr_imp__rpointee_NTB_, T>::value
+            || std::is_base_of<qak_rptr_imp_::qak_rptr_imp__rpointee_st_NTB_, T>::value
+            || std::is_base_of<qak_rptr_imp_::refcnt_biased::ntb_type, T>::value
+            || std::is_base_of<qak_rptr_imp_::qak_rptr_imp__rpointee_final_tag_, T>::value,
+            "T should be dervied from qak::rpointee_base<T> or qak::rpointee_final<T>" );
 
         typedef T element_type;
 
@@ -380,7 +886,7 @@ namespace qak { //==============================================================
 
         std::ptrdiff_t use_count() const QAK_noexcept
         {
-            return p_ ? p_->qak_rptr_imp__refcnt_.load() : 0;
+            return p_ ? p_->tpointee_use_count_() : 0;
         }
 
         bool unique() const QAK_noexcept
@@ -416,6 +922,12 @@ namespace qak { //==============================================================
     private:
 
         template <class U> friend struct rptr;
+        template <class U> friend struct weak_rptr;
+        template <class U> friend struct atomic_rptr;
+
+        //	Takes ownership of a reference the caller has already counted.
+        struct adopt_tag_ { };
+        rptr(T * p, adopt_tag_) QAK_noexcept : p_(p) { }
 
         T * p_;
 
@@ -0,0 +1,101 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/semaphore.hxx"
+//
+//	A counting semaphore: a count of permits which release adds to and acquire takes from, waiting for one if there
+//	are none. Unlike a mutex, any thread may release, and the releaser needn't have acquired.
+//
+//	Acquiring and releasing without contention are each an atomic RMW, inline. A thread finding no permits spins
+//	a while, then parks on the count with atomic::wait.
+
+#ifndef qak_semaphore_hxx_INCLUDED_
+#define qak_semaphore_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/atomic.hxx"
+
+#include <cstdint> // std::int64_t, std::uint32_t, std::uint64_t
+
+namespace qak { //=====================================================================================================|
+
+	struct semaphore
+	{
+		explicit semaphore(std::uint32_t cnt_initial = 0) : cnt_(cnt_initial), cnt_waiters_(0) { }
+
+		//	Noncopyable, nonmoveable.
+
+		semaphore(semaphore const &) = delete;
+		semaphore(semaphore &&) = delete;
+		semaphore & operator = (semaphore const &) = delete;
+		semaphore & operator = (semaphore &&) = delete;
+
+		//	Takes a permit, blocking until one is available.
+		void acquire() QAK_noexcept
+		{
+			if (!try_acquire())
+				acquire_contended_(no_deadline);
+		}
+
+		//	Takes a permit iff one is available. Does not block.
+		bool try_acquire() QAK_noexcept
+		{
+			std::uint32_t cnt = cnt_.load(memory_order::relaxed);
+			while (cnt)
+				if (cnt_.compare_exchange_weak(cnt, cnt - 1, memory_order::acquire, memory_order::relaxed))
+					return true;
+			return false;
+		}
+
+		//	As acquire, but gives up after max_wait_ns or at deadline_ns, a time_source::wallclock_ns reading (see
+		//	now.hxx). Returns false iff it gave up.
+		bool try_acquire_for_ns(std::int64_t max_wait_ns);
+		bool try_acquire_until_ns(std::uint64_t deadline_ns) QAK_noexcept
+		{
+			return try_acquire() || acquire_contended_(deadline_ns);
+		}
+
+		//	Adds cnt permits, waking as many waiting threads.
+		void release(std::uint32_t cnt = 1) QAK_noexcept
+		{
+			//	Seq_cst on both sides, so either we see the waiter or it sees the permit.
+			cnt_.fetch_add(cnt, memory_order::seq_cst);
+			if (cnt_waiters_.load(memory_order::seq_cst))
+			{
+				if (cnt == 1)
+					cnt_.notify_one();
+				else
+					cnt_.notify_all();
+			}
+		}
+
+		//	The count of permits available. Only a hint by the time the caller looks at it.
+		std::uint32_t cnt_available() const QAK_noexcept { return cnt_.load(memory_order::relaxed); }
+
+	private:
+		static std::uint64_t const no_deadline = ~std::uint64_t(0);
+
+		atomic<std::uint32_t> cnt_;
+		atomic<std::uint32_t> cnt_waiters_;
+
+		bool acquire_contended_(std::uint64_t deadline_ns) QAK_noexcept;
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_semaphore_hxx_INCLUDED_
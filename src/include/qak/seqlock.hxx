@@ -0,0 +1,179 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/seqlock.hxx"
+//
+//	A T that any thread can read without a lock, for small read-mostly data like cached settings or statistics
+//	snapshots.
+//
+//	A writer makes a sequence number odd, copies in the new value, then makes it even again. A reader notes the
+//	sequence number, copies the value out, and checks the number didn't change; if it did (or was odd) the copy may
+//	be torn, and it tries again. So readers write nothing shared and don't slow each other down, but a reader can
+//	be made to retry by a stream of writes. Writers are serialized with each other.
+//
+//	The value is kept as an array of atomic words, so the racing copy is well-defined. T must be trivially copyable
+//	and default constructible.
+
+#ifndef qak_seqlock_hxx_INCLUDED_
+#define qak_seqlock_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/atomic.hxx"
+#include "qak/imp/spin_wait.hxx"
+
+#include <cstdint> // std::uint32_t, std::uintptr_t
+#include <cstring> // std::memcpy
+#include <type_traits> // std::is_trivially_copyable
+
+namespace qak_seqlock_imp_ { //========================================================================================|
+
+	//	A writer is normally done in a moment, so wait for one by spinning briefly before parking.
+	unsigned const cnt_spins_before_parking = 64;
+
+} // namespace qak_seqlock_imp_
+namespace qak { //=====================================================================================================|
+
+	template <class T>
+	struct seqlock
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "requires a trivially copyable type.");
+
+		//	Holds a T of all zero bytes.
+		seqlock() QAK_noexcept : seq_(0) { }
+
+		explicit seqlock(T const & t) QAK_noexcept : seq_(0) { write_words_(t); }
+
+		//	Noncopyable, nonmoveable.
+
+		seqlock(seqlock const &) = delete;
+		seqlock(seqlock &&) = delete;
+		seqlock & operator = (seqlock const &) = delete;
+		seqlock & operator = (seqlock &&) = delete;
+
+		//	Returns a consistent copy of the value most recently stored. Lock-free unless a writer stalls
+		//	partway, in which case readers park until it's done.
+		T load() const QAK_noexcept
+		{
+			word_t buf[cnt_words];
+			for (unsigned cnt_tries = 1; ; ++cnt_tries)
+			{
+				std::uint32_t seq = seq_.load(memory_order::acquire);
+				if (!(seq & 1))
+				{
+					//	Acquire loads keep the recheck of seq_ from moving up ahead of them.
+					for (std::size_t ix = 0; ix < cnt_words; ++ix)
+						buf[ix] = words_[ix].load(memory_order::acquire);
+
+					if (seq_.load(memory_order::relaxed) == seq)
+						break;
+				}
+				else if (qak_seqlock_imp_::cnt_spins_before_parking < cnt_tries)
+					seq_.wait(seq, memory_order::relaxed);
+				else
+					spin_pause();
+			}
+
+			T t;
+			std::memcpy(&t, buf, sizeof(T));
+			return t;
+		}
+
+		//	Replaces the value.
+		void store(T const & t) QAK_noexcept
+		{
+			std::uint32_t seq = begin_write_();
+			write_words_(t);
+			end_write_(seq);
+		}
+
+		//	Calls fn(T &) with the current value and stores the result, with no other writes in between. Readers
+		//	wait while fn runs, so keep it short. If fn throws, the value is unchanged.
+		template <class Fn>
+		void update(Fn && fn)
+		{
+			write_guard guard(*this);
+			T t = read_words_();
+			fn(t);
+			write_words_(t);
+		}
+
+	private:
+		typedef std::uintptr_t word_t;
+		static std::size_t const cnt_words = (sizeof(T) + sizeof(word_t) - 1)/sizeof(word_t);
+
+		//	Even when no write is in progress.
+		atomic<std::uint32_t> seq_;
+		atomic<word_t> words_[cnt_words];
+
+		//	Returns the odd sequence number taken.
+		std::uint32_t begin_write_() QAK_noexcept
+		{
+			for (unsigned cnt_tries = 1; ; ++cnt_tries)
+			{
+				std::uint32_t seq = seq_.load(memory_order::relaxed);
+				if (!(seq & 1))
+				{
+					if (seq_.compare_exchange_weak(seq, seq + 1, memory_order::acquire, memory_order::relaxed))
+						return seq + 1;
+				}
+				else if (qak_seqlock_imp_::cnt_spins_before_parking < cnt_tries)
+					seq_.wait(seq, memory_order::relaxed);
+				else
+					spin_pause();
+			}
+		}
+
+		void end_write_(std::uint32_t seq) QAK_noexcept
+		{
+			seq_.store(seq + 1, memory_order::release);
+			seq_.notify_all();
+		}
+
+		struct write_guard
+		{
+			seqlock & sl;
+			std::uint32_t seq;
+			explicit write_guard(seqlock & sl_in) : sl(sl_in), seq(sl_in.begin_write_()) { }
+			~write_guard() { sl.end_write_(seq); }
+		};
+
+		//	Release stores keep them from moving up ahead of the odd sequence number.
+		void write_words_(T const & t) QAK_noexcept
+		{
+			word_t buf[cnt_words] = { };
+			std::memcpy(buf, &t, sizeof(T));
+			for (std::size_t ix = 0; ix < cnt_words; ++ix)
+				words_[ix].store(buf[ix], memory_order::release);
+		}
+
+		//	For the writer, so no other writes are in progress.
+		T read_words_() const QAK_noexcept
+		{
+			word_t buf[cnt_words];
+			for (std::size_t ix = 0; ix < cnt_words; ++ix)
+				buf[ix] = words_[ix].load(memory_order::relaxed);
+
+			T t;
+			std::memcpy(&t, buf, sizeof(T));
+			return t;
+		}
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_seqlock_hxx_INCLUDED_
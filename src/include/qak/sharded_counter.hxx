@@ -0,0 +1,95 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/sharded_counter.hxx"
+//
+//	A counter for statistics which many threads bump and few read, e.g., requests served or bytes written.
+//
+//	A single atomic counter bounces its cache line between every CPU that increments it. This one has a padded slot
+//	per shard, about one per CPU, and each thread sticks to one shard, so threads mostly increment lines no other
+//	CPU is writing. Increments are relaxed. Reading has to visit every shard, so it's the slow side.
+
+#ifndef qak_sharded_counter_hxx_INCLUDED_
+#define qak_sharded_counter_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/atomic.hxx"
+#include "qak/padded.hxx"
+
+#include <cstdint> // std::uint64_t
+
+namespace qak_sharded_counter_imp_ { //================================================================================|
+
+	//	One plus the calling thread's shard number, or zero if not yet assigned.
+	extern thread_local unsigned tls_shard_ix_plus_1;
+
+	unsigned assign_shard_ix();
+
+	inline unsigned this_thread_shard_ix()
+	{
+		unsigned u = tls_shard_ix_plus_1;
+		return u ? u - 1 : assign_shard_ix();
+	}
+
+} // namespace qak_sharded_counter_imp_
+namespace qak { //=====================================================================================================|
+
+	struct sharded_counter
+	{
+		//	The count of shards is the count of configured CPUs rounded up to a power of 2.
+		sharded_counter();
+
+		~sharded_counter();
+
+		//	Noncopyable, nonmoveable.
+
+		sharded_counter(sharded_counter const &) = delete;
+		sharded_counter(sharded_counter &&) = delete;
+		sharded_counter & operator = (sharded_counter const &) = delete;
+		sharded_counter & operator = (sharded_counter &&) = delete;
+
+		void add(std::uint64_t n) QAK_noexcept
+		{
+			shard & sh = p_shards_[qak_sharded_counter_imp_::this_thread_shard_ix() & shard_ix_mask_];
+			sh->fetch_add(n, memory_order::relaxed);
+		}
+
+		void operator ++ () QAK_noexcept { add(1); }
+		void operator += (std::uint64_t n) QAK_noexcept { add(n); }
+
+		//	The total. While other threads are adding, it counts some of their increments and not others, so it's
+		//	approximate; once they have stopped (e.g., after joining them), it's exact.
+		std::uint64_t sum() const QAK_noexcept;
+
+		//	Returns the total and resets the counter to zero, shard by shard. Increments made concurrently go to
+		//	either this call or the next, so successive drains count every increment exactly once. For periodic
+		//	reporting of rates.
+		std::uint64_t drain() QAK_noexcept;
+
+		unsigned cnt_shards() const QAK_noexcept { return shard_ix_mask_ + 1; }
+
+	private:
+		typedef padded<atomic<std::uint64_t>> shard;
+
+		unsigned shard_ix_mask_;
+		shard * p_shards_;
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_sharded_counter_hxx_INCLUDED_
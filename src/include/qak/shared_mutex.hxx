@@ -0,0 +1,267 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/shared_mutex.hxx"
+//
+//	A reader-writer lock for read-mostly data.
+//
+//	Readers don't share a counter. Each thread counts itself in on one of a set of padded shards, about one per CPU
+//	(the same assignment sharded_counter uses), so readers on different CPUs don't bounce a cache line between them.
+//	A writer first takes a qak::mutex that serializes writers, then raises a flag that turns new readers away, then
+//	waits for every shard to drain. So acquiring exclusively costs time proportional to the number of CPUs, and
+//	writers are preferred: a steady stream of readers can't starve them. Readers and writers park with atomic::wait.
+//
+//	Neither kind of lock is recursive. A thread holding a shared lock mustn't take another on the same shared_mutex,
+//	since a writer may arrive in between.
+
+#ifndef qak_shared_mutex_hxx_INCLUDED_
+#define qak_shared_mutex_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/atomic.hxx"
+#include "qak/mutex.hxx"
+#include "qak/optional.hxx"
+#include "qak/padded.hxx"
+#include "qak/sharded_counter.hxx" // qak_sharded_counter_imp_::this_thread_shard_ix
+
+#include <cstdint> // std::uint32_t
+
+namespace qak { //=====================================================================================================|
+
+	struct shared_mutex;
+	struct shared_lock;
+	struct unique_lock;
+
+	//=================================================================================================================|
+
+	struct shared_mutex
+	{
+		typedef shared_lock shared_lock_type;
+		typedef unique_lock unique_lock_type;
+
+		shared_mutex();
+		~shared_mutex();
+
+		//	Noncopyable, nonmoveable.
+
+		shared_mutex(shared_mutex const &) = delete;
+		shared_mutex(shared_mutex &&) = delete;
+		shared_mutex & operator = (shared_mutex const &) = delete;
+		shared_mutex & operator = (shared_mutex &&) = delete;
+
+		//	Acquires exclusively. Blocks forever, or until no other thread holds any lock on it.
+		//	Throws if the mutex is already locked exclusively by the current thread.
+		unique_lock_type lock();
+
+		//	Acquires exclusively iff no thread holds any lock on it. Does not block.
+		//	Throws if the mutex is already locked exclusively by the current thread.
+		optional<unique_lock_type> try_lock();
+
+		//	Detects if the mutex is locked exclusively by the calling thread.
+		bool is_locked_by_this_thread() const;
+
+		//	Acquires shared. Blocks while a writer holds it or is waiting for it.
+		//	Throws if the mutex is already locked exclusively by the current thread.
+		shared_lock_type lock_shared();
+
+		//	Acquires shared iff no writer holds it or is waiting for it. Does not block.
+		optional<shared_lock_type> try_lock_shared();
+
+	private:
+		friend struct shared_lock;
+		friend struct unique_lock;
+
+		typedef padded<atomic<std::uint32_t>> shard;
+
+		shard & this_thread_shard() const QAK_noexcept;
+
+		//	Counts the caller in as a reader. Returns true if that acquired it; if not, the caller must
+		//	release_shared_.
+		bool enter_shared_(shard & sh) QAK_noexcept;
+		void acquire_shared_(shard & sh);
+		void acquire_shared_contended_(shard & sh);
+		void release_shared_(shard & sh) QAK_noexcept;
+
+		//	These are called with writer_mut_ held.
+		void acquire_exclusive_() QAK_noexcept;
+		bool try_acquire_exclusive_() QAK_noexcept;
+		void release_exclusive_() QAK_noexcept;
+
+		mutex writer_mut_;
+
+		//	1 while a writer holds the lock or is waiting for readers to drain, else 0.
+		atomic<std::uint32_t> writer_state_;
+
+		unsigned shard_ix_mask_;
+		shard * p_shards_;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	A shared lock on a shared_mutex. Like mutex_lock, its existence means the lock is held, except for the
+	//	source object after a std::move.
+	//
+	struct shared_lock
+	{
+		//	Blocks while a writer holds the mutex or is waiting for it.
+		explicit shared_lock(shared_mutex & m);
+
+		//	Noncopyable.
+
+		shared_lock() = delete;
+		shared_lock(shared_lock const &) = delete;
+		shared_lock & operator = (shared_lock const &) = delete;
+		shared_lock & operator = (shared_lock &&) = delete;
+
+		//	Move-constructable (but be careful).
+		shared_lock(shared_lock &&) QAK_noexcept;
+
+		//	Releases the lock held on the mutex.
+		~shared_lock();
+
+		//	Returns true iff the caller identifies the mutex on which this object holds a lock.
+		bool is_locking(shared_mutex const & m) const { return &m == p_m_; }
+
+	private:
+		friend struct shared_mutex;
+
+		struct private_construct_tag { };
+		shared_lock(private_construct_tag const &, shared_mutex * p_m, shared_mutex::shard * p_shard);
+
+		shared_mutex * p_m_;
+
+		//	The shard we counted ourselves in on. The thread's shard can't change, but a lock can be moved to
+		//	another thread.
+		shared_mutex::shard * p_shard_;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	An exclusive lock on a shared_mutex.
+	//
+	struct unique_lock
+	{
+		//	Blocks until no other thread holds any lock on the mutex.
+		explicit unique_lock(shared_mutex & m);
+
+		//	Noncopyable.
+
+		unique_lock() = delete;
+		unique_lock(unique_lock const &) = delete;
+		unique_lock & operator = (unique_lock const &) = delete;
+		unique_lock & operator = (unique_lock &&) = delete;
+
+		//	Move-constructable (but be careful).
+		unique_lock(unique_lock &&);
+
+		//	Releases the lock held on the mutex.
+		~unique_lock();
+
+		//	Returns true iff the caller identifies the mutex on which this object holds a lock.
+		bool is_locking(shared_mutex const & m) const { return &m == p_m_; }
+
+	private:
+		friend struct shared_mutex;
+
+		struct private_construct_tag { };
+		unique_lock(private_construct_tag const &, mutex_lock && writer_lock, shared_mutex * p_m);
+
+		//	Declared first, so it's acquired before and released after the rest.
+		mutex_lock writer_lock_;
+
+		shared_mutex * p_m_;
+	};
+
+	//=================================================================================================================|
+	//
+	//	Inline implementation of the reader side.
+
+	inline shared_mutex::shard & shared_mutex::this_thread_shard() const QAK_noexcept
+	{
+		return p_shards_[qak_sharded_counter_imp_::this_thread_shard_ix() & shard_ix_mask_];
+	}
+
+	inline bool shared_mutex::enter_shared_(shard & sh) QAK_noexcept
+	{
+		//	A store-load pair against the writer's, which raises writer_state_ and then reads the shards. Seq_cst
+		//	on both sides means at least one of us sees the other.
+		sh->fetch_add(1, memory_order::seq_cst);
+		return !writer_state_.load(memory_order::seq_cst);
+	}
+
+	inline void shared_mutex::acquire_shared_(shard & sh)
+	{
+		if (!enter_shared_(sh))
+			acquire_shared_contended_(sh);
+	}
+
+	inline void shared_mutex::release_shared_(shard & sh) QAK_noexcept
+	{
+		//	If we empty the shard while a writer waits, it may be waiting on this one.
+		if (sh->fetch_sub(1, memory_order::seq_cst) == 1 && writer_state_.load(memory_order::seq_cst))
+			sh->notify_one();
+	}
+
+	inline shared_mutex::shared_lock_type shared_mutex::lock_shared()
+	{
+		shard & sh = this_thread_shard();
+		acquire_shared_(sh);
+		return shared_lock(shared_lock::private_construct_tag(), this, &sh);
+	}
+
+	inline optional<shared_mutex::shared_lock_type> shared_mutex::try_lock_shared()
+	{
+		shard & sh = this_thread_shard();
+		if (!enter_shared_(sh))
+		{
+			release_shared_(sh);
+			return optional<shared_lock>();
+		}
+		return shared_lock(shared_lock::private_construct_tag(), this, &sh);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	inline shared_lock::shared_lock(shared_mutex & m) : p_m_(&m), p_shard_(&m.this_thread_shard())
+	{
+		m.acquire_shared_(*p_shard_);
+	}
+
+	inline shared_lock::shared_lock(
+		private_construct_tag const &,
+		shared_mutex * p_m,
+		shared_mutex::shard * p_shard
+	) :
+		p_m_(p_m),
+		p_shard_(p_shard)
+	{ }
+
+	inline shared_lock::shared_lock(shared_lock && that) QAK_noexcept : p_m_(that.p_m_), p_shard_(that.p_shard_)
+	{
+		that.p_m_ = 0;
+	}
+
+	inline shared_lock::~shared_lock()
+	{
+		if (p_m_)
+			p_m_->release_shared_(*p_shard_);
+	}
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_shared_mutex_hxx_INCLUDED_
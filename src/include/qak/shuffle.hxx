@@ -0,0 +1,73 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2012, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/shuffle.hxx"
+//
+//	Uniformly random shuffling of sequences using prng64.
+
+#ifndef qak_shuffle_hxx_INCLUDED_
+#define qak_shuffle_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/prng64.hxx"
+#include "qak/vector.hxx"
+
+#include <cassert>
+#include <cstddef> // std::size_t
+#include <utility> // std::swap
+
+namespace qak { //=====================================================================================================|
+
+	//	Fisher-Yates (Knuth) shuffle of the contiguous sequence [p_b, p_e).
+	//	Every permutation is equally likely, to the extent that the prng is random.
+	//
+	template <class T> inline
+	void shuffle(T * p_b, T * p_e, prng64 & prng)
+	{
+		assert(p_b <= p_e);
+
+		std::size_t n = static_cast<std::size_t>(p_e - p_b);
+		while (1 < n)
+		{
+			std::size_t ix = prng.generate_below<std::size_t>(n);
+			--n;
+			if (ix != n)
+			{
+				using std::swap;
+				swap(p_b[ix], p_b[n]);
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	Fisher-Yates (Knuth) shuffle of the elements of a vector.
+	//
+	template <class T> inline
+	void shuffle(vector<T> & v, prng64 & prng)
+	{
+		if (!v.empty())
+		{
+			T * p_b = &v[0];
+			shuffle<T>(p_b, p_b + v.size(), prng);
+		}
+	}
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_shuffle_hxx_INCLUDED_
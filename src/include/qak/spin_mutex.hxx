@@ -0,0 +1,178 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/spin_mutex.hxx"
+//
+//	A mutex for critical sections of a handful of instructions.
+//
+//	A thread finding it locked polls it with plain loads (test-and-test-and-set), pausing for exponentially longer
+//	between polls, so waiters don't hammer the line the holder needs. By default it parks on the lock word with
+//	atomic::wait once it has spun a while, like mutex, but it can be made to never park and yield its time slice
+//	instead. Unlocking one that never parks is a plain store rather than an atomic RMW.
+//
+//	Unlike mutex, it doesn't track its owner, so locking it again from the holding thread deadlocks rather than
+//	throwing. Use mutex unless the critical sections are tiny and you've measured.
+
+#ifndef qak_spin_mutex_hxx_INCLUDED_
+#define qak_spin_mutex_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+#include "qak/atomic.hxx"
+#include "qak/optional.hxx"
+
+#include <cassert>
+#include <cstdint> // std::uint32_t
+
+namespace qak { //=====================================================================================================|
+
+	struct spin_mutex;
+	struct spin_mutex_lock;
+
+	//=================================================================================================================|
+
+	struct spin_mutex
+	{
+		typedef spin_mutex_lock lock_type;
+
+		//	Rounds of backoff before a waiting thread parks, by default.
+		static unsigned const default_cnt_spins = 16;
+
+		//	For cnt_spins, never park.
+		static unsigned const never_park = ~0u;
+
+		constexpr explicit spin_mutex(unsigned cnt_spins = default_cnt_spins) :
+			state_(state_unlocked),
+			cnt_spins_(cnt_spins)
+		{ }
+
+		~spin_mutex()
+		{
+			assert(state_.load(memory_order::relaxed) == state_unlocked);
+		}
+
+		//	Noncopyable, nonmoveable.
+
+		spin_mutex(spin_mutex const &) = delete;
+		spin_mutex(spin_mutex &&) = delete;
+		spin_mutex & operator = (spin_mutex const &) = delete;
+		spin_mutex & operator = (spin_mutex &&) = delete;
+
+		//	Blocks forever, or until the mutex is acquired, whichever comes first.
+		lock_type lock();
+
+		//	Acquires the mutex iff it is currently free. Does not block.
+		optional<lock_type> try_lock();
+
+		//	Whether some thread holds it. Only a hint by the time the caller looks at it.
+		bool is_locked() const QAK_noexcept { return state_.load(memory_order::relaxed) != state_unlocked; }
+
+	private:
+		friend struct spin_mutex_lock;
+
+		enum : std::uint32_t {
+			state_unlocked = 0,
+			state_locked = 1,
+			state_locked_waiters = 2 // locked, and threads may be parked waiting on state_
+		};
+
+		atomic<std::uint32_t> state_;
+		unsigned cnt_spins_;
+
+		bool try_acquire_() QAK_noexcept
+		{
+			std::uint32_t st = state_unlocked;
+			return state_.compare_exchange_strong(st, state_locked, memory_order::acquire, memory_order::relaxed);
+		}
+
+		void acquire_() QAK_noexcept
+		{
+			if (!try_acquire_())
+				acquire_contended_();
+		}
+
+		void acquire_contended_() QAK_noexcept;
+
+		void release_() QAK_noexcept
+		{
+			if (cnt_spins_ == never_park)
+				state_.store(state_unlocked, memory_order::release);
+			else if (state_.exchange(state_unlocked, memory_order::release) == state_locked_waiters)
+				state_.notify_one();
+		}
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	Like mutex_lock, the existence of a spin_mutex_lock means that a spin_mutex is actually locked, except for
+	//	the source object after a std::move.
+	//
+	struct spin_mutex_lock
+	{
+		//	Blocks forever, or until the mutex is acquired, whichever comes first.
+		explicit spin_mutex_lock(spin_mutex & m) : p_m_(&m) { m.acquire_(); }
+
+		//	Noncopyable.
+
+		spin_mutex_lock() = delete;
+		spin_mutex_lock(spin_mutex_lock const &) = delete;
+		spin_mutex_lock & operator = (spin_mutex_lock const &) = delete;
+		spin_mutex_lock & operator = (spin_mutex_lock &&) = delete;
+
+		//	Move-constructable (but be careful).
+		spin_mutex_lock(spin_mutex_lock && that) QAK_noexcept : p_m_(that.p_m_) { that.p_m_ = 0; }
+
+		//	Releases the lock held on the mutex.
+		~spin_mutex_lock()
+		{
+			if (p_m_)
+				p_m_->release_();
+		}
+
+		//	Returns true iff the caller identifies the mutex on which this object holds a lock.
+		bool is_locking(spin_mutex const & m) const { return &m == p_m_; }
+
+	private:
+		friend struct spin_mutex;
+
+		struct private_construct_tag { };
+		spin_mutex_lock(private_construct_tag const &, spin_mutex * p_m) : p_m_(p_m) { }
+
+		spin_mutex * p_m_;
+	};
+
+	//=================================================================================================================|
+	//
+	//	Inline implementation.
+
+	inline spin_mutex::lock_type spin_mutex::lock()
+	{
+		acquire_();
+		return spin_mutex_lock(spin_mutex_lock::private_construct_tag(), this);
+	}
+
+	inline optional<spin_mutex::lock_type> spin_mutex::try_lock()
+	{
+		if (!try_acquire_())
+			return optional<spin_mutex_lock>();
+
+		return spin_mutex_lock(spin_mutex_lock::private_construct_tag(), this);
+	}
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_spin_mutex_hxx_INCLUDED_
@@ -0,0 +1,133 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/tagged_ptr.hxx"
+//
+//	A pointer paired with a tag, updated together by a double-width compare-and-swap.
+//
+//	Lock-free stacks and freelists that compare only the pointer suffer from ABA: a thread reads the head A, another
+//	pops A and B and pushes A back, and the first thread's CAS succeeds against a stale next pointer. Bumping the tag
+//	on every update makes the stale CAS fail.
+//
+//	On x64 this uses cmpxchg16b where the CPU has it (checked once at run time; the earliest x64 CPUs lack it).
+//	Elsewhere, or without it, the operations take one of a small set of striped locks, and is_lock_free() says so.
+//	All operations are seq_cst.
+
+#ifndef qak_tagged_ptr_hxx_INCLUDED_
+#define qak_tagged_ptr_hxx_INCLUDED_
+
+#include "qak/config.hxx"
+
+#include <cstdint> // std::uintptr_t
+
+namespace qak_tagged_ptr_imp_ { //=====================================================================================|
+
+	//	Two words, aligned as cmpxchg16b requires.
+	struct alignas(2*sizeof(void *)) dw_stor
+	{
+		std::uintptr_t lo;
+		std::uintptr_t hi;
+	};
+
+	bool dw_is_lock_free() QAK_noexcept;
+	dw_stor dw_load(dw_stor const & stor) QAK_noexcept;
+	void dw_store(dw_stor & stor, dw_stor val) QAK_noexcept;
+	bool dw_compare_exchange(dw_stor & stor, dw_stor & exp, dw_stor des) QAK_noexcept;
+
+} // namespace qak_tagged_ptr_imp_
+namespace qak { //=====================================================================================================|
+
+	//	A plain value: the pointer and its tag.
+	//
+	template <class T>
+	struct tagged_ptr
+	{
+		T * ptr;
+		std::uintptr_t tag;
+
+		tagged_ptr() QAK_noexcept : ptr(0), tag(0) { }
+		tagged_ptr(T * p, std::uintptr_t t) QAK_noexcept : ptr(p), tag(t) { }
+
+		//	A new pointer with the tag bumped. Updating through this is what defeats ABA.
+		tagged_ptr next(T * p) const QAK_noexcept { return tagged_ptr(p, tag + 1); }
+
+		bool operator == (tagged_ptr const & that) const QAK_noexcept { return ptr == that.ptr && tag == that.tag; }
+		bool operator != (tagged_ptr const & that) const QAK_noexcept { return !(*this == that); }
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	An atomic tagged_ptr<T>. Zero-initialized, like qak::atomic.
+	//
+	template <class T>
+	struct atomic_tagged_ptr
+	{
+		atomic_tagged_ptr() QAK_noexcept { stor_.lo = 0; stor_.hi = 0; }
+		explicit atomic_tagged_ptr(tagged_ptr<T> tp) QAK_noexcept : stor_(to_stor(tp)) { }
+
+		//	Noncopyable, nonmoveable.
+
+		atomic_tagged_ptr(atomic_tagged_ptr const &) = delete;
+		atomic_tagged_ptr(atomic_tagged_ptr &&) = delete;
+		atomic_tagged_ptr & operator = (atomic_tagged_ptr const &) = delete;
+		atomic_tagged_ptr & operator = (atomic_tagged_ptr &&) = delete;
+
+		//	True iff the operations use a double-width CAS instruction rather than a lock.
+		static bool is_lock_free() QAK_noexcept { return qak_tagged_ptr_imp_::dw_is_lock_free(); }
+
+		tagged_ptr<T> load() const QAK_noexcept
+		{
+			return from_stor(qak_tagged_ptr_imp_::dw_load(stor_));
+		}
+
+		void store(tagged_ptr<T> tp) QAK_noexcept
+		{
+			qak_tagged_ptr_imp_::dw_store(stor_, to_stor(tp));
+		}
+
+		//	Replaces the value with desired iff it currently equals expected, both pointer and tag. Otherwise
+		//	updates expected with the current value. Never fails spuriously, so there is no separate _weak form.
+		bool compare_exchange(tagged_ptr<T> & expected, tagged_ptr<T> desired) QAK_noexcept
+		{
+			qak_tagged_ptr_imp_::dw_stor exp = to_stor(expected);
+			bool b = qak_tagged_ptr_imp_::dw_compare_exchange(stor_, exp, to_stor(desired));
+			if (!b)
+				expected = from_stor(exp);
+			return b;
+		}
+
+	private:
+		static qak_tagged_ptr_imp_::dw_stor to_stor(tagged_ptr<T> tp) QAK_noexcept
+		{
+			qak_tagged_ptr_imp_::dw_stor s;
+			s.lo = reinterpret_cast<std::uintptr_t>(tp.ptr);
+			s.hi = tp.tag;
+			return s;
+		}
+
+		static tagged_ptr<T> from_stor(qak_tagged_ptr_imp_::dw_stor s) QAK_noexcept
+		{
+			return tagged_ptr<T>(reinterpret_cast<T *>(s.lo), s.hi);
+		}
+
+		qak_tagged_ptr_imp_::dw_stor stor_;
+	};
+
+} // namespace qak ====================================================================================================|
+#endif // ndef qak_tagged_ptr_hxx_INCLUDED_
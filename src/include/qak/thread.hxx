@@ -26,9 +26,12 @@
 #include "qak/atomic.hxx"
 #include "qak/rptr.hxx"
 #include "qak/optional.hxx"
+#include "qak/vector.hxx"
 
+#include <cstddef> // std::size_t
 #include <cstdint> // std::uintptr_t
 #include <functional> // std::function
+#include <string>
 
 namespace qak { //=====================================================================================================|
 
@@ -110,13 +113,59 @@ namespace qak { //==============================================================
 
 	//-----------------------------------------------------------------------------------------------------------------|
 
+	enum struct thread_sched_policy
+	{
+		inherit,     // whatever the starting thread has
+		normal,      // SCHED_OTHER
+		batch,       // SCHED_BATCH, for CPU-bound work that can wait
+		idle,        // SCHED_IDLE, only when nothing else wants the CPU
+		fifo,        // SCHED_FIFO, real-time, runs until it blocks or yields
+		round_robin  // SCHED_RR, real-time, with a time slice among equal priorities
+	};
+
+	//	Attributes for a new thread. The defaults leave each as the OS would. An attribute the OS rejects (e.g.,
+	//	fifo without the privilege for it) makes start_thread fail. On Windows, only the stack size is applied so far.
+	//
+	struct thread_options
+	{
+		//	Bytes of stack, for threads that need less (or more) than the default. Rounded up to the system
+		//	minimum, which must also cover the thread's thread_local variables.
+		optional<std::size_t> opt_stack_size;
+
+		//	Bytes of inaccessible guard pages below the stack, to catch overflow. 0 for none.
+		optional<std::size_t> opt_guard_size;
+
+		//	Shown by top, ps, perf and debuggers. Linux truncates it to 15 characters.
+		std::string name;
+
+		//	For fifo and round_robin, sched_priority is from 1 (lowest) to 99 on Linux. Other policies need 0.
+		thread_sched_policy sched_policy = thread_sched_policy::inherit;
+		int sched_priority = 0;
+
+		//	The CPUs (host_info numbering) the thread may run on. Empty for any. CPU pinning is Linux-only;
+		//	elsewhere, start_thread fails if this isn't empty.
+		vector<unsigned> cpu_ixs;
+
+		//	Binds the thread's memory allocations to this NUMA node. Allocations fail there rather than spill to
+		//	another node, so it's for threads that would rather fail than run with remote memory. Usually paired
+		//	with cpu_ixs on the same node.
+		optional<unsigned> opt_numa_node;
+
+		//	Throws if an option is out of range for this host, as start_thread would. For checking options kept to
+		//	start threads later.
+		void validate() const;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
 	//	Begins a new thread.
 	//
 	//	The void() thread_fn version yields an exit code of 0 on normal termination.  ????:j
 	//	Both versions yield std::uintptr_t(-1) on termination by exception. ????
 	//
-	thread::RP start_thread(std::function<void()> thread_fn);
-	thread::RP start_thread_uintptr(std::function<std::uintptr_t()> thread_fn);
+	thread::RP start_thread(std::function<void()> thread_fn, thread_options const & opts = thread_options());
+	thread::RP start_thread_uintptr(
+		std::function<std::uintptr_t()> thread_fn, thread_options const & opts = thread_options() );
 
 	//-----------------------------------------------------------------------------------------------------------------|
 
@@ -155,6 +204,12 @@ namespace qak { //==============================================================
 		//	CPUs available on the system, so it can be any value.
 		void set_affinity(unsigned cpu_ix);
 
+		//-------------------------------------------------------------------------------------------------------------|
+
+		//	Returns the index of the CPU the calling thread is running on. Unless its affinity is set, it may be
+		//	running on another by the time the caller looks at the result.
+		unsigned get_cpu_ix() QAK_noexcept;
+
 	} // namespace this_thread
 
 } // namespace qak ====================================================================================================|
@@ -43,8 +43,8 @@ namespace qak { //==============================================================
 		typedef std::function<void(thread_stop_fn_t stop_fn)> provide_thread_stop_fn_t;
 		typedef std::function<void(std::size_t cpu_ix, provide_thread_stop_fn_t provide_thread_stop_fn)> thread_fn_t;
 
-		//	Ctor, specifying the initial count of threads explicitly.
-		explicit thread_group(thread_fn_t fn, std::size_t cnt = 0);
+		//	Ctor, specifying the initial count of threads explicitly. Every thread is started with opts.
+		explicit thread_group(thread_fn_t fn, std::size_t cnt = 0, thread_options const & opts = thread_options());
 
 		//	Sets the target count of threads explicitly. Threads are started or requested to stop in
 		//	order to match the specified target.
@@ -0,0 +1,200 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//#include "qak/weak_rptr.hxx"
+//
+//	A weak reference to an rptr-managed object.
+//
+//	A weak_rptr does not keep its object alive. Use lock() to get an rptr to the object, which will be null if the
+//	object has already been destroyed.
+//
+//	Objects pay nothing for this until the first weak_rptr to them is made. At that point a control block is
+//	allocated off to the side, and a flag bit in the reference count tells the final release to expire it.
+//	So the reference count stays a single word, and rptr copies that never involve a weak_rptr are unaffected.
+
+#ifndef qak_weak_rptr_hxx_INCLUDED_
+#define qak_weak_rptr_hxx_INCLUDED_
+
+#include "qak/rptr.hxx"
+
+#include <utility> // std::move
+
+namespace qak_rptr_imp_ { // ==========================================================================================|
+
+    //	Implemented in weak_rptr.cxx.
+
+    void weak_ctl_add_ref(weak_ctl * p_ctl) QAK_noexcept;
+    void weak_ctl_release(weak_ctl * p_ctl) QAK_noexcept;
+
+    //	Calls try_inc_fn(p) iff the object has not yet expired. Returns true iff it was called and succeeded.
+    bool weak_ctl_try_lock(weak_ctl * p_ctl, bool (* try_inc_fn)(void const *), void const * p) QAK_noexcept;
+
+    bool weak_ctl_expired(weak_ctl * p_ctl) QAK_noexcept;
+
+} // namespace qak_rptr_imp_
+namespace qak { //=====================================================================================================|
+
+    template <class T>
+    struct weak_rptr
+    {
+        typedef T element_type;
+
+        //	Construction.
+
+        weak_rptr() QAK_noexcept : p_(0), ctl_(0) { }
+
+        //	Allocates the object's control block if this is its first weak_rptr, which may throw.
+        template <class Y>
+        weak_rptr(rptr<Y> const & that) :
+            p_(that.p_),
+            ctl_(0)
+        {
+            static_assert(std::is_convertible<Y const *, T const *>::value, "Supplied pointer not convertible to weak_rptr type");
+
+            if (p_)
+                ctl_ = p_->tpointee_weak_ctl_acquire_();
+        }
+
+        weak_rptr(weak_rptr const & that) QAK_noexcept :
+            p_(that.p_),
+            ctl_(that.ctl_)
+        {
+            if (ctl_)
+                qak_rptr_imp_::weak_ctl_add_ref(ctl_);
+        }
+
+        template <class Y>
+        weak_rptr(weak_rptr<Y> const & that) QAK_noexcept :
+            p_(that.p_),
+            ctl_(that.ctl_)
+        {
+            static_assert(std::is_convertible<Y const *, T const *>::value, "Supplied pointer not convertible to weak_rptr type");
+
+            if (ctl_)
+                qak_rptr_imp_::weak_ctl_add_ref(ctl_);
+        }
+
+        weak_rptr(weak_rptr && src) QAK_noexcept :
+            p_(src.p_),
+            ctl_(src.ctl_)
+        {
+            src.p_ = 0;
+            src.ctl_ = 0;
+        }
+
+        template <class Y>
+        weak_rptr(weak_rptr<Y> && src) QAK_noexcept :
+            p_(src.p_),
+            ctl_(src.ctl_)
+        {
+            static_assert(std::is_convertible<Y const *, T const *>::value, "Supplied pointer not convertible to weak_rptr type");
+
+            src.p_ = 0;
+            src.ctl_ = 0;
+        }
+
+        //	Destruction.
+
+        ~weak_rptr()
+        {
+            if (ctl_)
+                qak_rptr_imp_::weak_ctl_release(ctl_);
+        }
+
+        //	Assignment.
+
+        weak_rptr & operator = (weak_rptr const & that) QAK_noexcept
+        {
+            weak_rptr(that).swap(*this);
+            return *this;
+        }
+
+        weak_rptr & operator = (weak_rptr && src) QAK_noexcept
+        {
+            weak_rptr(std::move(src)).swap(*this);
+            return *this;
+        }
+
+        template <class Y>
+        weak_rptr & operator = (weak_rptr<Y> const & that) QAK_noexcept
+        {
+            weak_rptr(that).swap(*this);
+            return *this;
+        }
+
+        template <class Y>
+        weak_rptr & operator = (rptr<Y> const & that)
+        {
+            weak_rptr(that).swap(*this);
+            return *this;
+        }
+
+        void reset() QAK_noexcept
+        {
+            weak_rptr().swap(*this);
+        }
+
+        void swap(weak_rptr & that) QAK_noexcept
+        {
+            T * p = p_;
+            p_ = that.p_;
+            that.p_ = p;
+
+            qak_rptr_imp_::weak_ctl * ctl = ctl_;
+            ctl_ = that.ctl_;
+            that.ctl_ = ctl;
+        }
+
+        //	Observers.
+
+        //	Returns an rptr to the object, or a null rptr if it has been destroyed.
+        rptr<T> lock() const QAK_noexcept
+        {
+            if (ctl_ && qak_rptr_imp_::weak_ctl_try_lock(ctl_, &try_inc_ref_, p_))
+                return rptr<T>(p_, typename rptr<T>::adopt_tag_());
+            return rptr<T>();
+        }
+
+        //	Returns true iff the object has been destroyed (or this weak_rptr is empty).
+        //	A false result may be stale by the time the caller sees it, so prefer lock().
+        bool expired() const QAK_noexcept
+        {
+            return !ctl_ || qak_rptr_imp_::weak_ctl_expired(ctl_);
+        }
+
+    private:
+
+        template <class U> friend struct weak_rptr;
+
+        static bool try_inc_ref_(void const * p) QAK_noexcept
+        {
+            return static_cast<T const *>(p)->tpointee_try_inc_ref_();
+        }
+
+        T * p_;
+        qak_rptr_imp_::weak_ctl * ctl_;
+    };
+
+} // namespace qak
+namespace std { //=====================================================================================================|
+
+    template <class T> void swap( qak::weak_rptr<T> & a, qak::weak_rptr<T> & b ) QAK_noexcept { a.swap(b); }
+
+} // namespace std
+#endif // ndef qak_weak_rptr_hxx_INCLUDED_
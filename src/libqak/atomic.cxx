@@ -24,6 +24,18 @@
 #include "qak/config.hxx"
 #include "qak/fail.hxx"
 #include "qak/macros.hxx"
+#include "qak/now.hxx"
+#include "qak/thread.hxx"
+
+#include <climits> // INT_MAX
+
+#if QAK_LINUX
+#	include <errno.h>
+#	include <linux/futex.h> // FUTEX_WAIT_PRIVATE, FUTEX_WAKE_PRIVATE
+#	include <sys/syscall.h> // SYS_futex
+#	include <time.h> // struct timespec
+#	include <unistd.h> // syscall
+#endif
 
 #if defined(_MSC_VER) && 1700 <= _MSC_VER //? TODO did MSVC have <atomic> in any earlier verison?
 
@@ -129,6 +141,8 @@ namespace qak { namespace atomic_imp_ns_ { //===================================
 #	error ""
 #endif
 
+#if !QAK_ATOMIC_INLINE // otherwise azi_stor is defined in the header
+
     //-----------------------------------------------------------------------------------------------------------------|
 
     //	Constructor.
@@ -288,6 +302,101 @@ namespace qak { namespace atomic_imp_ns_ { //===================================
 
         return REF_STDATOMIC--;
 
+#elif IMPL_STDATOMIC
+#elif IMPL_ALIGNED_PTRS_ARE_ASSUMED_ATOMIC
+#	if IMPL_HAVE_MEM_FULL_BARRIER
+#		error ""
+#	endif
+#else
+#	error ""
+#endif
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    template <int N>
+    typename azi_stor<N>::repr_type azi_stor<N>::fetch_add(repr_type val, memory_order mo) QAK_noexcept
+    {
+#if IMPL_STD_ATOMIC
+
+        return REF_STDATOMIC.fetch_add(val, to_std_mo(mo));
+
+#elif IMPL_STDATOMIC
+#elif IMPL_ALIGNED_PTRS_ARE_ASSUMED_ATOMIC
+#	if IMPL_HAVE_MEM_FULL_BARRIER
+#		error ""
+#	endif
+#else
+#	error ""
+#endif
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    template <int N>
+    typename azi_stor<N>::repr_type azi_stor<N>::fetch_sub(repr_type val, memory_order mo) QAK_noexcept
+    {
+#if IMPL_STD_ATOMIC
+
+        return REF_STDATOMIC.fetch_sub(val, to_std_mo(mo));
+
+#elif IMPL_STDATOMIC
+#elif IMPL_ALIGNED_PTRS_ARE_ASSUMED_ATOMIC
+#	if IMPL_HAVE_MEM_FULL_BARRIER
+#		error ""
+#	endif
+#else
+#	error ""
+#endif
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    template <int N>
+    typename azi_stor<N>::repr_type azi_stor<N>::fetch_and(repr_type val, memory_order mo) QAK_noexcept
+    {
+#if IMPL_STD_ATOMIC
+
+        return REF_STDATOMIC.fetch_and(val, to_std_mo(mo));
+
+#elif IMPL_STDATOMIC
+#elif IMPL_ALIGNED_PTRS_ARE_ASSUMED_ATOMIC
+#	if IMPL_HAVE_MEM_FULL_BARRIER
+#		error ""
+#	endif
+#else
+#	error ""
+#endif
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    template <int N>
+    typename azi_stor<N>::repr_type azi_stor<N>::fetch_or(repr_type val, memory_order mo) QAK_noexcept
+    {
+#if IMPL_STD_ATOMIC
+
+        return REF_STDATOMIC.fetch_or(val, to_std_mo(mo));
+
+#elif IMPL_STDATOMIC
+#elif IMPL_ALIGNED_PTRS_ARE_ASSUMED_ATOMIC
+#	if IMPL_HAVE_MEM_FULL_BARRIER
+#		error ""
+#	endif
+#else
+#	error ""
+#endif
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    template <int N>
+    typename azi_stor<N>::repr_type azi_stor<N>::fetch_xor(repr_type val, memory_order mo) QAK_noexcept
+    {
+#if IMPL_STD_ATOMIC
+
+        return REF_STDATOMIC.fetch_xor(val, to_std_mo(mo));
+
 #elif IMPL_STDATOMIC
 #elif IMPL_ALIGNED_PTRS_ARE_ASSUMED_ATOMIC
 #	if IMPL_HAVE_MEM_FULL_BARRIER
@@ -409,6 +518,141 @@ namespace qak { namespace atomic_imp_ns_ { //===================================
     template struct azi_stor<8>;
 #endif
 
+#endif // !QAK_ATOMIC_INLINE
+
+    //=================================================================================================================|
+    //
+    //	Wait and notify.
+    //
+    //	Each address hashes to a slot which counts the threads waiting on any address in it, so notify can skip the
+    //	system call when nobody is waiting. A 4-byte atomic is itself the futex word. Other sizes wait on the slot's
+    //	sequence word instead, which every notify for the slot bumps.
+
+    struct alignas(QAK_CACHE_LINE_SIZE) wait_slot
+    {
+        qak::atomic<std::uint32_t> seq;
+        qak::atomic<std::uint32_t> cnt_waiters;
+    };
+
+    std::size_t const cnt_wait_slots = 256;
+
+    wait_slot wait_slots[cnt_wait_slots];
+
+    wait_slot & wait_slot_for(void const * p)
+    {
+        std::uintptr_t u = reinterpret_cast<std::uintptr_t>(p) >> 3;
+        return wait_slots[(u ^ (u >> 8)) % cnt_wait_slots];
+    }
+
+#if QAK_LINUX
+
+    //	Returns false iff the timeout expired. Private futexes, so not for atomics in memory shared between processes.
+    bool futex_wait(void const * p_word, std::uint32_t val, std::uint64_t deadline_ns)
+    {
+        struct timespec ts;
+        struct timespec * p_ts = 0;
+        if (deadline_ns != no_deadline)
+        {
+            std::uint64_t now = read_time_source(time_source::wallclock_ns);
+            if (deadline_ns <= now)
+                return false;
+            std::uint64_t rel = deadline_ns - now;
+            ts.tv_sec = static_cast<time_t>(rel/1000000000u);
+            ts.tv_nsec = static_cast<long>(rel%1000000000u);
+            p_ts = &ts;
+        }
+
+        long r = ::syscall(SYS_futex, p_word, FUTEX_WAIT_PRIVATE, val, p_ts, 0, 0);
+        return !(r == -1 && errno == ETIMEDOUT);
+    }
+
+    void futex_wake(void const * p_word, int cnt)
+    {
+        ::syscall(SYS_futex, p_word, FUTEX_WAKE_PRIVATE, cnt, 0, 0, 0);
+    }
+
+    std::uint64_t load_n(void const * p, int n)
+    {
+        switch (n)
+        {
+        case 1: return __atomic_load_n(static_cast<std::uint8_t const *>(p), __ATOMIC_SEQ_CST);
+        case 2: return __atomic_load_n(static_cast<std::uint16_t const *>(p), __ATOMIC_SEQ_CST);
+        case 4: return __atomic_load_n(static_cast<std::uint32_t const *>(p), __ATOMIC_SEQ_CST);
+        default: return __atomic_load_n(static_cast<std::uint64_t const *>(p), __ATOMIC_SEQ_CST);
+        }
+    }
+
+#endif // QAK_LINUX
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    bool wait_imp(void const * p, int n, std::uint64_t old, std::uint64_t deadline_ns) QAK_noexcept
+    {
+#if QAK_LINUX
+
+        wait_slot & slot = wait_slot_for(p);
+
+        //	Registering before the last look at the value pairs with the fence in notify_imp.
+        ++slot.cnt_waiters;
+
+        bool in_time;
+        if (n == 4)
+        {
+            //	The kernel compares the value under its own lock, so a change after this point isn't missed.
+            in_time = futex_wait(p, static_cast<std::uint32_t>(old), deadline_ns);
+        }
+        else
+        {
+            std::uint32_t seq = slot.seq.load();
+            in_time = load_n(p, n) != old || futex_wait(&slot.seq, seq, deadline_ns);
+        }
+
+        --slot.cnt_waiters;
+        return in_time;
+
+#else // of if QAK_LINUX
+
+        //?OPT WaitOnAddress on Windows 8 and later.
+        QAK_unused(p); QAK_unused(n); QAK_unused(old);
+        if (deadline_ns != no_deadline && deadline_ns <= read_time_source(time_source::wallclock_ns))
+            return false;
+        this_thread::sleep_ns(100*1000);
+        return true;
+
+#endif // of else of if QAK_LINUX
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    void notify_imp(void const * p, int n, bool all) QAK_noexcept
+    {
+#if QAK_LINUX
+
+        wait_slot & slot = wait_slot_for(p);
+
+        //	The caller's store must be ordered before our look at the waiter count.
+        qak::atomic_thread_fence(memory_order::seq_cst);
+        if (!slot.cnt_waiters.load(memory_order::relaxed))
+            return;
+
+        if (n == 4)
+        {
+            futex_wake(p, all ? INT_MAX : 1);
+        }
+        else
+        {
+            //	Waiters on other addresses share the word, so wake them all and let them recheck.
+            ++slot.seq;
+            futex_wake(&slot.seq, INT_MAX);
+        }
+
+#else // of if QAK_LINUX
+
+        QAK_unused(p); QAK_unused(n); QAK_unused(all);
+
+#endif // of else of if QAK_LINUX
+    }
+
 } // namespace atomic_imp_ns_ =========================================================================================|
 
     // extern
@@ -0,0 +1,146 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	atomic__bench.cxx
+
+#include "qak/atomic.hxx"
+
+#include "qak/host_info.hxx"
+#include "qak/stopwatch.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdio> // std::snprintf
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    std::uint64_t const cnt_iters = 100*1000*1000;
+
+#if QAK_ATOMIC_INLINE
+#   define ZZZ_MODE "inline"
+#else
+#   define ZZZ_MODE "out-of-line"
+#endif
+
+    QAKtest(per_op, "Per-operation cost of qak::atomic<std::uint64_t>, uncontended.")
+    {
+        qak::atomic<std::uint64_t> a;
+
+        QAK_bench_loop("relaxed load (" ZZZ_MODE ")", cnt_iters,
+            std::uint64_t v = a.load(qak::memory_order::relaxed);
+            QAK_bench_keep(v)
+        );
+
+        QAK_bench_loop("seq_cst store (" ZZZ_MODE ")", cnt_iters,
+            a.store(bench_ix, qak::memory_order::seq_cst)
+        );
+
+        QAK_bench_loop("increment (" ZZZ_MODE ")", cnt_iters,
+            ++a
+        );
+
+        QAK_bench_loop("CAS loop increment (" ZZZ_MODE ")", cnt_iters,
+            std::uint64_t v = a.load(qak::memory_order::relaxed);
+            while (!a.compare_exchange_weak(v, v + 1))
+                ;
+        );
+
+        QAK_bench_loop("relaxed fetch_add (" ZZZ_MODE ")", cnt_iters,
+            a.fetch_add(1, qak::memory_order::relaxed)
+        );
+
+        QAK_verify( a.load() == 4*cnt_iters - 1 );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    std::uint64_t const cnt_per_thread = 10*1000*1000;
+
+    //	Runs op_fn cnt_per_thread times on each of 1, 2, 4, ... cnt_cpus_available() threads, all hitting the same
+    //	atomic. Returns the total number of ops performed.
+    template <class Fn>
+    std::uint64_t bench_contended(char const * psz_what, Fn op_fn)
+    {
+        unsigned const cnt_cpus = qak::host_info::cnt_cpus_available();
+        std::uint64_t cnt_total = 0;
+
+        for (unsigned n = 1; ; n = (n*2 < cnt_cpus) ? n*2 : cnt_cpus)
+        {
+            qak::stopwatch sw;
+            qak::vector<qak::thread::RP> threads;
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads.push_back(qak::start_thread([&op_fn]() {
+                    for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                        op_fn(ix);
+                }));
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads[ix]->join();
+            std::int64_t elapsed_ns = sw.elapsed_ns();
+            cnt_total += n*cnt_per_thread;
+
+            char sz[80];
+            std::snprintf(sz, sizeof(sz), "%s, %u threads (per-thread time)", psz_what, n);
+            QAK_bench_report(sz, cnt_per_thread, elapsed_ns);
+
+            if (n == cnt_cpus)
+                break;
+        }
+
+        return cnt_total;
+    }
+
+    QAKtest(contended, "fetch_* versus the CAS-loop emulation, with all threads on one qak::atomic<std::uint64_t>.")
+    {
+        qak::atomic<std::uint64_t> a;
+
+        std::uint64_t cnt = bench_contended("fetch_add", [&a](std::uint64_t) {
+            a.fetch_add(1, qak::memory_order::relaxed);
+        });
+        QAK_verify( a.load() == cnt );
+
+        a = 0;
+        cnt = bench_contended("CAS loop add", [&a](std::uint64_t) {
+            std::uint64_t v = a.load(qak::memory_order::relaxed);
+            while (!a.compare_exchange_weak(v, v + 1, qak::memory_order::relaxed))
+                ;
+        });
+        QAK_verify( a.load() == cnt );
+
+        a = 0;
+        bench_contended("fetch_or", [&a](std::uint64_t ix) {
+            a.fetch_or(std::uint64_t(1) << (ix & 63), qak::memory_order::relaxed);
+        });
+        QAK_verify( a.load() == ~std::uint64_t(0) );
+
+        a = 0;
+        bench_contended("CAS loop or", [&a](std::uint64_t ix) {
+            std::uint64_t bit = std::uint64_t(1) << (ix & 63);
+            std::uint64_t v = a.load(qak::memory_order::relaxed);
+            while (!a.compare_exchange_weak(v, v | bit, qak::memory_order::relaxed))
+                ;
+        });
+        QAK_verify( a.load() == ~std::uint64_t(0) );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
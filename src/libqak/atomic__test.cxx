@@ -21,6 +21,10 @@
 
 #include "qak/atomic.hxx"
 
+#include "qak/now.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
 #include "qak/test_app_pre.hxx"
 #include "qak/test_macros.hxx"
 
@@ -74,6 +78,28 @@ namespace zzz { //==============================================================
             QAK_verify( c == 58 );
             QAK_verify( b == 59 );
             QAK_verify( a == 58 );
+        } {
+            atom.store(0x30);
+
+            QAK_verify( atom.fetch_add(5) == 0x30 );
+            QAK_verify( atom.fetch_sub(3, qak::memory_order::release) == 0x35 );
+            QAK_verify( atom.fetch_or(0x0c, qak::memory_order::relaxed) == 0x32 );
+            QAK_verify( atom.fetch_and(0x3c, qak::memory_order::acquire) == 0x3e );
+            QAK_verify( atom.fetch_xor(0x11, qak::memory_order::acq_rel) == 0x3c );
+            QAK_verify( atom.load() == 0x2d );
+
+            QAK_verify( (atom += 3) == 0x30 );
+            QAK_verify( (atom -= 0x10) == 0x20 );
+            QAK_verify( (atom |= 0x07) == 0x27 );
+            QAK_verify( (atom &= 0x0f) == 0x07 );
+            QAK_verify( (atom ^= 0x05) == 0x02 );
+            QAK_verify( atom.load() == 0x02 );
+
+            //	Wraps like the underlying type.
+            atom.store(0);
+            T m = atom.fetch_sub(1);
+            QAK_verify( m == 0 );
+            QAK_verify( atom.load() == T(T(0) - T(1)) );
         }
     }
 
@@ -131,6 +157,131 @@ namespace zzz { //==============================================================
     QAKtest(ucharptr) { do_test_ptr<unsigned char *>(); }
     QAKtest(constucharptr) { do_test_ptr<unsigned char const *>(); }
 
+    //	Test wait and notify. 4-byte types wait on the atomic itself, others on a shared word.
+    template <class T>
+    void do_test_wait()
+    {
+        qak::atomic<T> a(1);
+
+        //	Returns at once when the value already differs.
+        a.wait(0);
+        QAK_verify( a.wait_until(0, 0) );
+
+        //	Times out when it doesn't.
+        std::uint64_t t_deadline = qak::read_time_source(qak::time_source::wallclock_ns) + 1000*1000;
+        QAK_refute( a.wait_until(1, t_deadline) );
+        QAK_verify( t_deadline <= qak::read_time_source(qak::time_source::wallclock_ns) );
+
+        //	Wakes on notify_one.
+        {
+            qak::thread::RP th = qak::start_thread_uintptr([&a]() -> std::uintptr_t {
+                a.wait(1);
+                return static_cast<std::uintptr_t>(a.load());
+            });
+            qak::this_thread::sleep_ns(1000*1000);
+            a = 2;
+            a.notify_one();
+            QAK_verify( *th->join() == 2 );
+        }
+
+        //	Wakes every waiter on notify_all.
+        {
+            qak::vector<qak::thread::RP> threads;
+            for (int n = 0; n < 4; ++n)
+                threads.push_back(qak::start_thread_uintptr([&a]() -> std::uintptr_t {
+                    std::uint64_t t_deadline = qak::read_time_source(qak::time_source::wallclock_ns) + 10ull*1000*1000*1000;
+                    return a.wait_until(2, t_deadline);
+                }));
+            qak::this_thread::sleep_ns(1000*1000);
+            a = 3;
+            a.notify_all();
+            for (auto & th : threads)
+                QAK_verify( *th->join() == 1 );
+        }
+    }
+
+    QAKtest(wait_uchar) { do_test_wait<unsigned char>(); }
+    QAKtest(wait_ushort) { do_test_wait<unsigned short>(); }
+    QAKtest(wait_uint) { do_test_wait<unsigned int>(); }
+    QAKtest(wait_ui64) { do_test_wait<std::uint64_t>(); }
+
+    //	Test enums.
+
+    enum struct color : signed char { red = -1, green, blue };
+    enum plain_enum { zero, one, big = 0x7fffffff };
+
+    QAKtest(enum_struct)
+    {
+        qak::atomic<color> a;
+        QAK_verify( a.load() == color::green ); // zero-initialized
+        static_assert(sizeof(a) == sizeof(color), "");
+
+        a = color::red;
+        QAK_verify( a == color::red );
+
+        color exp = color::blue;
+        QAK_refute( a.compare_exchange_strong(exp, color::green) );
+        QAK_verify( exp == color::red );
+        QAK_verify( a.compare_exchange_strong(exp, color::blue) );
+        QAK_verify( a.exchange(color::green) == color::blue );
+
+        a.wait(color::red);
+    }
+
+    QAKtest(enum_plain)
+    {
+        qak::atomic<plain_enum> a(big);
+        QAK_verify( a.load() == big );
+        a.store(one, qak::memory_order::release);
+        QAK_verify( a.load(qak::memory_order::acquire) == one );
+    }
+
+    //	Test small trivially copyable structs.
+
+    struct seq_cnt
+    {
+        std::uint32_t seq;
+        std::uint32_t cnt;
+    };
+
+    struct two_shorts
+    {
+        std::uint16_t a, b;
+    };
+
+    QAKtest(struct8)
+    {
+        qak::atomic<seq_cnt> a;
+        static_assert(sizeof(a) == 8, "");
+        QAK_verify( a.load().seq == 0 && a.load().cnt == 0 );
+
+        seq_cnt v = { 1, 2 };
+        a = v;
+        QAK_verify( a.load().seq == 1 && a.load().cnt == 2 );
+
+        //	Bump both halves together.
+        seq_cnt exp = a.load();
+        seq_cnt des = { exp.seq + 1, exp.cnt + 10 };
+        QAK_verify( a.compare_exchange_weak(exp, des) || a.compare_exchange_strong(exp, des) );
+        QAK_verify( a.load().seq == 2 && a.load().cnt == 12 );
+
+        seq_cnt stale = { 1, 2 };
+        QAK_refute( a.compare_exchange_strong(stale, v) );
+        QAK_verify( stale.seq == 2 && stale.cnt == 12 );
+
+        seq_cnt prev = a.exchange(v);
+        QAK_verify( prev.seq == 2 && prev.cnt == 12 );
+    }
+
+    QAKtest(struct4)
+    {
+        two_shorts v = { 0xabcd, 0x1234 };
+        qak::atomic<two_shorts> a(v);
+        two_shorts r = a;
+        QAK_verify( r.a == 0xabcd && r.b == 0x1234 );
+        QAK_verify( a.wait_until(two_shorts(), 0) );
+    }
+
     //	Test bool.
     QAKtest(bool)
     {
@@ -0,0 +1,102 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	atomic_rptr__bench.cxx
+
+#include "qak/atomic_rptr.hxx"
+
+#include "qak/host_info.hxx"
+#include "qak/mutex.hxx"
+#include "qak/stopwatch.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdio> // std::snprintf
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    std::uint64_t const cnt_per_thread = 5*1000*1000;
+
+    struct config final : qak::rpointee_final<config>
+    {
+        int a = 1;
+        int b = 2;
+    };
+
+    //	Runs read_fn cnt_per_thread times on each of 1, 2, 4, ... cnt_cpus_available() threads.
+    template <class Fn>
+    void bench_read_scaling(char const * psz_what, Fn read_fn)
+    {
+        unsigned const cnt_cpus = qak::host_info::cnt_cpus_available();
+
+        for (unsigned n = 1; ; n = (n*2 < cnt_cpus) ? n*2 : cnt_cpus)
+        {
+            qak::stopwatch sw;
+            qak::vector<qak::thread::RP> threads;
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads.push_back(qak::start_thread([&read_fn]() {
+                    for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                        QAK_bench_keep(read_fn());
+                }));
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads[ix]->join();
+            std::int64_t elapsed_ns = sw.elapsed_ns();
+
+            char sz[80];
+            std::snprintf(sz, sizeof(sz), "%s, %u threads (per-thread time)", psz_what, n);
+            QAK_bench_report(sz, cnt_per_thread, elapsed_ns);
+
+            if (n == cnt_cpus)
+                break;
+        }
+    }
+
+    QAKtest(read_scaling, "Readers of a shared config object.")
+    {
+        qak::atomic_rptr<config> arp(config::RP(new config));
+
+        bench_read_scaling("atomic_rptr load_pinned", [&arp]() -> int {
+            auto pp = arp.load_pinned();
+            return pp->a + pp->b;
+        });
+
+        bench_read_scaling("atomic_rptr load", [&arp]() -> int {
+            config::RP rp = arp.load();
+            return rp->a + rp->b;
+        });
+
+        //	What readers do today.
+        qak::mutex mut;
+        config::RP rp_shared(new config);
+        bench_read_scaling("mutex + rptr copy", [&mut, &rp_shared]() -> int {
+            config::RP rp;
+            {
+                qak::mutex_lock lock(mut);
+                rp = rp_shared;
+            }
+            return rp->a + rp->b;
+        });
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,163 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	atomic_rptr__test.cxx
+
+#include "qak/atomic_rptr.hxx"
+
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    qak::atomic<int> cnt_live;
+
+    struct config final : qak::rpointee_final<config>
+    {
+        int a;
+        int b;
+
+        explicit config(int v) : a(v), b(-v) { ++cnt_live; }
+
+        ~config() { a = b = 0x5a5a5a5a; --cnt_live; }
+    };
+
+    QAKtest(basic, "atomic_rptr load, store, and exchange.")
+    {
+        {
+            qak::atomic_rptr<config> arp;
+            QAK_verify( !arp.load() );
+            QAK_verify( !arp.load_pinned() );
+
+            arp.store(config::RP(new config(1)));
+            QAK_verify( arp.load()->a == 1 );
+            QAK_verify( arp.load_pinned()->b == -1 );
+
+            config::RP rp_old = arp.exchange(config::RP(new config(2)));
+            QAK_verify( rp_old->a == 1 );
+            QAK_verify( arp.load()->a == 2 );
+
+            config::RP rp2 = arp.load();
+            QAK_verify( rp2.use_count() == 2 );
+        }
+        qak::epoch_synchronize();
+        QAK_verify( cnt_live == 0 );
+    }
+
+    QAKtest(compare_exchange, "atomic_rptr compare_exchange.")
+    {
+        {
+            config::RP rp1(new config(1));
+            qak::atomic_rptr<config> arp(rp1);
+
+            config::RP rp_expected;
+            QAK_verify( !arp.compare_exchange_strong(rp_expected, config::RP(new config(2))) );
+            QAK_verify( rp_expected == rp1 );
+
+            QAK_verify( arp.compare_exchange_strong(rp_expected, config::RP(new config(3))) );
+            QAK_verify( arp.load()->a == 3 );
+
+            rp_expected.reset();
+            rp1.reset();
+        }
+        qak::epoch_synchronize();
+        QAK_verify( cnt_live == 0 );
+    }
+
+    QAKtest(deferred_reclaim, "A replaced object outlives the readers pinned on it.")
+    {
+        qak::atomic_rptr<config> arp(config::RP(new config(1)));
+        {
+            auto pp = arp.load_pinned();
+            arp.store(config::RP(new config(2)));
+            QAK_verify( pp->a == 1 );
+            QAK_verify( cnt_live == 2 );
+        }
+        qak::epoch_synchronize();
+        QAK_verify( cnt_live == 1 );
+        QAK_verify( arp.load_pinned()->a == 2 );
+    }
+
+    QAKtest(rare_writer, "A writer that stores now and then doesn't keep a backlog of replaced objects alive.")
+    {
+        qak::epoch_synchronize();
+        qak::atomic_rptr<config> arp(config::RP(new config(1)));
+        for (int n = 2; n < 10; ++n)
+        {
+            arp.store(config::RP(new config(n)));
+            QAK_verify( cnt_live <= 2 );
+        }
+        arp.store(config::RP());
+        qak::epoch_synchronize();
+        QAK_verify( cnt_live == 0 );
+    }
+
+    QAKtest(readers_and_writer, "Readers racing with a writer never see a destroyed object.")
+    {
+        {
+            qak::atomic_rptr<config> arp(config::RP(new config(1)));
+            qak::atomic<int> done;
+            qak::atomic<int> cnt_bad;
+
+            qak::vector<qak::thread::RP> threads;
+            for (int ix = 0; ix < 4; ++ix)
+                threads.push_back(qak::start_thread([&arp, &done, &cnt_bad, ix]()
+                {
+                    while (!done)
+                    {
+                        if (ix & 1)
+                        {
+                            auto pp = arp.load_pinned();
+                            if (pp->a != -pp->b)
+                                ++cnt_bad;
+                        }
+                        else
+                        {
+                            config::RP rp = arp.load();
+                            if (rp->a != -rp->b)
+                                ++cnt_bad;
+                        }
+                    }
+                }));
+
+            for (int n = 2; n < 20000; ++n)
+            {
+                if (n & 1)
+                    arp.store(config::RP(new config(n)));
+                else
+                {
+                    config::RP rp_expected = arp.load();
+                    arp.compare_exchange_strong(rp_expected, config::RP(new config(n)));
+                }
+            }
+
+            done = 1;
+            for (auto & th : threads)
+                QAK_verify( th->join() );
+            QAK_verify( cnt_bad == 0 );
+        }
+        qak::epoch_synchronize();
+        QAK_verify( cnt_live == 0 );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
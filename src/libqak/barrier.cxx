@@ -0,0 +1,80 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//
+//	barrier.cxx
+
+#include "qak/barrier.hxx"
+
+#include "qak/fail.hxx"
+#include "qak/imp/spin_wait.hxx"
+
+#include <utility> // std::move
+
+namespace qak { //=====================================================================================================|
+
+	barrier::barrier(std::uint32_t cnt_threads, completion_fn_t completion_fn) :
+		cnt_threads_(cnt_threads),
+		completion_fn_(std::move(completion_fn)),
+		cnt_remaining_(cnt_threads),
+		phase_(0)
+	{
+		fail_unless(0 < cnt_threads);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	bool barrier::arrive_and_wait()
+	{
+		//	The phase can't advance until we've arrived, so this is the one we're arriving in.
+		std::uint32_t phase = phase_->load(memory_order::acquire);
+
+		if (cnt_remaining_->fetch_sub(1, memory_order::acq_rel) == 1)
+		{
+			//	We're last. Release the others even if the completion function throws.
+			struct completer
+			{
+				barrier & b;
+				std::uint32_t phase;
+				~completer() { b.complete_phase_(phase); }
+			} completer_ = { *this, phase };
+
+			if (completion_fn_)
+				completion_fn_();
+
+			return true;
+		}
+
+		//	Phases can be short, so spin a while before parking.
+		if (!spin_until(2000, [&]() { return phase_->load(memory_order::acquire) != phase; }))
+			while (phase_->load(memory_order::acquire) == phase)
+				phase_->wait(phase, memory_order::relaxed);
+
+		return false;
+	}
+
+	void barrier::complete_phase_(std::uint32_t phase) QAK_noexcept
+	{
+		//	The reset must be visible to anyone who sees the new phase.
+		cnt_remaining_->store(cnt_threads_, memory_order::relaxed);
+		phase_->store(phase + 1, memory_order::release);
+		phase_->notify_all();
+	}
+
+} // namespace qak ====================================================================================================|
@@ -0,0 +1,98 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	barrier__test.cxx
+
+#include "qak/barrier.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/thread_group.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+using qak::barrier;
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(single, "A barrier for one thread never waits.")
+    {
+        unsigned cnt_completions = 0;
+        barrier b(1, [&]() { ++cnt_completions; });
+        for (unsigned ix = 0; ix < 5; ++ix)
+            QAK_verify( b.arrive_and_wait() );
+        QAK_verify( cnt_completions == 5 );
+        QAK_verify( b.phase() == 5 );
+        QAK_verify( b.cnt_threads() == 1 );
+    }
+
+    QAKtest(throwing_completion, "A throwing completion function still completes the phase.")
+    {
+        barrier b(1, []() { throw 0; });
+        bool throwed = false;
+        try { b.arrive_and_wait(); } catch (...) { throwed = true; }
+        QAK_verify( throwed );
+        QAK_verify( b.phase() == 1 );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    QAKtest(phases, "thread_group workers step through phases together, each phase seeing the last one's results.")
+    {
+        std::size_t const cnt_threads = 4;
+        unsigned const cnt_phases = 2000;
+
+        //	Each phase, every worker adds its slot's value to the total, then the completion function bumps every
+        //	slot. A worker running ahead or behind would see the wrong values.
+        qak::vector<std::uint64_t> slots(cnt_threads, 0);
+        std::uint64_t total = 0;
+        qak::atomic<std::uint64_t> phase_sum;
+        qak::atomic<unsigned> cnt_wrong;
+        qak::atomic<unsigned> cnt_serial;
+
+        barrier b(cnt_threads, [&]() {
+            total += phase_sum.exchange(0);
+            for (auto & s : slots)
+                ++s;
+        });
+
+        qak::thread_group::RP rp_tg(new qak::thread_group(
+            [&](std::size_t th_ix, qak::thread_group::provide_thread_stop_fn_t provide_stop_fn) {
+                provide_stop_fn([]() { });
+                for (unsigned phase = 0; phase < cnt_phases; ++phase)
+                {
+                    if (slots[th_ix] != phase || b.phase() != phase)
+                        ++cnt_wrong;
+                    phase_sum += slots[th_ix];
+                    if (b.arrive_and_wait())
+                        ++cnt_serial;
+                }
+            },
+            cnt_threads));
+        rp_tg->join();
+
+        QAK_verify( cnt_wrong == 0 );
+        QAK_verify( cnt_serial == cnt_phases );
+        QAK_verify( b.phase() == cnt_phases );
+        QAK_verify( total == cnt_threads*(std::uint64_t(cnt_phases)*(cnt_phases - 1)/2) );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
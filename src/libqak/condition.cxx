@@ -0,0 +1,64 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	condition.cxx
+
+#include "qak/condition.hxx"
+
+#include "qak/fail.hxx"
+#include "qak/now.hxx"
+
+namespace qak { //=====================================================================================================|
+
+	void condition::wait(mutex_lock & lock)
+	{
+		mutex * p_m = lock.p_m_;
+		fail_unless(p_m && p_m->is_locked_by_this_thread());
+
+		//	Read under the mutex, so a state change made under it and then notified bumps seq_ after this.
+		std::uint32_t seq = seq_.load(memory_order::relaxed);
+
+		p_m->release_();
+		seq_.wait(seq);
+		p_m->acquire_();
+	}
+
+	bool condition::wait_until_ns(mutex_lock & lock, std::uint64_t deadline_ns)
+	{
+		mutex * p_m = lock.p_m_;
+		fail_unless(p_m && p_m->is_locked_by_this_thread());
+
+		std::uint32_t seq = seq_.load(memory_order::relaxed);
+
+		p_m->release_();
+		bool notified = seq_.wait_until(seq, deadline_ns);
+		p_m->acquire_();
+
+		return notified;
+	}
+
+	bool condition::wait_for_ns(mutex_lock & lock, std::int64_t max_wait_ns)
+	{
+		if (max_wait_ns < 0)
+			max_wait_ns = 0;
+
+		return wait_until_ns(lock, read_time_source(time_source::wallclock_ns) + max_wait_ns);
+	}
+
+} // namespace qak ====================================================================================================|
@@ -0,0 +1,117 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	condition__test.cxx
+
+#include "qak/condition.hxx"
+
+#include "qak/mutex.hxx"
+#include "qak/now.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(timeout, "A wait with no notification times out, holding the lock again.")
+    {
+        qak::mutex mut;
+        qak::condition cond;
+        qak::mutex_lock lock(mut);
+
+        std::uint64_t t0 = qak::read_time_source(qak::time_source::wallclock_ns);
+        QAK_refute( cond.wait_for_ns(lock, 2*1000*1000) );
+        QAK_verify( 2*1000*1000 <= qak::read_time_source(qak::time_source::wallclock_ns) - t0 );
+        QAK_verify( mut.is_locked_by_this_thread() );
+
+        QAK_refute( cond.wait_until_ns(lock, 0, []() { return false; }) );
+        QAK_verify( cond.wait_until_ns(lock, 0, []() { return true; }) );
+        QAK_verify( mut.is_locked_by_this_thread() );
+    }
+
+    QAKtest(unlocked, "Waiting requires holding the lock.")
+    {
+        qak::mutex mut;
+        qak::condition cond;
+        qak::mutex_lock lock1(mut);
+        qak::mutex_lock lock2 = std::move(lock1);
+
+        bool throwed = false;
+        try { cond.wait(lock1); } catch (...) { throwed = true; }
+        QAK_verify( throwed );
+        QAK_verify( mut.is_locked_by_this_thread() );
+    }
+
+    QAKtest(producer_consumer, "Threads handing off a counter in turn.")
+    {
+        qak::mutex mut;
+        qak::condition cond;
+        std::uint64_t val = 0;
+        std::uint64_t const cnt_turns = 20*1000;
+
+        //	Each thread waits for its parity, then bumps the value.
+        auto fn = [&](std::uint64_t parity) {
+            for (std::uint64_t ix = 0; ix < cnt_turns; ++ix)
+            {
+                qak::mutex_lock lock(mut);
+                cond.wait(lock, [&]() { return val % 2 == parity; });
+                ++val;
+                cond.notify_one();
+            }
+        };
+        qak::thread::RP th = qak::start_thread([&]() { fn(1); });
+        fn(0);
+        th->join();
+
+        QAK_verify( val == 2*cnt_turns );
+    }
+
+    QAKtest(notify_all, "Every waiter wakes.")
+    {
+        qak::mutex mut;
+        qak::condition cond;
+        bool go = false;
+        unsigned cnt_waiting = 0;
+        unsigned const cnt_threads = 4;
+
+        qak::vector<qak::thread::RP> threads;
+        for (unsigned n = 0; n < cnt_threads; ++n)
+            threads.push_back(qak::start_thread_uintptr([&]() -> std::uintptr_t {
+                qak::mutex_lock lock(mut);
+                ++cnt_waiting;
+                cond.notify_all();
+                cond.wait(lock, [&]() { return go; });
+                return mut.is_locked_by_this_thread();
+            }));
+
+        {
+            qak::mutex_lock lock(mut);
+            cond.wait(lock, [&]() { return cnt_waiting == cnt_threads; });
+            go = true;
+        }
+        cond.notify_all();
+
+        for (auto & th : threads)
+            QAK_verify( *th->join() == 1 );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,294 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	epoch.cxx
+
+#include "qak/epoch.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/mutex.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cassert>
+#include <cstdint> // std::uintptr_t
+
+namespace qak_epoch_imp_ { //==========================================================================================|
+
+	using qak::memory_order;
+
+	//	A thread reclaims once it has retired this many objects, or sooner if the global epoch has moved.
+	std::size_t const reclaim_threshold = 64;
+
+	struct retired
+	{
+		void * p;
+		void (* fn)(void *);
+		std::uintptr_t epoch;
+	};
+
+	typedef qak::vector<retired> retired_list;
+
+	//	Per-thread state. Records are never freed; a thread that exits gives its record back for reuse.
+	//
+	struct thread_rec
+	{
+		//	Written only by the owning thread. Zero when not pinned, otherwise (epoch << 1) | 1.
+		qak::atomic<std::uintptr_t> pinned_epoch;
+
+		//	Nonzero while the record is owned by a thread.
+		qak::atomic<std::uintptr_t> in_use;
+
+		//	The rest is private to the owning thread.
+
+		unsigned cnt_nest = 0;
+		bool reclaiming = false;
+		retired_list limbo;
+
+		//	The global epoch as of the last reclaim.
+		std::uintptr_t scanned_epoch = 0;
+
+		//	Immutable once the record is published.
+		thread_rec * p_next = 0;
+	};
+
+	struct registry
+	{
+		qak::atomic<std::uintptr_t> global_epoch;
+		qak::atomic<thread_rec *> p_head;
+
+		//	Retired objects left behind by exited threads.
+		qak::mutex orphans_mut { "qak::epoch orphans" };
+		retired_list orphans;
+		qak::atomic<std::uintptr_t> cnt_orphans;
+	};
+
+	//	Never destroyed, since thread_local destructors may run after static ones.
+	registry & the_registry()
+	{
+		static registry * p_reg = new registry;
+		return *p_reg;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	void release_rec(thread_rec * p_rec) QAK_noexcept;
+
+	struct tls_holder
+	{
+		thread_rec * p_rec = 0;
+
+		~tls_holder() { if (p_rec) release_rec(p_rec); }
+	};
+
+	thread_local tls_holder tls;
+
+	thread_rec * acquire_rec()
+	{
+		registry & reg = the_registry();
+
+		//	Reuse a record given back by an exited thread.
+		for (thread_rec * p = reg.p_head.load(memory_order::acquire); p; p = p->p_next)
+		{
+			std::uintptr_t expected = 0;
+			if (!p->in_use.load(memory_order::relaxed) && p->in_use.compare_exchange_strong(expected, 1))
+				return p;
+		}
+
+		thread_rec * p_rec = new thread_rec;
+		p_rec->in_use.store(1, memory_order::relaxed);
+
+		thread_rec * p_head = reg.p_head.load(memory_order::relaxed);
+		do {
+			p_rec->p_next = p_head;
+		} while (!reg.p_head.compare_exchange_weak(p_head, p_rec, memory_order::release, memory_order::relaxed));
+
+		return p_rec;
+	}
+
+	inline thread_rec * this_thread_rec()
+	{
+		thread_rec * p_rec = tls.p_rec;
+		if (!p_rec)
+			p_rec = tls.p_rec = acquire_rec();
+		return p_rec;
+	}
+
+	//	Advances the global epoch iff every pinned thread has observed the current one.
+	void try_advance(registry & reg) QAK_noexcept
+	{
+		std::uintptr_t e = reg.global_epoch.load();
+		std::uintptr_t const pinned_e = (e << 1) | 1;
+
+		for (thread_rec * p = reg.p_head.load(memory_order::acquire); p; p = p->p_next)
+		{
+			std::uintptr_t pe = p->pinned_epoch.load();
+			if (pe && pe != pinned_e)
+				return;
+		}
+
+		reg.global_epoch.compare_exchange_strong(e, e + 1);
+	}
+
+	//	Moves the entries of 'from' that are safe to reclaim into 'to'.
+	void collect_ready(retired_list & from, retired_list & to, std::uintptr_t global_e) QAK_noexcept
+	{
+		std::size_t n_keep = 0;
+		for (std::size_t ix = 0; ix < from.size(); ++ix)
+		{
+			//	Threads pinned when an entry was retired have unpinned once the global epoch is two past it.
+			if (from[ix].epoch + 2 <= global_e)
+				to.push_back(from[ix]);
+			else
+				from[n_keep++] = from[ix];
+		}
+		from.resize(n_keep);
+	}
+
+	void reclaim(thread_rec * p_rec)
+	{
+		//	A reclaimed object's destructor may itself retire things.
+		if (p_rec->reclaiming)
+			return;
+		p_rec->reclaiming = true;
+
+		registry & reg = the_registry();
+		try_advance(reg);
+
+		if (reg.cnt_orphans.load(memory_order::relaxed))
+		{
+			if (qak::optional<qak::mutex_lock> opt_lock = reg.orphans_mut.try_lock())
+			{
+				for (std::size_t ix = 0; ix < reg.orphans.size(); ++ix)
+					p_rec->limbo.push_back(reg.orphans[ix]);
+				reg.orphans.clear();
+				reg.cnt_orphans.store(0, memory_order::relaxed);
+			}
+		}
+
+		std::uintptr_t const global_e = reg.global_epoch.load();
+		p_rec->scanned_epoch = global_e;
+
+		retired_list ready;
+		collect_ready(p_rec->limbo, ready, global_e);
+
+		for (std::size_t ix = 0; ix < ready.size(); ++ix)
+			ready[ix].fn(ready[ix].p);
+
+		p_rec->reclaiming = false;
+	}
+
+	void release_rec(thread_rec * p_rec) QAK_noexcept
+	{
+		assert(!p_rec->cnt_nest);
+
+		reclaim(p_rec);
+
+		if (!p_rec->limbo.empty())
+		{
+			registry & reg = the_registry();
+			qak::mutex_lock lock(reg.orphans_mut);
+			for (std::size_t ix = 0; ix < p_rec->limbo.size(); ++ix)
+				reg.orphans.push_back(p_rec->limbo[ix]);
+			p_rec->limbo.clear();
+			reg.cnt_orphans.store(reg.orphans.size(), memory_order::relaxed);
+		}
+
+		p_rec->in_use.store(0, memory_order::release);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	thread_rec * pin()
+	{
+		thread_rec * p_rec = this_thread_rec();
+		if (!p_rec->cnt_nest++)
+		{
+			//	The exchange is a full barrier, so the pin is visible to writers before this thread reads any
+			//	shared pointer.
+			std::uintptr_t e = the_registry().global_epoch.load();
+			p_rec->pinned_epoch.exchange((e << 1) | 1);
+		}
+		return p_rec;
+	}
+
+	void unpin(thread_rec * p_rec) QAK_noexcept
+	{
+		assert(p_rec->cnt_nest);
+		if (!--p_rec->cnt_nest)
+			p_rec->pinned_epoch.store(0, memory_order::release);
+	}
+
+} // namespace qak_epoch_imp_
+namespace qak { //=====================================================================================================|
+
+	void epoch_retire(void * p, void (* fn)(void *))
+	{
+		using namespace qak_epoch_imp_;
+
+		thread_rec * p_rec = this_thread_rec();
+
+		registry & reg = the_registry();
+
+		retired r = { p, fn, reg.global_epoch.load() };
+		p_rec->limbo.push_back(r);
+
+		//	Only reclaiming advances the epoch, so try here too. Otherwise a thread that retires now and then would keep
+		//	its last few objects in limbo until it had retired reclaim_threshold of them.
+		try_advance(reg);
+		if (reclaim_threshold <= p_rec->limbo.size() || reg.global_epoch.load() != p_rec->scanned_epoch)
+			reclaim(p_rec);
+	}
+
+	void epoch_synchronize()
+	{
+		using namespace qak_epoch_imp_;
+
+		thread_rec * p_rec = this_thread_rec();
+		assert(!p_rec->cnt_nest || !"epoch_synchronize called while pinned");
+
+		registry & reg = the_registry();
+
+		//	Everything retired before now has an epoch no later than this one.
+		std::uintptr_t const target_e = reg.global_epoch.load() + 2;
+
+		{
+			qak::mutex_lock lock(reg.orphans_mut);
+			for (std::size_t ix = 0; ix < reg.orphans.size(); ++ix)
+				p_rec->limbo.push_back(reg.orphans[ix]);
+			reg.orphans.clear();
+			reg.cnt_orphans.store(0, memory_order::relaxed);
+		}
+
+		for (unsigned cnt_spins = 0; reg.global_epoch.load() < target_e; ++cnt_spins)
+		{
+			try_advance(reg);
+			if (reg.global_epoch.load() < target_e)
+			{
+				if (cnt_spins < 100)
+					qak::this_thread::yield();
+				else
+					qak::this_thread::sleep_us(100);
+			}
+		}
+
+		reclaim(p_rec);
+	}
+
+} // namespace qak ====================================================================================================|
@@ -0,0 +1,678 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//
+//	executor.cxx
+
+#include "qak/executor.hxx"
+
+#include "qak/host_info.hxx"
+#include "qak/imp/spin_wait.hxx"
+#include "qak/mutex.hxx"
+#include "qak/padded.hxx"
+#include "qak/pool.hxx"
+#include "qak/prng64.hxx"
+#include "qak/vector.hxx"
+
+namespace qak_executor_imp_ { //=======================================================================================|
+
+	using qak::atomic;
+	using qak::memory_order;
+
+	//	Never destroyed, since tasks may be freed from thread_local or static destructors.
+	qak::fixed_pool & task_pool()
+	{
+		static qak::fixed_pool & pool = *new qak::fixed_pool(sizeof(task_node), alignof(task_node));
+		return pool;
+	}
+
+	task_node * alloc_task_node()
+	{
+		return static_cast<task_node *>(task_pool().allocate());
+	}
+
+	void free_task_node(task_node * p) QAK_noexcept
+	{
+		task_pool().deallocate(p);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	A Chase-Lev work-stealing deque (Chase and Lev 2005, with the orderings of Le et al. 2013). The owning worker
+	//	pushes and takes at the bottom; other threads steal from the top. The orderings that matter are seq_cst
+	//	operations rather than fences, since our atomic_thread_fence is always a full barrier.
+	//
+	struct ws_deque
+	{
+		struct ring
+		{
+			std::int64_t mask;
+			atomic<task_node *> * p_slots;
+
+			explicit ring(std::int64_t cap) : mask(cap - 1), p_slots(new atomic<task_node *>[cap]) { }
+			~ring() { delete [] p_slots; }
+
+			task_node * get(std::int64_t ix) const { return p_slots[ix & mask].load(memory_order::relaxed); }
+			void put(std::int64_t ix, task_node * p) { p_slots[ix & mask].store(p, memory_order::relaxed); }
+		};
+
+		static std::int64_t const initial_cap = 256;
+
+		qak::padded<atomic<std::int64_t>> top_;
+		qak::padded<atomic<std::int64_t>> bottom_;
+		atomic<ring *> p_ring_;
+
+		//	Rings outgrown. A thief may still be reading one, so they're kept until the deque is destroyed. Each is
+		//	half the size of the next, so they at most double the memory.
+		qak::vector<ring *> old_rings_;
+
+		ws_deque() : top_(0), bottom_(0), p_ring_(new ring(initial_cap)) { }
+
+		~ws_deque()
+		{
+			delete p_ring_.load(memory_order::relaxed);
+			for (ring * p : old_rings_)
+				delete p;
+		}
+
+		//	Owner only.
+		void push(task_node * p)
+		{
+			std::int64_t b = bottom_->load(memory_order::relaxed);
+			std::int64_t t = top_->load(memory_order::acquire);
+			ring * r = p_ring_.load(memory_order::relaxed);
+			if (r->mask < b - t)
+				r = grow(r, t, b);
+
+			r->put(b, p);
+
+			//	Publishes the slot to thieves, and orders the push before the caller's look for sleeping workers.
+			bottom_->store(b + 1, memory_order::seq_cst);
+		}
+
+		//	Owner only. The most recently pushed task, or null.
+		task_node * take()
+		{
+			std::int64_t b = bottom_->load(memory_order::relaxed) - 1;
+			ring * r = p_ring_.load(memory_order::relaxed);
+			bottom_->store(b, memory_order::seq_cst);
+			std::int64_t t = top_->load(memory_order::seq_cst);
+
+			if (b < t)
+			{
+				bottom_->store(b + 1, memory_order::relaxed);
+				return 0;
+			}
+
+			task_node * p = r->get(b);
+			if (t == b)
+			{
+				//	The last one. Race thieves for it.
+				if (!top_->compare_exchange_strong(t, t + 1, memory_order::seq_cst, memory_order::relaxed))
+					p = 0;
+				bottom_->store(b + 1, memory_order::relaxed);
+			}
+			return p;
+		}
+
+		//	Any thread. The least recently pushed task, or null if there's none.
+		task_node * steal()
+		{
+			for (;;)
+			{
+				std::int64_t t = top_->load(memory_order::seq_cst);
+				std::int64_t b = bottom_->load(memory_order::seq_cst);
+				if (b <= t)
+					return 0;
+
+				task_node * p = p_ring_.load(memory_order::acquire)->get(t);
+
+				//	Failure means another thread took this one, so the loop always makes progress.
+				if (top_->compare_exchange_strong(t, t + 1, memory_order::seq_cst, memory_order::relaxed))
+					return p;
+			}
+		}
+
+		//	Leaves the deque as it was if it throws.
+		ring * grow(ring * r, std::int64_t t, std::int64_t b)
+		{
+			ring * r2 = new ring(2*(r->mask + 1));
+			for (std::int64_t ix = t; ix < b; ++ix)
+				r2->put(ix, r->get(ix));
+
+			try
+			{
+				old_rings_.push_back(r);
+			}
+			catch (...)
+			{
+				delete r2;
+				throw;
+			}
+			p_ring_.store(r2, memory_order::release);
+			return r2;
+		}
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	One per worker thread. Kept for the life of the executor and reused when the thread_group starts
+	//	another thread, so thieves can read any of them without coordinating with threads coming and going.
+	//
+	struct worker
+	{
+		ws_deque deque;
+		executor_data * p_ed;
+		atomic<bool> stop_requested;
+		bool is_active; // guarded by workers_mut
+
+		explicit worker(executor_data * p) : p_ed(p), stop_requested(false), is_active(false) { }
+	};
+
+	//	The worker the calling thread is running, if any.
+	thread_local worker * tls_p_worker = 0;
+
+	//	For choosing victims.
+	thread_local qak::prng64 tls_prng(reinterpret_cast<std::uintptr_t>(&tls_p_worker));
+
+	//	Snapshots of the set of workers, for thieves. Replaced, never changed, as workers are added.
+	struct worker_list
+	{
+		qak::vector<worker *> workers;
+	};
+
+	//	The most tasks a worker moves from the injection queue to its deque at once.
+	std::size_t const cnt_inject_batch = 32;
+
+	//	Polls for work this many times before parking.
+	unsigned const cnt_idle_spins = 200;
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	struct executor_data
+	{
+		//	Tasks submitted by threads that aren't workers, FIFO, linked through p_next.
+		qak::mutex inject_mut;
+		task_node * p_inject_head;
+		task_node * p_inject_tail;
+		atomic<std::size_t> cnt_injected;
+
+		//	An eventcount. A worker with nothing to do reads wake_seq, counts itself in cnt_sleepers, looks for work
+		//	once more, then waits for wake_seq to change. Submitters wake one if cnt_sleepers is nonzero.
+		//
+		//	wake_pending is set from a wake until a worker leaves the sleepers, so a burst of submissions makes one
+		//	futex call rather than one each. The worker, having found a task, wakes the next in the same way, and so
+		//	on while there's work.
+		qak::padded<atomic<std::uint32_t>> wake_seq;
+		qak::padded<atomic<std::uint32_t>> cnt_sleepers;
+		qak::padded<atomic<bool>> wake_pending;
+
+		//	Another eventcount, for threads with nothing to run in task_group::wait. They're woken when any group's
+		//	last task finishes, and when tasks are injected, as with no worker free those may be left to them.
+		qak::padded<atomic<std::uint32_t>> waiter_seq;
+		qak::padded<atomic<std::uint32_t>> cnt_waiters;
+
+		qak::mutex workers_mut;
+		qak::vector<worker *> all_workers;
+		qak::vector<worker_list *> worker_lists;
+		atomic<worker_list *> p_worker_list;
+
+		qak::thread_group::RP rp_tg;
+
+		executor_data() :
+			inject_mut("qak::executor injection queue"),
+			p_inject_head(0),
+			p_inject_tail(0),
+			cnt_injected(0),
+			wake_seq(0),
+			cnt_sleepers(0),
+			wake_pending(false),
+			waiter_seq(0),
+			cnt_waiters(0),
+			workers_mut("qak::executor workers"),
+			p_worker_list(0)
+		{
+			worker_lists.push_back(new worker_list());
+			p_worker_list.store(worker_lists.back(), memory_order::release);
+		}
+
+		~executor_data()
+		{
+			for (worker_list * p : worker_lists)
+				delete p;
+			for (worker * p : all_workers)
+				delete p;
+		}
+
+		//	The calling thread's worker, if it's one of ours.
+		worker * this_thread_worker() const
+		{
+			worker * p_w = tls_p_worker;
+			return p_w && p_w->p_ed == this ? p_w : 0;
+		}
+
+		//	Doesn't throw: if the worker's deque can't grow, the task goes in the injection queue, which needs no
+		//	allocation.
+		void submit(task_node * p) QAK_noexcept
+		{
+			worker * p_w = this_thread_worker();
+			bool pushed = false;
+			if (p_w)
+			{
+				try
+				{
+					p_w->deque.push(p);
+					pushed = true;
+				}
+				catch (...)
+				{
+				}
+			}
+			if (!pushed)
+				inject(p);
+
+			wake_one();
+		}
+
+		//	Both push and inject end in a seq_cst store or RMW, so either we see the sleeper count a parking worker
+		//	has raised, or it sees our task. If a wake is already pending, the worker it wakes clears wake_pending
+		//	before looking for work, so it sees our task or we see the flag clear.
+		void wake_one()
+		{
+			if (cnt_sleepers->load(memory_order::seq_cst) && !wake_pending->exchange(true, memory_order::seq_cst))
+			{
+				wake_seq->fetch_add(1, memory_order::seq_cst);
+				wake_seq->notify_one();
+			}
+		}
+
+		void inject(task_node * p) QAK_noexcept
+		{
+			{
+				qak::mutex_lock lock(inject_mut);
+				p->p_next = 0;
+				if (p_inject_tail)
+					p_inject_tail->p_next = p;
+				else
+					p_inject_head = p;
+				p_inject_tail = p;
+			}
+			cnt_injected.fetch_add(1, memory_order::seq_cst);
+
+			wake_waiters();
+		}
+
+		//	The RMW that made the change a waiter is waiting for is seq_cst, so either we see the waiter counted or
+		//	it sees the change.
+		void wake_waiters() QAK_noexcept
+		{
+			if (cnt_waiters->load(memory_order::seq_cst))
+			{
+				waiter_seq->fetch_add(1, memory_order::seq_cst);
+				waiter_seq->notify_all();
+			}
+		}
+
+		//	Returns the oldest injected task. A worker also takes up to cnt_inject_batch - 1 more onto its deque,
+		//	where others can steal them, which saves taking the lock for each.
+		task_node * pop_injected(worker * p_w)
+		{
+			if (!cnt_injected.load(memory_order::seq_cst))
+				return 0;
+
+			task_node * p_first = 0;
+			std::size_t cnt = 0;
+			{
+				qak::mutex_lock lock(inject_mut);
+				p_first = p_inject_head;
+				task_node * p_last = 0;
+				for (task_node * p = p_first; p && cnt < (p_w ? cnt_inject_batch : 1); p = p->p_next)
+				{
+					p_last = p;
+					++cnt;
+				}
+				if (!cnt)
+					return 0;
+
+				p_inject_head = p_last->p_next;
+				if (!p_inject_head)
+					p_inject_tail = 0;
+				p_last->p_next = 0;
+				cnt_injected.fetch_sub(cnt, memory_order::relaxed);
+			}
+
+			//	Only a worker takes more than one.
+			if (p_w)
+			{
+				for (task_node * p = p_first->p_next; p; )
+				{
+					task_node * p_next = p->p_next;
+					p_w->deque.push(p);
+					p = p_next;
+				}
+			}
+			return p_first;
+		}
+
+		//	Tries the victims in turn from a random one, skipping p_self.
+		task_node * steal(worker const * p_self)
+		{
+			worker_list const & wl = *p_worker_list.load(memory_order::acquire);
+			std::size_t cnt = wl.workers.size();
+			if (!cnt)
+				return 0;
+
+			std::size_t ix = tls_prng.generate_below(cnt);
+			for (std::size_t n = 0; n < cnt; ++n)
+			{
+				worker * p_victim = wl.workers[ix];
+				if (p_victim != p_self)
+					if (task_node * p = p_victim->deque.steal())
+						return p;
+				if (++ix == cnt)
+					ix = 0;
+			}
+			return 0;
+		}
+
+		//	Own deque first, for locality, then the injection queue, then other workers.
+		task_node * find_task(worker * p_w)
+		{
+			task_node * p = p_w ? p_w->deque.take() : 0;
+			if (!p)
+				p = pop_injected(p_w);
+			if (!p)
+				p = steal(p_w);
+			return p;
+		}
+
+		static void run_task(task_node * p) QAK_noexcept
+		{
+			qak::task_group * p_group = p->p_group;
+			try
+			{
+				p->p_run_fn(p);
+			}
+			catch (...)
+			{
+				if (!p_group)
+					std::terminate();
+				if (!p_group->has_exception_.exchange(true, memory_order::relaxed))
+					p_group->ep_ = std::current_exception();
+			}
+
+			free_task_node(p);
+			if (p_group)
+				p_group->task_done_();
+		}
+
+		//	Returns a task, or null if woken with none found (e.g., to stop).
+		task_node * wait_for_task(worker & w)
+		{
+			task_node * p = 0;
+			if (qak::spin_until(cnt_idle_spins, [&]() {
+					return (p = find_task(&w)) != 0 || w.stop_requested.load(memory_order::relaxed); }))
+				return p;
+
+			std::uint32_t seq = wake_seq->load(memory_order::seq_cst);
+			cnt_sleepers->fetch_add(1, memory_order::seq_cst);
+
+			p = find_task(&w);
+			if (!p && !w.stop_requested.load(memory_order::seq_cst))
+				wake_seq->wait(seq, memory_order::relaxed);
+
+			cnt_sleepers->fetch_sub(1, memory_order::relaxed);
+			wake_pending->store(false, memory_order::seq_cst);
+
+			if (!p)
+				p = find_task(&w);
+			if (p)
+				wake_one();
+			return p;
+		}
+
+		void wake_all()
+		{
+			wake_seq->fetch_add(1, memory_order::seq_cst);
+			wake_seq->notify_all();
+		}
+
+		//	Runs tasks until cnt_pending reaches zero, then returns.
+		//
+		//	A thread that isn't one of our workers borrows a worker for the duration, so the tasks it spawns
+		//	meanwhile go on a deque of its own. In the injection queue, it would run them last, after unrelated
+		//	tasks, each of which could wait in turn, nesting without limit.
+		//
+		void help_until_done(atomic<std::uint32_t> & cnt_pending)
+		{
+			if (worker * p_w = this_thread_worker())
+				return help_until_done(*p_w, cnt_pending);
+
+			worker * p_prev = tls_p_worker;
+			worker & w = claim_worker();
+			tls_p_worker = &w;
+			help_until_done(w, cnt_pending);
+			tls_p_worker = p_prev;
+			release_worker(w);
+		}
+
+		void help_until_done(worker & w, atomic<std::uint32_t> & cnt_pending)
+		{
+			for (;;)
+			{
+				std::uint32_t cnt = cnt_pending.load(memory_order::acquire);
+				if (!cnt)
+					return;
+
+				task_node * p = 0;
+				if (qak::spin_until(cnt_idle_spins, [&]() {
+						return (p = find_task(&w)) != 0 || !cnt_pending.load(memory_order::relaxed); }))
+				{
+					if (p)
+						run_task(p);
+					continue;
+				}
+
+				//	The rest are running on other threads, which run what they spawn, so mostly there's nothing
+				//	for us to do until the last finishes. But a worker that stops hands its deque to the
+				//	injection queue, and there may be no other worker to run what it hands on, so park where
+				//	either will wake us.
+				std::uint32_t seq = waiter_seq->load(memory_order::seq_cst);
+				cnt_waiters->fetch_add(1, memory_order::seq_cst);
+
+				if (cnt_pending.load(memory_order::seq_cst) && !(p = find_task(&w)))
+					waiter_seq->wait(seq, memory_order::relaxed);
+
+				cnt_waiters->fetch_sub(1, memory_order::relaxed);
+				if (p)
+					run_task(p);
+			}
+		}
+
+		//-------------------------------------------------------------------------------------------------------------|
+
+		worker & claim_worker()
+		{
+			qak::mutex_lock lock(workers_mut);
+
+			for (worker * p : all_workers)
+				if (!p->is_active)
+				{
+					p->is_active = true;
+					p->stop_requested.store(false, memory_order::relaxed);
+					return *p;
+				}
+
+			worker * p_w = new worker(this);
+			p_w->is_active = true;
+			all_workers.push_back(p_w);
+
+			worker_list * p_wl = new worker_list();
+			p_wl->workers = all_workers;
+			worker_lists.push_back(p_wl);
+			p_worker_list.store(p_wl, memory_order::release);
+
+			return *p_w;
+		}
+
+		//	Hands anything left in the deque to the other workers.
+		void release_worker(worker & w)
+		{
+			bool any = false;
+			while (task_node * p = w.deque.take())
+			{
+				inject(p);
+				any = true;
+			}
+			if (any)
+				wake_all();
+
+			qak::mutex_lock lock(workers_mut);
+			w.is_active = false;
+		}
+
+		void thread_fn(qak::thread_group::provide_thread_stop_fn_t provide_stop_fn)
+		{
+			worker & w = claim_worker();
+			provide_stop_fn([this, &w]() {
+				w.stop_requested.store(true, memory_order::seq_cst);
+				wake_all();
+			});
+
+			tls_p_worker = &w;
+			while (!w.stop_requested.load(memory_order::relaxed))
+				if (task_node * p = find_task(&w))
+					run_task(p);
+				else if ((p = wait_for_task(w)))
+					run_task(p);
+			tls_p_worker = 0;
+
+			release_worker(w);
+		}
+	};
+
+} // namespace qak_executor_imp_
+namespace qak { //=====================================================================================================|
+
+	using qak_executor_imp_::executor_data;
+	using qak_executor_imp_::task_node;
+
+	executor::executor(std::size_t cnt_threads, thread_options const & opts) :
+		p_data_(new executor_data())
+	{
+		if (!cnt_threads)
+			cnt_threads = host_info::cnt_threads_recommended();
+
+		executor_data * p_ed = p_data_;
+		try
+		{
+			opts.validate();
+
+			//	If this throws, the thread_group has joined any workers it started.
+			p_ed->rp_tg = thread_group::RP(new thread_group(
+				[p_ed](std::size_t, thread_group::provide_thread_stop_fn_t provide_stop_fn) {
+					p_ed->thread_fn(provide_stop_fn);
+				},
+				cnt_threads,
+				opts));
+		}
+		catch (...)
+		{
+			delete p_ed;
+			throw;
+		}
+	}
+
+	executor::~executor()
+	{
+		p_data_->rp_tg->request_all_stop();
+		p_data_->rp_tg->join();
+
+		while (task_node * p = p_data_->pop_injected(0))
+			executor_data::run_task(p);
+
+		delete p_data_;
+	}
+
+	void executor::submit_(task_node * p) QAK_noexcept
+	{
+		p_data_->submit(p);
+	}
+
+	bool executor::run_one()
+	{
+		task_node * p = p_data_->find_task(p_data_->this_thread_worker());
+		if (p)
+			executor_data::run_task(p);
+		return p != 0;
+	}
+
+	thread_group & executor::threads()
+	{
+		return *p_data_->rp_tg;
+	}
+
+	executor & default_executor()
+	{
+		static executor & ex = *new executor();
+		return ex;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	task_group::~task_group()
+	{
+		try
+		{
+			wait();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	void task_group::wait()
+	{
+		if (cnt_pending_.load(memory_order::acquire))
+			wait_imp_();
+
+		//	Written before the task that threw counted itself done.
+		if (has_exception_.load(memory_order::relaxed))
+		{
+			std::exception_ptr ep = ep_;
+			ep_ = std::exception_ptr();
+			has_exception_.store(false, memory_order::relaxed);
+			std::rethrow_exception(ep);
+		}
+	}
+
+	void task_group::task_done_() QAK_noexcept
+	{
+		//	The group may be gone as soon as the count reaches zero, so don't touch it after.
+		executor_data * p_ed = ex_.p_data_;
+		if (cnt_pending_.fetch_sub(1, memory_order::seq_cst) == 1)
+			p_ed->wake_waiters();
+	}
+
+	void task_group::wait_imp_()
+	{
+		ex_.p_data_->help_until_done(cnt_pending_);
+	}
+
+} // namespace qak ====================================================================================================|
@@ -0,0 +1,151 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	executor__bench.cxx
+
+#include "qak/executor.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/host_info.hxx"
+#include "qak/latch.hxx"
+#include "qak/min_max.hxx"
+#include "qak/stopwatch.hxx"
+
+#include <cstdio> // std::snprintf
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    std::uint64_t fib_serial(unsigned n)
+    {
+        return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+    }
+
+    //	A task for every call, with no cutoff to serial code, so it's nearly all scheduling overhead.
+    std::uint64_t fib(qak::executor & ex, unsigned n)
+    {
+        if (n < 2)
+            return n;
+
+        std::uint64_t a = 0;
+        qak::task_group tg(ex);
+        tg.run([&]() { a = fib(ex, n - 1); });
+        std::uint64_t b = fib(ex, n - 2);
+        tg.wait();
+        return a + b;
+    }
+
+    QAKtest(fib, "Recursive fib, a task per call, on 1, 2, 4, ... workers. Time is per call.")
+    {
+        unsigned const n = 27;
+        std::uint64_t const cnt_calls = 2*fib_serial(n + 1) - 1;
+        std::uint64_t const expected = fib_serial(n);
+
+        {
+            qak::stopwatch sw;
+            std::uint64_t r = fib_serial(n);
+            QAK_bench_report("serial", cnt_calls, sw.elapsed_ns());
+            QAK_verify( r == expected );
+        }
+
+        std::size_t const cnt_threads_max = qak::host_info::cnt_threads_recommended();
+        for (std::size_t cnt_threads = 1; ; cnt_threads = qak::min(2*cnt_threads, cnt_threads_max))
+        {
+            qak::executor ex(cnt_threads);
+
+            //	Run from a worker, so the root is on a deque like the rest.
+            std::uint64_t r = 0;
+            std::int64_t elapsed_ns = 0;
+            qak::task_group tg(ex);
+            tg.run([&]() {
+                qak::stopwatch sw;
+                r = fib(ex, n);
+                elapsed_ns = sw.elapsed_ns();
+            });
+            tg.wait();
+
+            char sz[80];
+            std::snprintf(sz, sizeof(sz), "executor, %zu workers", cnt_threads);
+            QAK_bench_report(sz, cnt_calls, elapsed_ns);
+            QAK_verify( r == expected );
+
+            if (cnt_threads == cnt_threads_max)
+                break;
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    QAKtest(fan_out, "A thread outside the pool submits a round of small tasks through a task_group, then waits.")
+    {
+        qak::executor ex;
+        std::uint64_t const cnt_rounds = 2000;
+
+        for (std::uint64_t cnt_per_round : { 1, 16, 1000 })
+        {
+            qak::atomic<std::uint64_t> cnt_run;
+            qak::stopwatch sw;
+            for (std::uint64_t round = 0; round < cnt_rounds; ++round)
+            {
+                qak::task_group tg(ex);
+                for (std::uint64_t ix = 0; ix < cnt_per_round; ++ix)
+                    tg.run([&]() { cnt_run.fetch_add(1, qak::memory_order::relaxed); });
+                tg.wait();
+            }
+            std::int64_t elapsed_ns = sw.elapsed_ns();
+
+            char sz[80];
+            std::snprintf(sz, sizeof(sz), "%llu tasks per round (per-round latency)",
+                static_cast<unsigned long long>(cnt_per_round));
+            QAK_bench_report(sz, cnt_rounds, elapsed_ns);
+            std::snprintf(sz, sizeof(sz), "%llu tasks per round (per-task time)",
+                static_cast<unsigned long long>(cnt_per_round));
+            QAK_bench_report(sz, cnt_rounds*cnt_per_round, elapsed_ns);
+
+            QAK_verify( cnt_run.load() == cnt_rounds*cnt_per_round );
+        }
+    }
+
+    QAKtest(wake, "One task at a time submitted to idle, possibly parked, workers. Time is to when it starts running.")
+    {
+        qak::executor ex;
+        std::uint64_t const cnt_iters = 2000;
+
+        std::uint64_t total_ns = 0;
+        for (std::uint64_t ix = 0; ix < cnt_iters; ++ix)
+        {
+            //	Not a task_group, whose wait would run the task on this thread.
+            std::int64_t started_ns = 0;
+            qak::latch started(1);
+            qak::stopwatch sw;
+            ex.submit([&]() {
+                started_ns = sw.elapsed_ns();
+                started.count_down();
+            });
+            started.wait();
+            total_ns += static_cast<std::uint64_t>(started_ns);
+        }
+        QAK_bench_report("submit to start", cnt_iters, total_ns);
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,200 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	executor__test.cxx
+
+#include "qak/executor.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/host_info.hxx"
+#include "qak/latch.hxx"
+#include "qak/thread_group.hxx"
+
+#include <stdexcept> // std::runtime_error
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(submit, "Tasks submitted from outside the workers all run.")
+    {
+        std::uint32_t const cnt_tasks = 10*1000;
+
+        qak::executor ex(4);
+        qak::atomic<std::uint32_t> cnt_run;
+        qak::latch done(cnt_tasks);
+
+        for (std::uint32_t ix = 0; ix < cnt_tasks; ++ix)
+            ex.submit([&]() {
+                ++cnt_run;
+                done.count_down();
+            });
+
+        done.wait();
+        QAK_verify( cnt_run.load() == cnt_tasks );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    std::uint64_t fib(qak::executor & ex, unsigned n)
+    {
+        if (n < 2)
+            return n;
+
+        std::uint64_t a = 0;
+        qak::task_group tg(ex);
+        tg.run([&]() { a = fib(ex, n - 1); });
+        std::uint64_t b = fib(ex, n - 2);
+        tg.wait();
+        return a + b;
+    }
+
+    QAKtest(fork_join, "Recursive fib, a task per call, with workers stealing from each other.")
+    {
+        qak::executor ex(4);
+        QAK_verify( fib(ex, 20) == 6765 );
+        QAK_verify( fib(ex, 25) == 75025 );
+    }
+
+    QAKtest(large_closure, "A closure too big to store inline.")
+    {
+        struct big
+        {
+            std::uint64_t arr[64];
+        } b;
+        QAK_verify( qak::executor::task_inline_bytes < sizeof(b) );
+
+        std::uint64_t expected = 0;
+        for (unsigned ix = 0; ix < 64; ++ix)
+            expected += (b.arr[ix] = ix*ix);
+
+        qak::executor ex(2);
+        qak::atomic<std::uint64_t> sum;
+        {
+            qak::task_group tg(ex);
+            for (unsigned ix = 0; ix < 100; ++ix)
+                tg.run([b, &sum]() {
+                    std::uint64_t s = 0;
+                    for (std::uint64_t u : b.arr)
+                        s += u;
+                    sum += s;
+                });
+            tg.wait();
+        }
+        QAK_verify( sum.load() == 100*expected );
+    }
+
+    QAKtest(exception, "wait rethrows the first exception from a task in the group, once.")
+    {
+        qak::executor ex(2);
+        qak::task_group tg(ex);
+        qak::atomic<std::uint32_t> cnt_run;
+
+        for (unsigned ix = 0; ix < 100; ++ix)
+            tg.run([&, ix]() {
+                ++cnt_run;
+                if (ix % 10 == 3)
+                    throw std::runtime_error("from a task");
+            });
+
+        bool threw = false;
+        try
+        {
+            tg.wait();
+        }
+        catch (std::runtime_error const &)
+        {
+            threw = true;
+        }
+        QAK_verify( threw );
+        QAK_verify( cnt_run.load() == 100 );
+
+        //	The group is reusable.
+        tg.run([&]() { ++cnt_run; });
+        tg.wait();
+        QAK_verify( cnt_run.load() == 101 );
+    }
+
+    QAKtest(options_rejected, "Out of range thread_options make the constructor throw.")
+    {
+        qak::thread_options opts;
+        opts.opt_numa_node = qak::host_info::cnt_numa_nodes();
+
+        bool threw = false;
+        try
+        {
+            qak::executor ex(2, opts);
+        }
+        catch (std::runtime_error const &)
+        {
+            threw = true;
+        }
+        QAK_verify( threw );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    QAKtest(no_workers, "With the thread_group scaled to zero, the waiting thread runs the tasks itself.")
+    {
+        qak::executor ex(2);
+        ex.threads().set_target_cnt_threads(0);
+        ex.threads().join();
+        QAK_verify( ex.threads().get_current_cnt_threads() == 0 );
+
+        QAK_verify( fib(ex, 18) == 2584 );
+
+        qak::atomic<std::uint32_t> cnt_run;
+        ex.submit([&]() { ++cnt_run; });
+        QAK_verify( ex.run_one() );
+        QAK_refute( ex.run_one() );
+        QAK_verify( cnt_run.load() == 1 );
+    }
+
+    QAKtest(rescale, "Workers come and go while tasks are running.")
+    {
+        qak::executor ex(1);
+        for (std::size_t cnt_threads : { 4, 0, 2, 1, 3 })
+        {
+            qak::task_group tg(ex);
+            qak::atomic<std::uint64_t> sum;
+            for (unsigned ix = 0; ix < 200; ++ix)
+                tg.run([&]() { sum += fib(ex, 12); });
+
+            ex.threads().set_target_cnt_threads(cnt_threads);
+            tg.wait();
+            QAK_verify( sum.load() == 200*144 );
+        }
+    }
+
+    QAKtest(dtor, "Destroying the executor runs the tasks still queued.")
+    {
+        qak::atomic<std::uint32_t> cnt_run;
+        {
+            qak::executor ex(1);
+            ex.threads().set_target_cnt_threads(0);
+            ex.threads().join();
+            for (unsigned ix = 0; ix < 50; ++ix)
+                ex.submit([&]() { ++cnt_run; });
+        }
+        QAK_verify( cnt_run.load() == 50 );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
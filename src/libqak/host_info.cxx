@@ -21,12 +21,15 @@
 
 #include "qak/host_info.hxx"
 
-#include "qak/mutex.hxx"
 #include "qak/now.hxx"
 #include "qak/config.hxx"
 #include "qak/fail.hxx"
+#include "qak/seqlock.hxx"
+#include "qak/vector.hxx"
 
 #include <cassert> // assert
+#include <cstdio> // std::fopen, std::snprintf
+#include <cstdlib> // std::strtoul
 
 #if QAK_API_POSIX
 
@@ -42,42 +45,51 @@ namespace qak { namespace host_info { //========================================
 
 	static unsigned const fc_max_plausible_cpus = 1*1000*1000;
 
-	//	The sysconf calls can take a nontrivial amount of CPU, so cache their result for up to 500 ms.
+#if QAK_API_POSIX
+
+	//	The sysconf calls can take a nontrivial amount of CPU, so cache their result for up to 500 ms. Callers
+	//	on any thread read the cache without taking a lock.
 	static uint64_t const fc_max_sysconf_age_ns = uint64_t(500)*1000*1000;
 
-	mutex f_sysconf_mutex;
-	uint64_t f_most_recent_sysconf_cnt_cpus_configured_ns = uint64_t(0) - fc_max_sysconf_age_ns*2;
-	uint64_t f_most_recent_sysconf_cnt_cpus_available_ns  = uint64_t(0) - fc_max_sysconf_age_ns*2;
-	static unsigned f_cnt_cpus_configured = 0;
-	static unsigned f_cnt_cpus_available = 0;
+	struct sysconf_cache
+	{
+		uint64_t t_read_ns;
+		unsigned cnt; // 0 until first read
+	};
 
-	//-----------------------------------------------------------------------------------------------------------------|
+	static seqlock<sysconf_cache> f_cnt_cpus_configured_cache;
+	static seqlock<sysconf_cache> f_cnt_cpus_available_cache;
 
-	unsigned cnt_cpus_configured()
+	static unsigned cached_sysconf_cnt_cpus(seqlock<sysconf_cache> & cache, int name)
 	{
-#if QAK_API_POSIX
+		uint64_t now_ns = read_time_source(time_source::wallclock_ns);
 
-		unsigned u_cnt_cpus_configured = 0;
-		{
-			mutex_lock lock(f_sysconf_mutex);
+		sysconf_cache sc = cache.load();
+		if (sc.cnt && now_ns - sc.t_read_ns <= fc_max_sysconf_age_ns)
+			return sc.cnt;
 
-			uint64_t now_ns = read_time_source(time_source::wallclock_ns);
-			uint64_t age = now_ns - f_most_recent_sysconf_cnt_cpus_configured_ns;
-			if (fc_max_sysconf_age_ns < age)
-			{
-				long l = ::sysconf(
-					_SC_NPROCESSORS_CONF ); //? this macro may not be available everywhere.
+		//	Threads finding it stale at the same time may each refresh it. That's harmless.
+		long l = ::sysconf(name);
 
-				fail_unless(0 < l && l <= fc_max_plausible_cpus);
+		fail_unless(0 < l && l <= fc_max_plausible_cpus);
 
-				f_most_recent_sysconf_cnt_cpus_configured_ns = now_ns;
-				f_cnt_cpus_configured = static_cast<unsigned>(l);
-			}
+		sc.t_read_ns = now_ns;
+		sc.cnt = static_cast<unsigned>(l);
+		cache.store(sc);
 
-			u_cnt_cpus_configured = f_cnt_cpus_configured;
-		}
+		return sc.cnt;
+	}
+
+#endif // QAK_API_POSIX
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	unsigned cnt_cpus_configured()
+	{
+#if QAK_API_POSIX
 
-		return u_cnt_cpus_configured;
+		return cached_sysconf_cnt_cpus(f_cnt_cpus_configured_cache,
+			_SC_NPROCESSORS_CONF ); //? this macro may not be available everywhere.
 
 #elif QAK_API_WIN32
 
@@ -98,27 +110,8 @@ namespace qak { namespace host_info { //========================================
 	{
 #if QAK_API_POSIX
 
-		unsigned u_cnt_cpus_available = 0;
-		{
-			mutex_lock lock(f_sysconf_mutex);
-
-			uint64_t now_ns = read_time_source(time_source::wallclock_ns);
-			uint64_t age = now_ns - f_most_recent_sysconf_cnt_cpus_available_ns;
-			if (fc_max_sysconf_age_ns < age)
-			{
-				long l = ::sysconf(
-					_SC_NPROCESSORS_ONLN ); //? this macro may not be available everywhere.
-
-				fail_unless(0 < l && l <= fc_max_plausible_cpus);
-
-				f_most_recent_sysconf_cnt_cpus_available_ns = now_ns;
-				f_cnt_cpus_available = static_cast<unsigned>(l);
-			}
-
-			u_cnt_cpus_available = f_cnt_cpus_available;
-		}
-
-		return u_cnt_cpus_available;
+		return cached_sysconf_cnt_cpus(f_cnt_cpus_available_cache,
+			_SC_NPROCESSORS_ONLN ); //? this macro may not be available everywhere.
 
 #elif QAK_API_WIN32
 
@@ -152,6 +145,116 @@ namespace qak { namespace host_info { //========================================
 		return cnt_cpus_available();
 	}
 
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	CPU to NUMA node mapping, read once. The topology doesn't change while we're running.
+	struct numa_topology
+	{
+		unsigned cnt_nodes = 1;
+		vector<unsigned> node_of_cpu;
+		vector<unsigned> os_node_ids;
+	};
+
+#if QAK_LINUX
+
+	//	Calls fn(ix) for each index in a list like "0-3,8,10-11" as found in sysfs.
+	template <class Fn>
+	static void for_each_in_sysfs_list(char const * psz, Fn fn)
+	{
+		while (*psz)
+		{
+			char * p_end = 0;
+			unsigned long first = std::strtoul(psz, &p_end, 10);
+			if (p_end == psz)
+				break;
+			unsigned long last = first;
+			psz = p_end;
+			if (*psz == '-')
+			{
+				last = std::strtoul(psz + 1, &p_end, 10);
+				psz = p_end;
+			}
+
+			for (unsigned long ix = first; ix <= last && ix < fc_max_plausible_cpus; ++ix)
+				fn(static_cast<unsigned>(ix));
+
+			if (*psz != ',')
+				break;
+			++psz;
+		}
+	}
+
+	static bool read_sysfs_line(char const * psz_path, char (& buf)[4096])
+	{
+		std::FILE * fp = std::fopen(psz_path, "r");
+		if (!fp)
+			return false;
+		bool ok = !!std::fgets(buf, sizeof(buf), fp);
+		std::fclose(fp);
+		return ok;
+	}
+
+#endif // QAK_LINUX
+
+	static numa_topology read_numa_topology()
+	{
+		numa_topology topo;
+
+#if QAK_LINUX
+
+		char buf[4096];
+		if (!read_sysfs_line("/sys/devices/system/node/online", buf))
+			return topo;
+
+		//	Node IDs may have gaps, so we number them densely in the order listed.
+		unsigned cnt_nodes = 0;
+		for_each_in_sysfs_list(buf, [&](unsigned node_id) {
+			char sz_path[80];
+			std::snprintf(sz_path, sizeof(sz_path), "/sys/devices/system/node/node%u/cpulist", node_id);
+			char buf_cpus[4096];
+			if (!read_sysfs_line(sz_path, buf_cpus))
+				return;
+
+			for_each_in_sysfs_list(buf_cpus, [&](unsigned cpu_ix) {
+				if (topo.node_of_cpu.size() <= cpu_ix)
+					topo.node_of_cpu.resize(cpu_ix + 1);
+				topo.node_of_cpu[cpu_ix] = cnt_nodes;
+			});
+			topo.os_node_ids.push_back(node_id);
+			++cnt_nodes;
+		});
+
+		if (cnt_nodes)
+			topo.cnt_nodes = cnt_nodes;
+
+#endif // QAK_LINUX
+
+		return topo;
+	}
+
+	static numa_topology const & the_numa_topology()
+	{
+		static numa_topology const topo = read_numa_topology();
+		return topo;
+	}
+
+	unsigned cnt_numa_nodes()
+	{
+		return the_numa_topology().cnt_nodes;
+	}
+
+	unsigned numa_node_of_cpu(unsigned cpu_ix)
+	{
+		numa_topology const & topo = the_numa_topology();
+		return cpu_ix < topo.node_of_cpu.size() ? topo.node_of_cpu[cpu_ix] : 0;
+	}
+
+	unsigned numa_node_os_id(unsigned node_ix)
+	{
+		numa_topology const & topo = the_numa_topology();
+		return node_ix < topo.os_node_ids.size() ? topo.os_node_ids[node_ix] : node_ix;
+	}
+
 	//=================================================================================================================|
 
 	//-----------------------------------------------------------------------------------------------------------------|
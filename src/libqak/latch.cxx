@@ -0,0 +1,50 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//
+//	latch.cxx
+
+#include "qak/latch.hxx"
+
+#include "qak/imp/spin_wait.hxx"
+
+namespace qak { //=====================================================================================================|
+
+	void latch::wait() const QAK_noexcept
+	{
+		if (spin_until(100, [this]() { return try_wait(); }))
+			return;
+
+		for (std::uint32_t cnt; (cnt = cnt_.load(memory_order::acquire)); )
+			cnt_.wait(cnt, memory_order::relaxed);
+	}
+
+	bool latch::wait_until_ns(std::uint64_t deadline_ns) const QAK_noexcept
+	{
+		if (spin_until(100, [this]() { return try_wait(); }))
+			return true;
+
+		for (std::uint32_t cnt; (cnt = cnt_.load(memory_order::acquire)); )
+			if (!cnt_.wait_until(cnt, deadline_ns, memory_order::relaxed))
+				return try_wait();
+
+		return true;
+	}
+
+} // namespace qak ====================================================================================================|
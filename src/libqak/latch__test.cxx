@@ -0,0 +1,89 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	latch__test.cxx
+
+#include "qak/latch.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/now.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+using qak::latch;
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(basic, "Counting down from one thread.")
+    {
+        latch l(3);
+        QAK_refute( l.try_wait() );
+        l.count_down(2);
+        QAK_refute( l.try_wait() );
+        l.arrive_and_wait();
+        QAK_verify( l.try_wait() );
+        l.wait();
+
+        latch l0(0);
+        QAK_verify( l0.try_wait() );
+        l0.wait();
+    }
+
+    QAKtest(timeout, "A timed wait gives up if it doesn't reach zero.")
+    {
+        latch l(1);
+        std::uint64_t deadline_ns = qak::read_time_source(qak::time_source::wallclock_ns) + 20*1000*1000;
+        QAK_refute( l.wait_until_ns(deadline_ns) );
+        QAK_verify( deadline_ns <= qak::read_time_source(qak::time_source::wallclock_ns) );
+    }
+
+    QAKtest(workers, "Waiters see everything done by the threads that counted it down.")
+    {
+        unsigned const cnt_threads = 6;
+
+        latch ready(cnt_threads);
+        latch go(1);
+        qak::vector<unsigned> setup(cnt_threads, 0);
+        qak::atomic<unsigned> cnt_went;
+
+        qak::vector<qak::thread::RP> threads;
+        for (unsigned th_ix = 0; th_ix < cnt_threads; ++th_ix)
+            threads.push_back(qak::start_thread([&, th_ix]() {
+                setup[th_ix] = th_ix + 1;
+                ready.count_down();
+                go.wait();
+                ++cnt_went;
+            }));
+
+        ready.wait();
+        for (unsigned ix = 0; ix < cnt_threads; ++ix)
+            QAK_verify( setup[ix] == ix + 1 );
+        QAK_verify( cnt_went == 0 );
+
+        go.count_down();
+        for (auto & th : threads)
+            th->join();
+        QAK_verify( cnt_went == cnt_threads );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -25,38 +25,72 @@
 #include "qak/atomic.hxx"
 #include "qak/config.hxx"
 #include "qak/fail.hxx"
+#include "qak/imp/spin_wait.hxx"
 #include "qak/thread.hxx" // thread_id_t
 
 #include <cstdint>
 #include <cassert>
 
-#include <iostream>//?
-#include <iomanip>//?
-
-#if QAK_THREAD_PTHREAD
-	// Error code definitions from The Open Group - Single UNIX Specification, Version 2
-#	include <errno.h> // pthread error codes
-#	include <pthread.h>
-#elif QAK_THREAD_WIN32
+#if QAK_THREAD_WIN32
+#	include <utility> // std::swap
 #	include "../platforms/win32/win32_lite.hxx"
 #endif
 
 namespace qak { //=====================================================================================================|
 
-	typedef qak::atomic<thread_id_t> atomic_thread_id_t;
+#if QAK_THREAD_PTHREAD
 
-#	define OWNING_THREAD_ID(p)       (*reinterpret_cast<atomic_thread_id_t *      >(&p->imp_[0]))
-#	define OWNING_THREAD_ID_const(p) (*reinterpret_cast<atomic_thread_id_t const *>(&p->imp_[0]))
+	//	Most critical sections are short, so a thread finding the mutex locked spins a while before parking, in hope
+	//	the holder releases it soon. Parking and waking cost a pair of system calls and a context switch. On a single
+	//	CPU the holder can't run while we spin, so there we park right away.
+	static unsigned cnt_spins_before_parking()
+	{
+		static unsigned const cnt = spinning_can_help() ? 100 : 0;
+		return cnt;
+	}
 
-#if QAK_THREAD_PTHREAD
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	void mutex::acquire_contended_()
+	{
+		if (is_locked_by_this_thread())
+			fail(); //	Already owns the mutex.
+
+		std::uint64_t t_wait_begin_ns = prof_now_ns_();
+
+		for (unsigned n = cnt_spins_before_parking(); n; --n)
+		{
+			spin_pause();
 
-#	define MUTEX(p) (*reinterpret_cast<pthread_mutex_t *>(&p->imp_[1]))
+			std::uint32_t st = state_.load(memory_order::relaxed);
+			if (st == state_locked_waiters)
+				break; // others are parked already, get in line
+
+			if (st == state_unlocked && try_acquire_())
+			{
+				prof_acquired_(true, t_wait_begin_ns);
+				return;
+			}
+		}
+
+		//	Marking the state as having waiters obliges the next thread to release it to wake one of us. If the
+		//	exchange finds it unlocked we've acquired it, and leave the mark since there may be others still parked.
+		while (state_.exchange(state_locked_waiters, memory_order::acquire) != state_unlocked)
+			state_.wait(state_locked_waiters, memory_order::relaxed);
+
+		assert(owner_.load(memory_order::relaxed) == invalid_thread_id_value);
+		owner_.store(::pthread_self(), memory_order::relaxed);
+
+		prof_acquired_(true, t_wait_begin_ns);
+	}
 
 #elif QAK_THREAD_WIN32
 
-#	define CRITSEC(p) (*reinterpret_cast<win32::CRITICAL_SECTION *>(&p->imp_[1]))
+	typedef qak::atomic<thread_id_t> atomic_thread_id_t;
 
-#endif // of elif QAK_THREAD_WIN32
+#	define OWNING_THREAD_ID(p)       (*reinterpret_cast<atomic_thread_id_t *      >(&p->imp_[0]))
+#	define OWNING_THREAD_ID_const(p) (*reinterpret_cast<atomic_thread_id_t const *>(&p->imp_[0]))
+#	define CRITSEC(p) (*reinterpret_cast<win32::CRITICAL_SECTION *>(&p->imp_[1]))
 
 	//-----------------------------------------------------------------------------------------------------------------|
 
@@ -65,148 +99,32 @@ namespace qak { //==============================================================
 		static_assert(sizeof(atomic_thread_id_t) <= sizeof(imp_elem_t), "increase size of imp_t");
 		static_assert(QAK_alignof_t(atomic_thread_id_t) <= QAK_alignof_x(imp_elem_t), "increase align of imp_");
 
-#if QAK_THREAD_PTHREAD
-
-		new (&OWNING_THREAD_ID(this)) atomic_thread_id_t(invalid_thread_id_value);
-
-		static_assert(sizeof(pthread_mutex_t) <= sizeof(imp_t) - sizeof(imp_elem_t), "increase size of imp_t");
-		static_assert(QAK_alignof_t(pthread_mutex_t) <= QAK_alignof_t(imp_elem_t), "increase align of imp_elem_t");
-
-		//	http://pubs.opengroup.org/onlinepubs/007908799/xsh/pthread_mutex_init.html
-		int err = ::pthread_mutex_init(
-			& MUTEX(this), // pthread_mutex_t *mutex
-			0 );           // const pthread_mutexattr_t *attr
-		if (err)
-		{
-			//char const * psz = 0;
-			//switch (err)
-			//{				Error code definitions from The Open Group - Single UNIX Specification, Version 2
-			//case EAGAIN:
-			//	psz = "The system lacked the necessary resources (other than memory) to initialise another mutex.";
-			//	break;
-			//case ENOMEM:
-			//	psz = "Insufficient memory exists to initialise the mutex.";
-			//	break;
-			//case EPERM:
-			//	psz = "The caller does not have the privilege to perform the operation.";
-			//	break;
-			//case EBUSY:
-			//	psz = "The implementation has detected an attempt to re-initialise the object referenced by mutex, "
-			//		"a previously initialised, but not yet destroyed, mutex.";
-			//	break;
-			//case EINVAL:
-			//	psz = "The value specified by attr is invalid.";
-			//	break;
-			//}
-			fail(); // internal error
-		}
-
-#elif QAK_THREAD_WIN32
-
 		new (&OWNING_THREAD_ID(this)) atomic_thread_id_t(win32::INVALID_THREAD_ID);
 
 		static_assert(sizeof(win32::CRITICAL_SECTION) <= sizeof(imp_t) - sizeof(imp_elem_t), "increase size of imp_t");
 		static_assert(QAK_alignof_t(win32::CRITICAL_SECTION) <= QAK_alignof_t(imp_elem_t), "increase align of imp_elem_t");
 
 		win32::InitializeCriticalSection(&CRITSEC(this));
-
-#else
-#	pragma message "error: port me"
-#endif
 	}
 
+	mutex::mutex(char const *) : mutex() { } // no profiling on Win32
+
 	//-----------------------------------------------------------------------------------------------------------------|
 
 	mutex::~mutex()
 	{
-#if QAK_THREAD_PTHREAD
-//std::cerr << "pthread_mutex_destroy\n";//?
-
-		//	http://pubs.opengroup.org/onlinepubs/007908799/xsh/pthread_mutex_destroy.html
-		int err = ::pthread_mutex_destroy(
-			&MUTEX(this) ); // pthread_mutex_t *mutex
-		if (err)
-		{
-			char const * psz = "Unknown mutex_destroy error.";
-			switch (err)
-			{				// Error code definitions from The Open Group - Single UNIX Specification, Version 2
-			case EAGAIN:
-				psz = "The system lacked the necessary resources (other than memory) to initialise another mutex.";
-				break;
-			case ENOMEM:
-				psz = "Insufficient memory exists to initialise the mutex.";
-				break;
-			case EPERM:
-				psz = "The caller does not have the privilege to perform the operation.";
-				break;
-			case EBUSY:
-				psz = "The implementation has detected an attempt to destroy the object referenced by mutex while it "
-					"is locked or referenced (for example, while being used in a pthread_cond_wait() or "
-					"pthread_cond_timedwait()) by another thread.";
-				break;
-			case EINVAL:
-				psz = "The value specified by mutex is invalid.";
-				break;
-			}
-std::cerr << psz << "\n";//?
-			assert(!psz);
-			//? log this message?
-		}
-
-#elif QAK_THREAD_WIN32
-
 		//	There is no conceivable circumstance in which it's valid to delete the critsec while any mutex_lock owns it.
 		assert(OWNING_THREAD_ID_const(this) == win32::INVALID_THREAD_ID);
 
 		OWNING_THREAD_ID(this).~atomic_thread_id_t();
 
 		win32::DeleteCriticalSection(&CRITSEC(this));
-
-#else
-#	pragma message "error: port me"
-#endif
 	}
 
 	//-----------------------------------------------------------------------------------------------------------------|
 
 	mutex::lock_type mutex::lock()
 	{
-#if QAK_THREAD_PTHREAD
-
-		//	http://pubs.opengroup.org/onlinepubs/007908799/xsh/pthread_mutex_lock.html
-		int err = ::pthread_mutex_lock(
-			&MUTEX(this) ); // pthread_mutex_t *mutex
-		if (err)
-		{
-			char const * psz = "Unknown mutex_lock error.";
-			switch (err)
-			{				// Error code definitions from The Open Group - Single UNIX® Specification, Version 2
-			case EINVAL:
-				psz = "The mutex was created with the protocol attribute having the value PTHREAD_PRIO_PROTECT "
-					"and the calling thread's priority is higher than the mutex's current priority ceiling "
-					"or the value specified by mutex does not refer to an initialised mutex object.";
-				break;
-			case EAGAIN:
-				psz = "The mutex could not be acquired because the maximum number of recursive locks for mutex "
-					"has been exceeded.";
-				break;
-			case EDEADLK:
-				psz = "The current thread already owns the mutex.";
-				break;
-			}
-std::cerr << psz << "\n";//?
-			assert(!psz);
-			fail(); // internal error
-		}
-
-		assert(::pthread_equal(OWNING_THREAD_ID_const(this), invalid_thread_id_value));
-
-		OWNING_THREAD_ID(this) = ::pthread_self();
-
-		assert(!::pthread_equal(OWNING_THREAD_ID_const(this), invalid_thread_id_value));
-
-#elif QAK_THREAD_WIN32
-
 		win32::EnterCriticalSection(&CRITSEC(this));
 
 		if (OWNING_THREAD_ID_const(this) == win32::GetCurrentThreadId())
@@ -219,10 +137,6 @@ std::cerr << psz << "\n";//?
 
 		OWNING_THREAD_ID(this) = win32::GetCurrentThreadId();
 
-#else
-#	pragma message "error: port me"
-#endif
-
 		return mutex_lock(mutex_lock::private_construct_tag(), this);
 	}
 
@@ -230,62 +144,35 @@ std::cerr << psz << "\n";//?
 
 	bool mutex::is_locked_by_this_thread() const
 	{
-#if QAK_THREAD_PTHREAD
-
-		return !! ::pthread_equal(OWNING_THREAD_ID_const(this), ::pthread_self());
-
-#elif QAK_THREAD_WIN32
-
 		return OWNING_THREAD_ID_const(this) == win32::GetCurrentThreadId();
-
-#else
-#	error "port me"
-#endif
 	}
 
 	//-----------------------------------------------------------------------------------------------------------------|
 
-	optional<mutex::lock_type> mutex::try_lock()
+	void mutex::acquire_()
 	{
-		if (this->is_locked_by_this_thread())
-			fail(); //	Already owns the mutex.
-
-#if QAK_THREAD_PTHREAD
-
-		//	http://pubs.opengroup.org/onlinepubs/007908799/xsh/pthread_mutex_lock.html
-		int err = ::pthread_mutex_trylock(
-			&MUTEX(this) ); // pthread_mutex_t *mutex
-
-		//char const * psz = 0;
-		switch (err)
-		{
-		case 0:
-			break; // returns
+		win32::EnterCriticalSection(&CRITSEC(this));
 
-		case EBUSY:
-			//	psz = "The mutex could not be acquired because it was already locked.";
-			return optional<mutex_lock>();
+		assert(OWNING_THREAD_ID_const(this) == win32::INVALID_THREAD_ID);
 
-		//case EINVAL:
-		//	psz = "The mutex was created with the protocol attribute having the value PTHREAD_PRIO_PROTECT "
-		//		"and the calling thread's priority is higher than the mutex's current priority ceiling ";
-		//		"or the value specified by mutex does not refer to an initialised mutex object.";
-		//	break;
+		OWNING_THREAD_ID(this) = win32::GetCurrentThreadId();
+	}
 
-		//case EAGAIN:
-		//	psz = "The mutex could not be acquired because the maximum number of recursive locks for mutex "
-		//		"has been exceeded.";
-		//	break;
+	void mutex::release_() QAK_noexcept
+	{
+		assert(OWNING_THREAD_ID_const(this) == win32::GetCurrentThreadId());
 
-		default:
-			throw 0;
-		}
+		OWNING_THREAD_ID(this) = win32::INVALID_THREAD_ID;
 
-		assert(OWNING_THREAD_ID_const(this) == invalid_thread_id_value);
+		win32::LeaveCriticalSection(&CRITSEC(this));
+	}
 
-		OWNING_THREAD_ID(this) = ::pthread_self();
+	//-----------------------------------------------------------------------------------------------------------------|
 
-#elif QAK_THREAD_WIN32
+	optional<mutex::lock_type> mutex::try_lock()
+	{
+		if (this->is_locked_by_this_thread())
+			fail(); //	Already owns the mutex.
 
 		win32::BOOL entered = win32::TryEnterCriticalSection(&CRITSEC(this));
 
@@ -296,10 +183,6 @@ std::cerr << psz << "\n";//?
 
 		OWNING_THREAD_ID(this) = win32::GetCurrentThreadId();
 
-#else
-#	error "port me"
-#endif
-
 		return mutex_lock(mutex_lock::private_construct_tag(), this);
 	}
 
@@ -314,15 +197,8 @@ std::cerr << psz << "\n";//?
 		std::swap(ml.p_m_, p_m_);
 
 		//	Verify we have a lock on mutex *p_m_.
-#if QAK_THREAD_PTHREAD
-
-		assert(::pthread_equal(OWNING_THREAD_ID_const(p_m_), ::pthread_self()));
-
-#elif QAK_THREAD_WIN32
 
 		assert(p_m_->is_locked_by_this_thread());
-
-#endif // of elif QAK_THREAD_WIN32
 	}
 
 	//-----------------------------------------------------------------------------------------------------------------|
@@ -340,46 +216,11 @@ std::cerr << psz << "\n";//?
 	{
 		if (p_m_)
 		{
-#if QAK_THREAD_PTHREAD
-
-			//	Verify we have a lock on mutex *p_m_.
-			assert(::pthread_equal(OWNING_THREAD_ID_const(p_m_), ::pthread_self()));
-
-			OWNING_THREAD_ID(p_m_) = invalid_thread_id_value;
-
-			int err = ::pthread_mutex_unlock(
-				&MUTEX(p_m_) ); // pthread_mutex_t *mutex
-			assert(!err);
-			if (err)
-			{
-				//char const * psz = 0;
-				//switch (err)
-				//{				Error code definitions from The Open Group - Single UNIX® Specification, Version 2
-				//case EINVAL:
-				//	psz = "The value specified by mutex does not refer to an initialised mutex object.";
-				//	break;
-				//case EAGAIN:
-				//	psz = "The mutex could not be acquired because the maximum number of recursive locks for mutex "
-				//		"has been exceeded.";
-				//	break;
-				//case EPERM:
-				//	psz = "The current thread does not own the mutex.";
-				//	break;
-				//}
-				fail(); // internal error
-			}
-
-#elif QAK_THREAD_WIN32
-
-		assert(OWNING_THREAD_ID_const(p_m_) == win32::GetCurrentThreadId());
-
-		OWNING_THREAD_ID(p_m_) = win32::INVALID_THREAD_ID;
+			assert(OWNING_THREAD_ID_const(p_m_) == win32::GetCurrentThreadId());
 
-		win32::LeaveCriticalSection(&CRITSEC(p_m_));
+			OWNING_THREAD_ID(p_m_) = win32::INVALID_THREAD_ID;
 
-#else
-#	error "port me"
-#endif
+			win32::LeaveCriticalSection(&CRITSEC(p_m_));
 		}
 	}
 
@@ -391,18 +232,7 @@ std::cerr << psz << "\n";//?
 
 		//	Verify we have a lock on mutex *p_m_.
 		assert(p_m_);
-
-#if QAK_THREAD_PTHREAD
-
-		assert(::pthread_equal(OWNING_THREAD_ID_const(p_m_), ::pthread_self()));
-
-#elif QAK_THREAD_WIN32
-
 		assert(OWNING_THREAD_ID_const(p_m_) == win32::GetCurrentThreadId());
-
-#else
-#	error "port me"
-#endif
 	}
 
 	//-----------------------------------------------------------------------------------------------------------------|
@@ -412,4 +242,8 @@ std::cerr << psz << "\n";//?
 		return &m == p_m_;
 	}
 
+#else
+#	error "port me"
+#endif
+
 } // qak ==============================================================================================================|
@@ -0,0 +1,165 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	mutex__bench.cxx
+
+#include "qak/mutex.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/host_info.hxx"
+#include "qak/stopwatch.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdio> // std::snprintf
+
+#include <pthread.h>
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    //	What qak::mutex used to be: a pthread mutex, plus a seq_cst store of the owning thread ID on every lock and
+    //	unlock.
+    struct pthread_owner_mutex
+    {
+        pthread_mutex_t mut;
+        qak::atomic<pthread_t> owner;
+
+        pthread_owner_mutex() : owner(qak::invalid_thread_id_value) { ::pthread_mutex_init(&mut, 0); }
+        ~pthread_owner_mutex() { ::pthread_mutex_destroy(&mut); }
+
+        void lock()
+        {
+            ::pthread_mutex_lock(&mut);
+            owner = ::pthread_self();
+        }
+
+        void unlock()
+        {
+            owner = qak::invalid_thread_id_value;
+            ::pthread_mutex_unlock(&mut);
+        }
+    };
+
+    struct pthread_owner_mutex_lock
+    {
+        pthread_owner_mutex & m;
+        explicit pthread_owner_mutex_lock(pthread_owner_mutex & m_in) : m(m_in) { m.lock(); }
+        ~pthread_owner_mutex_lock() { m.unlock(); }
+    };
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    QAKtest(uncontended, "Lock and unlock by a single thread.")
+    {
+        std::uint64_t const cnt_iters = 50*1000*1000;
+        std::uint64_t cnt = 0;
+
+        {
+            pthread_owner_mutex mut;
+            QAK_bench_loop("pthread mutex with owner (before)", cnt_iters,
+                pthread_owner_mutex_lock lock(mut);
+                ++cnt
+            );
+        }
+
+        {
+            qak::mutex mut;
+            QAK_bench_loop("qak::mutex_lock", cnt_iters,
+                qak::mutex_lock lock(mut);
+                ++cnt
+            );
+            QAK_bench_loop("qak::mutex::lock()", cnt_iters,
+                qak::mutex_lock lock = mut.lock();
+                ++cnt
+            );
+            QAK_bench_loop("qak::mutex::try_lock()", cnt_iters,
+                if (qak::optional<qak::mutex_lock> opt_lock = mut.try_lock())
+                    ++cnt
+            );
+        }
+
+        QAK_verify( cnt == 4*cnt_iters );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    std::uint64_t const cnt_per_thread = 2*1000*1000;
+
+    //	Runs cnt_per_thread short critical sections on each of 1, 2, 4, ... cnt_cpus_available() threads.
+    //	Returns the total number run.
+    template <class Fn>
+    std::uint64_t bench_scaling(char const * psz_what, Fn cs_fn)
+    {
+        unsigned const cnt_cpus = qak::host_info::cnt_cpus_available();
+        std::uint64_t cnt_total = 0;
+
+        for (unsigned n = 1; ; n = (n*2 < cnt_cpus) ? n*2 : cnt_cpus)
+        {
+            qak::stopwatch sw;
+            qak::vector<qak::thread::RP> threads;
+            for (unsigned th_ix = 0; th_ix < n; ++th_ix)
+                threads.push_back(qak::start_thread([&cs_fn]() {
+                    for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                        cs_fn();
+                }));
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads[ix]->join();
+            std::int64_t elapsed_ns = sw.elapsed_ns();
+            cnt_total += n*cnt_per_thread;
+
+            char sz[80];
+            std::snprintf(sz, sizeof(sz), "%s, %u threads (per-thread time)", psz_what, n);
+            QAK_bench_report(sz, cnt_per_thread, elapsed_ns);
+
+            if (n == cnt_cpus)
+                break;
+        }
+
+        return cnt_total;
+    }
+
+    QAKtest(contended, "Threads incrementing a shared counter under the lock.")
+    {
+        {
+            pthread_owner_mutex mut;
+            std::uint64_t cnt = 0;
+            std::uint64_t cnt_expected = bench_scaling("pthread mutex with owner (before)", [&]() {
+                pthread_owner_mutex_lock lock(mut);
+                ++cnt;
+            });
+            QAK_verify( cnt == cnt_expected );
+        }
+
+        {
+            qak::mutex mut;
+            std::uint64_t cnt = 0;
+            std::uint64_t cnt_expected = bench_scaling("qak::mutex", [&]() {
+                qak::mutex_lock lock(mut);
+                ++cnt;
+            });
+            QAK_verify( cnt == cnt_expected );
+        }
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -21,6 +21,9 @@
 
 #include "qak/mutex.hxx"
 
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
 #include "qak/test_app_pre.hxx"
 #include "qak/test_macros.hxx"
 
@@ -54,10 +57,17 @@ namespace zzz { //==============================================================
 		opt_lock1.reset();
 
 		QAK_verify( !mut.is_locked_by_this_thread() );
+	}
 
-		//	Really we need another thread to test this.
-		//qak::optional<mutex_lock> opt_lock2 = mut.try_lock();
-		//QAK_verify( !opt_lock2 );
+	QAKtest(mutex_try_lock_other_thread)
+	{
+		mutex mut;
+		mutex_lock lock = mut.lock();
+
+		qak::thread::RP th = qak::start_thread_uintptr([&mut]() -> std::uintptr_t {
+			return !mut.is_locked_by_this_thread() && !mut.try_lock();
+		});
+		QAK_verify( *th->join() == 1 );
 	}
 
 	QAKtest(mutex_try_lock_2)
@@ -84,6 +94,39 @@ namespace zzz { //==============================================================
 		catch (...) { throwed = true; }
 
 		QAK_verify(throwed);
+
+		throwed = false;
+		try
+		{
+			mut.lock();
+		}
+		catch (...) { throwed = true; }
+
+		QAK_verify(throwed);
+		QAK_verify( mut.is_locked_by_this_thread() );
+	}
+
+	QAKtest(mutex_contended)
+	{
+		mutex mut;
+		std::uint64_t cnt = 0;
+		unsigned const cnt_threads = 4;
+		unsigned const cnt_per_thread = 100*1000;
+
+		qak::vector<qak::thread::RP> threads;
+		for (unsigned n = 0; n < cnt_threads; ++n)
+			threads.push_back(qak::start_thread([&]() {
+				for (unsigned ix = 0; ix < cnt_per_thread; ++ix)
+				{
+					mutex_lock lock(mut);
+					++cnt;
+				}
+			}));
+		for (auto & th : threads)
+			th->join();
+
+		QAK_verify( cnt == std::uint64_t(cnt_threads)*cnt_per_thread );
+		QAK_verify( mut.try_lock() );
 	}
 
 } // namespace zzz ====================================================================================================|
@@ -0,0 +1,215 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	mutex_profiling.cxx
+
+#include "qak/mutex_profiling.hxx"
+
+#include "qak/atomic.hxx"
+
+#include <algorithm> // std::sort
+#include <cstring> // std::strcmp
+#include <new> // std::nothrow
+
+#if QAK_MUTEX_PROFILING
+
+namespace qak_mutex_imp_ { //==========================================================================================|
+
+	using qak::atomic;
+	using qak::memory_order;
+
+	//	One per name, never freed. They form a list which is only pushed onto.
+	struct prof_record
+	{
+		char const * psz_name;
+		prof_record * p_next;
+
+		atomic<std::uint64_t> cnt_acquisitions;
+		atomic<std::uint64_t> cnt_contended;
+		atomic<std::uint64_t> wait_ns_total;
+		atomic<std::uint64_t> wait_ns_max;
+		atomic<std::uint64_t> hold_ns_total;
+		atomic<std::uint64_t> hold_ns_max;
+
+		explicit prof_record(char const * psz_name_in) : psz_name(psz_name_in), p_next(0) { }
+	};
+
+	atomic<prof_record *> prof_records_head;
+
+	//	Returns null if there's no record yet and no memory for one.
+	prof_record * find_or_add_prof_record(char const * psz_name) QAK_noexcept
+	{
+		if (!psz_name)
+			psz_name = "(unnamed)";
+
+		prof_record * p_new = 0;
+		prof_record * p_scanned_to = 0;
+		prof_record * p_head = prof_records_head.load(memory_order::acquire);
+		for (;;)
+		{
+			//	Look through the records we haven't looked at yet.
+			for (prof_record * p = p_head; p != p_scanned_to; p = p->p_next)
+				if (p->psz_name == psz_name || !std::strcmp(p->psz_name, psz_name))
+				{
+					delete p_new;
+					return p;
+				}
+			p_scanned_to = p_head;
+
+			if (!p_new)
+				if (!(p_new = new (std::nothrow) prof_record(psz_name)))
+					return 0;
+			p_new->p_next = p_head;
+
+			if (prof_records_head.compare_exchange_weak(p_head, p_new, memory_order::release, memory_order::acquire))
+				return p_new;
+		}
+	}
+
+	//	Elapsed time from t0 to t1, or 0 if the clock seems to have gone backward, as it may for times read before
+	//	main() began.
+	inline std::uint64_t elapsed_ns(std::uint64_t t0, std::uint64_t t1) QAK_noexcept
+	{
+		return t0 < t1 ? t1 - t0 : 0;
+	}
+
+	void update_max(atomic<std::uint64_t> & a, std::uint64_t val) QAK_noexcept
+	{
+		std::uint64_t cur = a.load(memory_order::relaxed);
+		while (cur < val && !a.compare_exchange_weak(cur, val, memory_order::relaxed, memory_order::relaxed))
+			;
+	}
+
+} // namespace qak_mutex_imp_
+namespace qak { //=====================================================================================================|
+
+	using qak_mutex_imp_::prof_record;
+
+	void mutex::prof_acquired_(bool contended, std::uint64_t t_wait_begin_ns) QAK_noexcept
+	{
+		//	We hold the mutex, so p_prof_rec_ and prof_t_acquired_ns_ are ours. Throwing now would leave it locked,
+		//	so if there's no memory for the record, this acquisition just goes unrecorded.
+		if (!p_prof_rec_)
+			if (!(p_prof_rec_ = qak_mutex_imp_::find_or_add_prof_record(prof_psz_name_)))
+				return;
+
+		prof_t_acquired_ns_ = prof_now_ns_();
+
+		p_prof_rec_->cnt_acquisitions.fetch_add(1, memory_order::relaxed);
+		if (contended)
+		{
+			std::uint64_t wait_ns = qak_mutex_imp_::elapsed_ns(t_wait_begin_ns, prof_t_acquired_ns_);
+			p_prof_rec_->cnt_contended.fetch_add(1, memory_order::relaxed);
+			p_prof_rec_->wait_ns_total.fetch_add(wait_ns, memory_order::relaxed);
+			qak_mutex_imp_::update_max(p_prof_rec_->wait_ns_max, wait_ns);
+		}
+	}
+
+	void mutex::prof_releasing_() QAK_noexcept
+	{
+		if (!p_prof_rec_)
+			return;
+
+		std::uint64_t hold_ns = qak_mutex_imp_::elapsed_ns(prof_t_acquired_ns_, prof_now_ns_());
+		p_prof_rec_->hold_ns_total.fetch_add(hold_ns, memory_order::relaxed);
+		qak_mutex_imp_::update_max(p_prof_rec_->hold_ns_max, hold_ns);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	vector<mutex_stats> mutex_stats_snapshot()
+	{
+		vector<mutex_stats> v;
+		for (prof_record * p = qak_mutex_imp_::prof_records_head.load(memory_order::acquire); p; p = p->p_next)
+		{
+			mutex_stats ms;
+			ms.psz_name = p->psz_name;
+			ms.cnt_acquisitions = p->cnt_acquisitions.load(memory_order::relaxed);
+			ms.cnt_contended = p->cnt_contended.load(memory_order::relaxed);
+			ms.wait_ns_total = p->wait_ns_total.load(memory_order::relaxed);
+			ms.wait_ns_max = p->wait_ns_max.load(memory_order::relaxed);
+			ms.hold_ns_total = p->hold_ns_total.load(memory_order::relaxed);
+			ms.hold_ns_max = p->hold_ns_max.load(memory_order::relaxed);
+			v.push_back(ms);
+		}
+
+		std::sort(v.begin(), v.end(), [](mutex_stats const & a, mutex_stats const & b) {
+			return    a.wait_ns_total != b.wait_ns_total ? a.wait_ns_total > b.wait_ns_total
+			        : a.cnt_acquisitions > b.cnt_acquisitions;
+		});
+
+		return v;
+	}
+
+	void reset_mutex_stats()
+	{
+		for (prof_record * p = qak_mutex_imp_::prof_records_head.load(memory_order::acquire); p; p = p->p_next)
+		{
+			p->cnt_acquisitions.store(0, memory_order::relaxed);
+			p->cnt_contended.store(0, memory_order::relaxed);
+			p->wait_ns_total.store(0, memory_order::relaxed);
+			p->wait_ns_max.store(0, memory_order::relaxed);
+			p->hold_ns_total.store(0, memory_order::relaxed);
+			p->hold_ns_max.store(0, memory_order::relaxed);
+		}
+	}
+
+} // namespace qak ====================================================================================================|
+
+#else // of if QAK_MUTEX_PROFILING
+
+namespace qak { //=====================================================================================================|
+
+	vector<mutex_stats> mutex_stats_snapshot()
+	{
+		return vector<mutex_stats>();
+	}
+
+	void reset_mutex_stats() { }
+
+} // namespace qak ====================================================================================================|
+
+#endif // of else QAK_MUTEX_PROFILING
+
+namespace qak { //=====================================================================================================|
+
+	void write_mutex_stats_report(std::FILE * fp)
+	{
+		if (!mutex_profiling_enabled())
+		{
+			std::fprintf(fp, "Mutex profiling is not enabled in this build (QAK_MUTEX_PROFILING).\n");
+			return;
+		}
+
+		std::fprintf(fp, "%-32s %12s %12s %7s %12s %12s %12s %12s\n",
+			"mutex", "acquired", "contended", "cont %", "wait ms", "wait max us", "hold ms", "hold max us");
+
+		for (mutex_stats const & ms : mutex_stats_snapshot())
+			std::fprintf(fp, "%-32s %12llu %12llu %6.2f%% %12.3f %12.3f %12.3f %12.3f\n",
+				ms.psz_name,
+				static_cast<unsigned long long>(ms.cnt_acquisitions),
+				static_cast<unsigned long long>(ms.cnt_contended),
+				ms.cnt_acquisitions ? 100.0*double(ms.cnt_contended)/double(ms.cnt_acquisitions) : 0.0,
+				double(ms.wait_ns_total)/1.0e6,
+				double(ms.wait_ns_max)/1.0e3,
+				double(ms.hold_ns_total)/1.0e6,
+				double(ms.hold_ns_max)/1.0e3 );
+	}
+
+} // namespace qak ====================================================================================================|
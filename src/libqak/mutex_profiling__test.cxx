@@ -0,0 +1,123 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	mutex_profiling__test.cxx
+
+#include "qak/mutex_profiling.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/mutex.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdio> // stderr
+#include <cstring> // std::strcmp
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    qak::mutex_stats stats_for(char const * psz_name)
+    {
+        for (qak::mutex_stats const & ms : qak::mutex_stats_snapshot())
+            if (!std::strcmp(ms.psz_name, psz_name))
+                return ms;
+
+        qak::mutex_stats ms = { psz_name, 0, 0, 0, 0, 0, 0 };
+        return ms;
+    }
+
+    QAKtest(uncontended, "Acquisitions by name.")
+    {
+        {
+            qak::mutex mut1("zzz uncontended");
+            qak::mutex mut2("zzz uncontended");
+            for (int n = 0; n < 10; ++n)
+            {
+                qak::mutex_lock lock1(mut1);
+                qak::mutex_lock lock2 = mut2.lock();
+            }
+            QAK_verify( mut1.try_lock() );
+        }
+
+        qak::mutex_stats ms = stats_for("zzz uncontended");
+        if (qak::mutex_profiling_enabled())
+        {
+            QAK_verify( ms.cnt_acquisitions == 21 );
+            QAK_verify( ms.cnt_contended == 0 );
+            QAK_verify( ms.wait_ns_total == 0 );
+            QAK_verify( ms.hold_ns_max <= ms.hold_ns_total );
+        }
+        else
+        {
+            QAK_verify( ms.cnt_acquisitions == 0 );
+            QAK_verify( qak::mutex_stats_snapshot().empty() );
+        }
+    }
+
+    QAKtest(contended, "A thread waiting for a held mutex.")
+    {
+        qak::mutex mut("zzz contended");
+
+        //	On a loaded machine the other thread may not reach the mutex before we let go of it, so try a few times.
+        qak::mutex_stats ms;
+        for (int cnt_tries = 0; cnt_tries < 20; ++cnt_tries)
+        {
+            qak::reset_mutex_stats();
+
+            qak::atomic<int> started;
+            qak::thread::RP th;
+            {
+                qak::mutex_lock lock(mut);
+                th = qak::start_thread([&mut, &started]() {
+                    started = 1;
+                    qak::mutex_lock lock(mut);
+                });
+                while (!started)
+                    qak::this_thread::yield();
+                qak::this_thread::sleep_ns(5*1000*1000);
+            }
+            th->join();
+
+            ms = stats_for("zzz contended");
+            if (!qak::mutex_profiling_enabled() || (ms.cnt_contended && 1*1000*1000 <= ms.wait_ns_max))
+                break;
+        }
+
+        if (qak::mutex_profiling_enabled())
+        {
+            QAK_verify( ms.cnt_acquisitions == 2 );
+            QAK_verify( ms.cnt_contended == 1 );
+            QAK_verify( 1*1000*1000 <= ms.wait_ns_max );
+            QAK_verify( ms.wait_ns_max == ms.wait_ns_total );
+            QAK_verify( 5*1000*1000 <= ms.hold_ns_max );
+
+            //	Hottest first.
+            QAK_verify( !std::strcmp(qak::mutex_stats_snapshot()[0].psz_name, "zzz contended") );
+        }
+
+        qak::write_mutex_stats_report(stderr);
+
+        qak::reset_mutex_stats();
+        QAK_verify( stats_for("zzz contended").cnt_acquisitions == 0 );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
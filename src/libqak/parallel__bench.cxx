@@ -0,0 +1,111 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	parallel__bench.cxx
+
+#include "qak/parallel.hxx"
+
+#include "qak/executor.hxx"
+#include "qak/prng64.hxx"
+#include "qak/stopwatch.hxx"
+#include "qak/vector.hxx"
+
+#include <algorithm> // std::sort
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    std::size_t const cnt_elems = 4*1000*1000;
+
+    qak::vector<std::uint64_t> random_data()
+    {
+        qak::prng64 prng;
+        qak::vector<std::uint64_t> v;
+        v.reserve(cnt_elems);
+        for (std::size_t ix = 0; ix < cnt_elems; ++ix)
+            v.push_back(prng.generate<std::uint64_t>());
+        return v;
+    }
+
+    std::uint64_t add(std::uint64_t a, std::uint64_t b) { return a + b; }
+
+    QAKtest(reduce, "Summing, serially and with parallel_reduce on the default executor. Time is per element.")
+    {
+        qak::vector<std::uint64_t> v = random_data();
+        qak::executor & ex = qak::default_executor();
+
+        std::uint64_t sum_serial = 0;
+        {
+            qak::stopwatch sw;
+            for (std::uint64_t u : v)
+                sum_serial += u;
+            QAK_bench_report("serial", cnt_elems, sw.elapsed_ns());
+        }
+        {
+            qak::stopwatch sw;
+            std::uint64_t sum = qak::parallel_reduce(ex, v, std::uint64_t(0), add);
+            QAK_bench_report("parallel_reduce", cnt_elems, sw.elapsed_ns());
+            QAK_verify( sum == sum_serial );
+        }
+    }
+
+    QAKtest(scan, "Running sums, serially and with parallel_inclusive_scan. Time is per element.")
+    {
+        qak::vector<std::uint64_t> v = random_data();
+        qak::vector<std::uint64_t> v2(v);
+        qak::executor & ex = qak::default_executor();
+
+        {
+            qak::stopwatch sw;
+            for (std::size_t ix = 1; ix < cnt_elems; ++ix)
+                v[ix] += v[ix - 1];
+            QAK_bench_report("serial", cnt_elems, sw.elapsed_ns());
+        }
+        {
+            qak::stopwatch sw;
+            qak::parallel_inclusive_scan(ex, v2, add);
+            QAK_bench_report("parallel_inclusive_scan", cnt_elems, sw.elapsed_ns());
+            QAK_verify( v2.back() == v.back() );
+        }
+    }
+
+    QAKtest(sort, "Sorting, with std::sort and parallel_sort. Time is per element.")
+    {
+        qak::vector<std::uint64_t> v = random_data();
+        qak::vector<std::uint64_t> v2(v);
+        qak::executor & ex = qak::default_executor();
+
+        {
+            qak::stopwatch sw;
+            std::sort(v.begin(), v.end());
+            QAK_bench_report("std::sort", cnt_elems, sw.elapsed_ns());
+        }
+        {
+            qak::stopwatch sw;
+            qak::parallel_sort(ex, v2);
+            QAK_bench_report("parallel_sort", cnt_elems, sw.elapsed_ns());
+            QAK_verify( std::equal(v.begin(), v.end(), v2.begin()) );
+        }
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,183 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	parallel__test.cxx
+
+#include "qak/parallel.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/executor.hxx"
+#include "qak/prng64.hxx"
+#include "qak/vector.hxx"
+
+#include <algorithm> // std::sort
+#include <functional> // std::greater
+#include <iterator> // std::reverse_iterator
+#include <stdexcept> // std::runtime_error
+#include <string>
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    //	Sizes around the thresholds: empty, inline, just over, and many pieces.
+    std::size_t const sizes[] = { 0, 1, 1000, 1024, 1025, 5000, 100*1000 };
+
+    QAKtest(for_, "parallel_for visits every index and element exactly once.")
+    {
+        qak::executor ex(4);
+        for (std::size_t cnt : sizes)
+        {
+            qak::vector<qak::atomic<std::uint32_t>> visits(cnt);
+            qak::parallel_for(ex, 0, cnt, [&](std::size_t ix) { ++visits[ix]; });
+            bool all_once = true;
+            for (auto & a : visits)
+                all_once = all_once && a.load() == 1;
+            QAK_verify( all_once );
+
+            qak::vector<std::uint64_t> v(cnt, 3);
+            qak::parallel_for(ex, v, [](std::uint64_t & u) { u *= 2; }, 7);
+            QAK_verify( std::count(v.begin(), v.end(), std::uint64_t(6)) == std::ptrdiff_t(cnt) );
+        }
+
+        //	Explicit grain, and subranges within it.
+        qak::atomic<std::size_t> cnt_pieces;
+        qak::atomic<bool> too_big;
+        qak::parallel_for_ranges(ex, 10, 1010, [&](std::size_t b, std::size_t e) {
+                ++cnt_pieces;
+                if (10 < e - b)
+                    too_big = true;
+            },
+            10 );
+        QAK_verify( 100 <= cnt_pieces.load() );
+        QAK_refute( too_big.load() );
+    }
+
+    QAKtest(reduce, "parallel_reduce matches the serial fold, even for a non-commutative combine.")
+    {
+        qak::executor ex(4);
+        for (std::size_t cnt : sizes)
+        {
+            qak::vector<std::uint64_t> v;
+            for (std::size_t ix = 0; ix < cnt; ++ix)
+                v.push_back(ix*ix);
+
+            std::uint64_t sum = 0;
+            for (std::uint64_t u : v)
+                sum += u;
+            QAK_verify( qak::parallel_reduce(ex, v, std::uint64_t(0), [](std::uint64_t a, std::uint64_t b) {
+                return a + b; }) == sum );
+
+            //	Concatenation is associative but not commutative, so this checks the order.
+            std::string s_serial;
+            for (std::size_t ix = 0; ix < cnt; ++ix)
+                s_serial += char('a' + ix % 26);
+            std::string s = qak::parallel_reduce(ex, 0, cnt, std::string(),
+                [](std::size_t ix) { return std::string(1, char('a' + ix % 26)); },
+                [](std::string a, std::string const & b) { return a + b; },
+                100 );
+            QAK_verify( s == s_serial );
+        }
+    }
+
+    QAKtest(scan, "parallel_inclusive_scan matches the serial running sums.")
+    {
+        qak::executor ex(4);
+        for (std::size_t cnt : sizes)
+        {
+            qak::prng64 prng(cnt);
+            qak::vector<std::uint64_t> v;
+            for (std::size_t ix = 0; ix < cnt; ++ix)
+                v.push_back(prng.generate_below<std::uint64_t>(1000));
+
+            qak::vector<std::uint64_t> expected(v);
+            for (std::size_t ix = 1; ix < cnt; ++ix)
+                expected[ix] += expected[ix - 1];
+
+            qak::parallel_inclusive_scan(ex, v, [](std::uint64_t a, std::uint64_t b) { return a + b; });
+            QAK_verify( std::equal(v.begin(), v.end(), expected.begin()) );
+        }
+    }
+
+    QAKtest(sort, "parallel_sort matches std::sort.")
+    {
+        qak::executor ex(4);
+        for (std::size_t cnt : sizes)
+        {
+            //	Few distinct values, so lots of equal ones for the merges to split between.
+            qak::prng64 prng(cnt);
+            qak::vector<std::uint32_t> v;
+            for (std::size_t ix = 0; ix < cnt; ++ix)
+                v.push_back(prng.generate_below<std::uint32_t>(ix % 2 ? 50 : 1000*1000));
+
+            qak::vector<std::uint32_t> expected(v);
+            std::sort(expected.begin(), expected.end());
+            qak::vector<std::uint32_t> v2(v);
+
+            qak::parallel_sort(ex, v);
+            QAK_verify( std::equal(v.begin(), v.end(), expected.begin()) );
+
+            qak::parallel_sort(ex, v2, std::greater<std::uint32_t>());
+            QAK_verify( std::equal(v2.begin(), v2.end(), std::reverse_iterator<std::uint32_t *>(expected.end())) );
+        }
+    }
+
+    QAKtest(nested, "Algorithms called from within tasks of the same executor, and with no workers at all.")
+    {
+        qak::executor ex(2);
+        qak::vector<std::uint64_t> sums(20);
+        qak::parallel_for(ex, 0, sums.size(), [&](std::size_t ix) {
+                sums[ix] = qak::parallel_reduce(ex, 0, 10*1000, std::uint64_t(0),
+                    [](std::size_t u) { return std::uint64_t(u); },
+                    [](std::uint64_t a, std::uint64_t b) { return a + b; });
+            },
+            1 );
+        QAK_verify( std::count(sums.begin(), sums.end(), std::uint64_t(10*1000*9999/2)) == 20 );
+
+        ex.threads().set_target_cnt_threads(0);
+        ex.threads().join();
+        qak::vector<std::uint32_t> v;
+        for (std::uint32_t u = 0; u < 50*1000; ++u)
+            v.push_back(u*2654435761u);
+        qak::parallel_sort(ex, v);
+        QAK_verify( std::is_sorted(v.begin(), v.end()) );
+    }
+
+    QAKtest(exception, "An exception from a body comes out of the call.")
+    {
+        qak::executor ex(4);
+        bool threw = false;
+        try
+        {
+            qak::parallel_for(ex, 0, 10*1000, [](std::size_t ix) {
+                    if (ix == 7777)
+                        throw std::runtime_error("from a body");
+                },
+                100 );
+        }
+        catch (std::runtime_error const &)
+        {
+            threw = true;
+        }
+        QAK_verify( threw );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -22,7 +22,12 @@
 #include "qak/permutation.hxx"
 
 #include "qak/fail.hxx"
+#include "qak/host_info.hxx"
+#include "qak/min_max.hxx"
+#include "qak/prng64.hxx"
 #include "qak/rotate_sequence.hxx"
+#include "qak/shuffle.hxx"
+#include "qak/thread.hxx"
 
 #include <cstring> // memcpy
 
@@ -89,6 +94,152 @@ namespace permutation_imp {
 
 	//-----------------------------------------------------------------------------------------------------------------|
 
+	template <int N>
+	void index_permutation_imp<N>::reset_random(uint_type n, prng64 & prng)
+	{
+		f_.resize(n);
+		r_.resize(n);
+		if (!n)
+			return;
+
+		uint_type * f = &f_[0];
+		uint_type * r = &r_[0];
+
+		//	The "inside-out" Fisher-Yates: each new element is appended and then swapped with a uniformly chosen
+		//	position in the prefix, so r_ can be maintained as we go.
+		for (uint_type ix = 0; ix < n; ++ix)
+		{
+			uint_type jx = prng.generate_below<uint_type>(static_cast<uint_type>(ix + 1u));
+
+			f[ix] = ix;
+			uint_type val = f[jx];
+			f[ix] = val;
+			f[jx] = ix;
+			r[val] = ix;
+			r[ix] = jx;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	Runs fn(ix_thread) for each ix_thread in [0, cnt_threads). Index 0 runs on the calling thread.
+	//	Returns after all have completed.
+	template <class fn_T>
+	static void run_on_threads(std::size_t cnt_threads, fn_T const & fn)
+	{
+		vector<thread::RP> threads;
+		threads.reserve(cnt_threads);
+		for (std::size_t ix_thread = 1; ix_thread < cnt_threads; ++ix_thread)
+			threads.push_back(start_thread([&fn, ix_thread]() { fn(ix_thread); }));
+
+		bool ok = false;
+		try
+		{
+			fn(0);
+			ok = true;
+		}
+		catch (...) { }
+
+		for (std::size_t ix = 0; ix < threads.size(); ++ix)
+			ok = threads[ix]->join() && ok;
+
+		fail_unless(ok);
+	}
+
+	//	Below this count of elements per thread, threads cost more than they save.
+	static std::size_t const min_parallel_elements_per_thread = std::size_t(1) << 16;
+
+	//	This is the multinomial bucketing algorithm: each element is assigned to one of k buckets uniformly at
+	//	random, then each bucket is shuffled independently. Since the bucket assignments are independent and the
+	//	buckets are uniformly shuffled, every permutation is equally likely.
+	//	See Sanders (1998) "Random Permutations on Distributed, External and Hierarchical Memory".
+	//
+	//	Each thread makes its bucket draws twice from identical prng states, once to count and once to scatter,
+	//	so the assignments never need to be stored.
+	//
+	template <int N>
+	void index_permutation_imp<N>::reset_random_parallel(uint_type n, prng64 & prng, std::size_t cnt_threads)
+	{
+		if (!cnt_threads)
+			cnt_threads = host_info::cnt_threads_recommended();
+
+		std::size_t const k = qak::min<std::size_t>(cnt_threads, n/min_parallel_elements_per_thread);
+		if (k <= 1)
+		{
+			reset_random(n, prng);
+			return;
+		}
+
+		f_.resize(n);
+		r_.resize(n);
+		uint_type * f = &f_[0];
+		uint_type * r = &r_[0];
+
+		vector<prng64> prngs;
+		prngs.reserve(k);
+		for (std::size_t t = 0; t < k; ++t)
+			prngs.push_back(prng64::seed_from(prng));
+
+		//	The range of source indices handled by thread t.
+		auto chunk_b = [n, k](std::size_t t) -> uint_type
+		{
+			return static_cast<uint_type>(n/k*t + qak::min<std::size_t>(t, n%k));
+		};
+
+		//	cnts[t*k + b] is the count of elements thread t sends to bucket b.
+		//	Later, the position in f_ to which thread t writes its next element for bucket b.
+		vector<std::size_t> cnts(k*k, 0);
+
+		//	Count.
+		run_on_threads(k, [&](std::size_t t)
+		{
+			prng64 prng_t(prngs[t]);
+			vector<std::size_t> cnts_t(k, 0);
+			for (uint_type ix = chunk_b(t), ix_e = chunk_b(t + 1); ix < ix_e; ++ix)
+				++cnts_t[prng_t.generate_below<std::size_t>(k)];
+			for (std::size_t b = 0; b < k; ++b)
+				cnts[t*k + b] = cnts_t[b];
+		});
+
+		//	Exclusive prefix sum in bucket-major order converts the counts into starting positions.
+		//	bucket_bs[b] is the starting position of bucket b.
+		vector<std::size_t> bucket_bs(k + 1, 0);
+		std::size_t pos = 0;
+		for (std::size_t b = 0; b < k; ++b)
+		{
+			bucket_bs[b] = pos;
+			for (std::size_t t = 0; t < k; ++t)
+			{
+				std::size_t cnt = cnts[t*k + b];
+				cnts[t*k + b] = pos;
+				pos += cnt;
+			}
+		}
+		bucket_bs[k] = pos;
+		assert(pos == n);
+
+		//	Scatter.
+		run_on_threads(k, [&](std::size_t t)
+		{
+			prng64 & prng_t = prngs[t];
+			vector<std::size_t> pos_t(&cnts[t*k], &cnts[t*k] + k);
+			for (uint_type ix = chunk_b(t), ix_e = chunk_b(t + 1); ix < ix_e; ++ix)
+				f[pos_t[prng_t.generate_below<std::size_t>(k)]++] = ix;
+		});
+
+		//	Shuffle each bucket and fill in its part of the reverse mapping.
+		run_on_threads(k, [&](std::size_t b)
+		{
+			uint_type * p_b = f + bucket_bs[b];
+			uint_type * p_e = f + bucket_bs[b + 1];
+			shuffle(p_b, p_e, prngs[b]);
+			for (uint_type * p = p_b; p != p_e; ++p)
+				r[*p] = static_cast<uint_type>(p - f);
+		});
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
 	template <int N>
 	void index_permutation_imp<N>::invert()
 	{
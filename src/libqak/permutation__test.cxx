@@ -21,6 +21,8 @@
 
 #include "qak/permutation.hxx"
 
+#include "qak/prng64.hxx"
+
 #include "qak/test_app_pre.hxx"
 #include "qak/test_macros.hxx"
 
@@ -753,6 +755,86 @@ namespace zzz { //==============================================================
 
 	//-----------------------------------------------------------------------------------------------------------------|
 
+	//	Verifies that the forward and reverse mappings are inverses of each other and cover all indices.
+	template <class T> void verify_consistent(index_permutation<T> const & p)
+	{
+		for (T ix = 0; ix < p.size(); ++ix)
+		{
+			QAK_verify(p.f_at(ix) < p.size());
+			QAK_verify_equal(p.r_at(p.f_at(ix)), ix);
+		}
+	}
+
+	template <class T> void test_index_permutation_reset_random()
+	{
+		qak::prng64 prng;
+
+		for (T n = 0; n < 50; ++n)
+			verify_consistent(qak::random_permutation<T>(n, prng));
+
+		//	Each of the 3! permutations should be about equally likely.
+		unsigned cnts[3*3*3] = { 0 };
+		unsigned const cnt_iters = 6*1000;
+		index_permutation<T> p;
+		for (unsigned n = 0; n < cnt_iters; ++n)
+		{
+			p.reset_random(3, prng);
+			verify_consistent(p);
+			++cnts[p[0]*9 + p[1]*3 + p[2]];
+		}
+
+		unsigned cnt_distinct = 0;
+		for (unsigned ix = 0; ix < 3*3*3; ++ix)
+			if (cnts[ix])
+			{
+				++cnt_distinct;
+				QAK_verify(  cnt_iters/6*2/3 < cnts[ix] && cnts[ix] < cnt_iters/6*4/3  );
+			}
+		QAK_verify_equal(cnt_distinct, 6);
+	}
+
+	QAKtest(index_permutation_reset_random, "index_permutation reset_random().")
+	{
+		test_index_permutation_reset_random<signed char>();
+		test_index_permutation_reset_random<short int>();
+		test_index_permutation_reset_random<int>();
+		test_index_permutation_reset_random<unsigned char>();
+		test_index_permutation_reset_random<unsigned int>();
+#if 64 <= QAK_pointer_bits
+		test_index_permutation_reset_random<unsigned long long int>();
+#endif
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	QAKtest(index_permutation_reset_random_parallel, "index_permutation reset_random_parallel().")
+	{
+		qak::prng64 prng;
+
+		//	Small counts are done inline.
+		verify_consistent(qak::parallel_random_permutation<unsigned>(1000, prng, 4));
+
+		//	Large enough to actually use the threads.
+		unsigned const n = 1u << 19;
+		for (std::size_t cnt_threads = 1; cnt_threads <= 4; ++cnt_threads)
+		{
+			index_permutation<unsigned> p;
+			p.reset_random_parallel(n, prng, cnt_threads);
+			QAK_verify_equal(p.size(), n);
+			verify_consistent(p);
+
+			//	Not the identity, and the first element can land anywhere.
+			QAK_verify(p != index_permutation<unsigned>(n));
+		}
+
+		//	Repeatable for the same seed and count of threads.
+		qak::prng64 prng_a(1234), prng_b(1234);
+		QAK_verify(   qak::parallel_random_permutation<unsigned>(n, prng_a, 3)
+		           == qak::parallel_random_permutation<unsigned>(n, prng_b, 3) );
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
 
 } // namespace zzz ====================================================================================================|
 #include "qak/test_app_post.hxx"
@@ -0,0 +1,405 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	pool.cxx
+
+#include "qak/pool.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/fail.hxx"
+#include "qak/vector.hxx"
+
+#include <cassert>
+#include <new> // std::align_val_t
+
+namespace qak_pool_imp_ { //===========================================================================================|
+
+	using qak::memory_order;
+
+	//	Slabs are aligned to their size, so a block's slab header can be found by masking its address.
+	std::size_t const min_slab_bytes = 64*1024;
+	std::size_t const min_blocks_per_slab = 16;
+
+	//	Cross-thread frees are handed back to the owning thread this many at a time.
+	std::size_t const remote_batch_size = 32;
+
+	struct free_block
+	{
+		free_block * p_next;
+	};
+
+	struct thread_cache;
+
+	struct slab_header
+	{
+		thread_cache * p_owner;
+	};
+
+	//	Blocks freed by this thread that belong to some other thread's slabs.
+	struct remote_batch
+	{
+		thread_cache * p_owner;
+		free_block * p_head;
+		free_block * p_tail;
+		std::size_t cnt;
+	};
+
+	//	A statistics counter written only by its owning thread and read by any. It's on the allocation fast path, so
+	//	this avoids the out-of-line qak::atomic operations where the compiler allows.
+	struct stat_counter
+	{
+#if QAK_HAS_GNUC_ATOMIC_BUILTINS
+		void bump() QAK_noexcept { __atomic_store_n(&cnt_, cnt_ + 1, __ATOMIC_RELAXED); }
+		std::uint64_t load() const QAK_noexcept { return __atomic_load_n(&cnt_, __ATOMIC_RELAXED); }
+	private:
+		std::uint64_t cnt_ = 0;
+#else
+		void bump() QAK_noexcept { cnt_.store(cnt_.load(memory_order::relaxed) + 1, memory_order::relaxed); }
+		std::uint64_t load() const QAK_noexcept { return cnt_.load(memory_order::relaxed); }
+	private:
+		qak::atomic<std::uint64_t> cnt_;
+#endif
+	};
+
+	//	A thread's share of a pool. Caches are never freed; a thread that exits gives its cache back for reuse, and
+	//	its free blocks and slabs go with it.
+	//
+	struct thread_cache
+	{
+		pool_data * p_pool = 0;
+
+		//	Nonzero while the cache is owned by a thread.
+		qak::atomic<std::uintptr_t> in_use;
+
+		//	Chains of blocks handed back by other threads.
+		qak::atomic<free_block *> p_remote_head;
+
+		//	The rest is private to the owning thread, except the stats.
+
+		free_block * p_free = 0;
+
+		//	Uncarved space in the newest slab.
+		char * p_carve = 0;
+		char * p_carve_end = 0;
+
+		qak::vector<remote_batch> pending;
+
+		stat_counter cnt_allocs;
+		stat_counter cnt_frees;
+		stat_counter cnt_remote_frees;
+		stat_counter cnt_slabs;
+
+		//	Immutable once the cache is published.
+		thread_cache * p_next = 0;
+	};
+
+	struct pool_data
+	{
+		std::size_t ix;
+		std::size_t block_bytes;
+		std::size_t first_block_offset;
+		std::size_t slab_bytes;
+
+		qak::atomic<thread_cache *> p_caches_head;
+	};
+
+	qak::atomic<std::size_t> cnt_pools;
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	void release_cache(thread_cache * p_cache) QAK_noexcept;
+
+	//	This thread's caches, indexed by pool. Trivially destructible, so they remain usable by other thread_local
+	//	destructors that free pooled objects after tls_exit_hook has run. A cache acquired that late is never given
+	//	back.
+	thread_local thread_cache ** tls_caches = 0;
+	thread_local std::size_t tls_cnt_caches = 0;
+
+	struct tls_exit_hook
+	{
+		~tls_exit_hook()
+		{
+			thread_cache ** caches = tls_caches;
+			std::size_t cnt = tls_cnt_caches;
+			tls_caches = 0;
+			tls_cnt_caches = 0;
+
+			for (std::size_t ix = 0; ix < cnt; ++ix)
+				if (caches[ix])
+					release_cache(caches[ix]);
+			delete [] caches;
+		}
+	};
+
+	thread_local tls_exit_hook tls_exit;
+
+	thread_cache * acquire_cache(pool_data * p_pool)
+	{
+		for (thread_cache * p = p_pool->p_caches_head.load(memory_order::acquire); p; p = p->p_next)
+		{
+			std::uintptr_t expected = 0;
+			if (!p->in_use.load(memory_order::relaxed) && p->in_use.compare_exchange_strong(expected, 1))
+				return p;
+		}
+
+		thread_cache * p_cache = new thread_cache;
+		p_cache->p_pool = p_pool;
+		p_cache->in_use.store(1, memory_order::relaxed);
+
+		thread_cache * p_head = p_pool->p_caches_head.load(memory_order::relaxed);
+		do {
+			p_cache->p_next = p_head;
+		} while (!p_pool->p_caches_head.compare_exchange_weak(
+			p_head, p_cache, memory_order::release, memory_order::relaxed));
+
+		return p_cache;
+	}
+
+	thread_cache * this_thread_cache_slow(pool_data * p_pool)
+	{
+		if (tls_cnt_caches <= p_pool->ix)
+		{
+			std::size_t cnt = p_pool->ix + 1 < 2*tls_cnt_caches ? 2*tls_cnt_caches : p_pool->ix + 1;
+			thread_cache ** caches = new thread_cache * [cnt]();
+			for (std::size_t ix = 0; ix < tls_cnt_caches; ++ix)
+				caches[ix] = tls_caches[ix];
+			delete [] tls_caches;
+			tls_caches = caches;
+			tls_cnt_caches = cnt;
+		}
+
+		static_cast<void>(&tls_exit); // ensures the exit hook is registered for this thread
+
+		return tls_caches[p_pool->ix] = acquire_cache(p_pool);
+	}
+
+	inline thread_cache * this_thread_cache(pool_data * p_pool)
+	{
+		if (p_pool->ix < tls_cnt_caches)
+			if (thread_cache * p_cache = tls_caches[p_pool->ix])
+				return p_cache;
+		return this_thread_cache_slow(p_pool);
+	}
+
+	//	For the free path, which mustn't throw. Returns null if the thread has no cache and one can't be had.
+	inline thread_cache * this_thread_cache_nothrow(pool_data * p_pool) QAK_noexcept
+	{
+		if (p_pool->ix < tls_cnt_caches)
+			if (thread_cache * p_cache = tls_caches[p_pool->ix])
+				return p_cache;
+
+		try
+		{
+			return this_thread_cache_slow(p_pool);
+		}
+		catch (...)
+		{
+			return 0;
+		}
+	}
+
+	inline thread_cache * owner_of(pool_data * p_pool, void * p) QAK_noexcept
+	{
+		std::uintptr_t slab = reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t(p_pool->slab_bytes - 1);
+		return reinterpret_cast<slab_header *>(slab)->p_owner;
+	}
+
+	void push_remote(remote_batch const & batch) QAK_noexcept
+	{
+		qak::atomic<free_block *> & head = batch.p_owner->p_remote_head;
+		free_block * p_old = head.load(memory_order::relaxed);
+		do {
+			batch.p_tail->p_next = p_old;
+		} while (!head.compare_exchange_weak(p_old, batch.p_head, memory_order::release, memory_order::relaxed));
+	}
+
+	void flush_pending(thread_cache * p_cache) QAK_noexcept
+	{
+		for (std::size_t ix = 0; ix < p_cache->pending.size(); ++ix)
+			push_remote(p_cache->pending[ix]);
+		p_cache->pending.clear();
+	}
+
+	void release_cache(thread_cache * p_cache) QAK_noexcept
+	{
+		flush_pending(p_cache);
+		p_cache->in_use.store(0, memory_order::release);
+	}
+
+	void * allocate_slow(thread_cache * p_cache)
+	{
+		pool_data * p_pool = p_cache->p_pool;
+
+		//	Take whatever other threads have handed back.
+		if (free_block * p_remote = p_cache->p_remote_head.exchange(0, memory_order::acquire))
+		{
+			p_cache->p_free = p_remote->p_next;
+			return p_remote;
+		}
+
+		if (p_cache->p_carve == p_cache->p_carve_end)
+		{
+			char * p_slab = static_cast<char *>(::operator new(p_pool->slab_bytes, std::align_val_t(p_pool->slab_bytes)));
+			reinterpret_cast<slab_header *>(p_slab)->p_owner = p_cache;
+			p_cache->p_carve = p_slab + p_pool->first_block_offset;
+			p_cache->p_carve_end = p_cache->p_carve
+				+ (p_pool->slab_bytes - p_pool->first_block_offset)/p_pool->block_bytes*p_pool->block_bytes;
+			p_cache->cnt_slabs.bump();
+		}
+
+		void * p = p_cache->p_carve;
+		p_cache->p_carve += p_pool->block_bytes;
+		return p;
+	}
+
+} // namespace qak_pool_imp_
+namespace qak { //=====================================================================================================|
+
+	using namespace qak_pool_imp_;
+
+	fixed_pool::fixed_pool(std::size_t block_bytes, std::size_t block_align) :
+		p_data_(new pool_data)
+	{
+		fail_unless(block_align && !(block_align & (block_align - 1)));
+
+		if (block_align < alignof(free_block))
+			block_align = alignof(free_block);
+		if (block_bytes < sizeof(free_block))
+			block_bytes = sizeof(free_block);
+		block_bytes = (block_bytes + block_align - 1) & ~(block_align - 1);
+
+		std::size_t first_block_offset = (sizeof(slab_header) + block_align - 1) & ~(block_align - 1);
+
+		std::size_t slab_bytes = min_slab_bytes;
+		while (slab_bytes < first_block_offset + min_blocks_per_slab*block_bytes)
+			slab_bytes *= 2;
+
+		p_data_->ix = cnt_pools++;
+		p_data_->block_bytes = block_bytes;
+		p_data_->first_block_offset = first_block_offset;
+		p_data_->slab_bytes = slab_bytes;
+	}
+
+	void * fixed_pool::allocate()
+	{
+		thread_cache * p_cache = this_thread_cache(p_data_);
+
+		void * p;
+		if (free_block * p_block = p_cache->p_free)
+		{
+			p_cache->p_free = p_block->p_next;
+			p = p_block;
+		}
+		else
+			p = allocate_slow(p_cache);
+
+		p_cache->cnt_allocs.bump();
+		return p;
+	}
+
+	void fixed_pool::deallocate(void * p) QAK_noexcept
+	{
+		if (!p)
+			return;
+
+		thread_cache * p_owner = owner_of(p_data_, p);
+		free_block * p_block = static_cast<free_block *>(p);
+
+		thread_cache * p_cache = this_thread_cache_nothrow(p_data_);
+		if (!p_cache)
+		{
+			//	Out of memory for a cache of our own, so hand the block straight back to its owner, uncounted.
+			remote_batch batch = { p_owner, p_block, p_block, 1 };
+			push_remote(batch);
+			return;
+		}
+
+		p_cache->cnt_frees.bump();
+
+		if (p_owner == p_cache)
+		{
+			p_block->p_next = p_cache->p_free;
+			p_cache->p_free = p_block;
+			return;
+		}
+
+		p_cache->cnt_remote_frees.bump();
+
+		qak::vector<remote_batch> & pending = p_cache->pending;
+		std::size_t ix = 0;
+		while (ix < pending.size() && pending[ix].p_owner != p_owner)
+			++ix;
+
+		if (ix == pending.size())
+		{
+			remote_batch batch = { p_owner, p_block, p_block, 0 };
+			p_block->p_next = 0;
+			try
+			{
+				pending.push_back(batch);
+			}
+			catch (...)
+			{
+				//	No room to start a batch, so this block goes back on its own.
+				batch.cnt = 1;
+				push_remote(batch);
+				return;
+			}
+		}
+		else
+		{
+			p_block->p_next = pending[ix].p_head;
+			pending[ix].p_head = p_block;
+		}
+
+		if (remote_batch_size <= ++pending[ix].cnt)
+		{
+			push_remote(pending[ix]);
+			pending[ix] = pending.back();
+			pending.pop_back();
+		}
+	}
+
+	std::size_t fixed_pool::block_size() const QAK_noexcept
+	{
+		return p_data_->block_bytes;
+	}
+
+	pool_stats fixed_pool::stats() const
+	{
+		pool_stats st = { };
+		for (thread_cache * p = p_data_->p_caches_head.load(memory_order::acquire); p; p = p->p_next)
+		{
+			st.cnt_allocs += p->cnt_allocs.load();
+			st.cnt_frees += p->cnt_frees.load();
+			st.cnt_remote_frees += p->cnt_remote_frees.load();
+			st.cnt_slabs += p->cnt_slabs.load();
+		}
+		st.cnt_bytes_reserved = st.cnt_slabs*p_data_->slab_bytes;
+		return st;
+	}
+
+	void fixed_pool::flush_this_thread() QAK_noexcept
+	{
+		if (p_data_->ix < tls_cnt_caches)
+			if (thread_cache * p_cache = tls_caches[p_data_->ix])
+				flush_pending(p_cache);
+	}
+
+} // namespace qak ====================================================================================================|
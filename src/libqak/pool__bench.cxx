@@ -0,0 +1,109 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	pool__bench.cxx
+
+#include "qak/pool.hxx"
+
+#include "qak/rptr.hxx"
+#include "qak/stopwatch.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    std::uint64_t const cnt_iters = 10*1000*1000;
+
+    struct event_heap : qak::rpointee_base<event_heap> { int i; };
+
+    struct event_pooled : qak::rpointee_base<event_pooled>, qak::rpointee_pooled<event_pooled> { int i; };
+
+    template <class T>
+    void bench_create_destroy(char const * psz_what)
+    {
+        QAK_bench_loop(psz_what, cnt_iters,
+            typename T::RP rp(new T);
+            QAK_bench_keep(rp)
+        );
+    }
+
+    QAKtest(create_destroy, "Allocate a new pointee and destroy it.")
+    {
+        bench_create_destroy<event_heap>("global new+delete");
+        bench_create_destroy<event_pooled>("rpointee_pooled new+delete");
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    template <class T>
+    void bench_burst(char const * psz_what)
+    {
+        std::size_t const cnt_burst = 1000;
+        qak::vector<typename T::RP> v;
+        v.resize(cnt_burst);
+
+        QAK_bench_loop(psz_what, cnt_iters/cnt_burst,
+            for (std::size_t ix = 0; ix < cnt_burst; ++ix)
+                v[ix].reset(new T);
+            for (std::size_t ix = 0; ix < cnt_burst; ++ix)
+                v[ix].reset()
+        );
+    }
+
+    QAKtest(burst, "Allocate 1000 pointees, then destroy them.")
+    {
+        bench_burst<event_heap>("global new+delete, bursts of 1000");
+        bench_burst<event_pooled>("rpointee_pooled new+delete, bursts of 1000");
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    //	One thread allocates, another frees, as with events handed between threads.
+    template <class T>
+    void bench_producer_consumer(char const * psz_what)
+    {
+        std::size_t const cnt_burst = 1000;
+        std::uint64_t const cnt_bursts = cnt_iters/cnt_burst/10;
+
+        qak::stopwatch sw;
+        for (std::uint64_t n = 0; n < cnt_bursts; ++n)
+        {
+            qak::vector<typename T::RP> v;
+            v.reserve(cnt_burst);
+            for (std::size_t ix = 0; ix < cnt_burst; ++ix)
+                v.push_back(typename T::RP(new T));
+
+            qak::thread::RP th = qak::start_thread([&v]() { v.clear(); });
+            th->join();
+        }
+        QAK_bench_report(psz_what, cnt_bursts*cnt_burst, sw.elapsed_ns());
+    }
+
+    QAKtest(producer_consumer, "Allocate on one thread, free on another.")
+    {
+        bench_producer_consumer<event_heap>("global new+delete, cross-thread free");
+        bench_producer_consumer<event_pooled>("rpointee_pooled new+delete, cross-thread free");
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
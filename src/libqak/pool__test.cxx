@@ -0,0 +1,145 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	pool__test.cxx
+
+#include "qak/pool.hxx"
+
+#include "qak/rptr.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdint> // std::uintptr_t
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(fixed_pool, "fixed_pool allocate and deallocate.")
+    {
+        qak::fixed_pool & pool = *new qak::fixed_pool(24, 8);
+        QAK_verify( pool.block_size() == 24 );
+
+        qak::vector<void *> v;
+        for (int n = 0; n < 10000; ++n)
+        {
+            void * p = pool.allocate();
+            QAK_verify( (reinterpret_cast<std::uintptr_t>(p) & 7) == 0 );
+            v.push_back(p);
+        }
+
+        qak::pool_stats st = pool.stats();
+        QAK_verify( st.cnt_allocs == 10000 );
+        QAK_verify( st.cnt_in_use() == 10000 );
+        QAK_verify( 1 < st.cnt_slabs );
+
+        for (std::size_t ix = 0; ix < v.size(); ++ix)
+            pool.deallocate(v[ix]);
+
+        st = pool.stats();
+        QAK_verify( st.cnt_in_use() == 0 );
+        QAK_verify( st.cnt_remote_frees == 0 );
+
+        //	Freed blocks are reused before new slabs are carved.
+        std::uint64_t cnt_slabs = st.cnt_slabs;
+        for (std::size_t ix = 0; ix < v.size(); ++ix)
+            v[ix] = pool.allocate();
+        for (std::size_t ix = 0; ix < v.size(); ++ix)
+            pool.deallocate(v[ix]);
+        QAK_verify( pool.stats().cnt_slabs == cnt_slabs );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    struct alignas(32) aligned_thing : qak::rpointee_pooled<aligned_thing>
+    {
+        char data[40];
+    };
+
+    QAKtest(alignment, "Blocks honor the alignment of the type.")
+    {
+        aligned_thing * p1 = new aligned_thing;
+        aligned_thing * p2 = new aligned_thing;
+        QAK_verify( (reinterpret_cast<std::uintptr_t>(p1) & 31) == 0 );
+        QAK_verify( (reinterpret_cast<std::uintptr_t>(p2) & 31) == 0 );
+        QAK_verify( aligned_thing::the_pool().block_size() == 64 );
+        delete p1;
+        delete p2;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    struct event : qak::rpointee_base<event>, qak::rpointee_pooled<event>
+    {
+        int i = 0;
+    };
+
+    struct bigger_event : event
+    {
+        char more[100];
+    };
+
+    QAKtest(rpointee_pooled, "rpointee_pooled objects allocate from their pool.")
+    {
+        qak::pool_stats st0 = event::pool_stats();
+        {
+            event::RP rp1(new event);
+            event::RP rp2(new event);
+            QAK_verify( event::pool_stats().cnt_allocs == st0.cnt_allocs + 2 );
+            QAK_verify( event::pool_stats().cnt_in_use() == 2 );
+
+            //	A derived class of a different size goes to the global operator new.
+            event::RP rp3(new bigger_event);
+            QAK_verify( event::pool_stats().cnt_allocs == st0.cnt_allocs + 2 );
+        }
+        QAK_verify( event::pool_stats().cnt_in_use() == 0 );
+    }
+
+    QAKtest(cross_thread_free, "Objects freed on another thread are handed back in batches.")
+    {
+        qak::fixed_pool & pool = *new qak::fixed_pool(16, 8);
+
+        std::size_t const cnt = 1000;
+        qak::vector<void *> v;
+        for (std::size_t ix = 0; ix < cnt; ++ix)
+            v.push_back(pool.allocate());
+        std::uint64_t const cnt_slabs = pool.stats().cnt_slabs;
+
+        qak::thread::RP th = qak::start_thread([&pool, &v]() {
+            for (std::size_t ix = 0; ix < v.size(); ++ix)
+                pool.deallocate(v[ix]);
+        });
+        QAK_verify( th->join() );
+
+        qak::pool_stats st = pool.stats();
+        QAK_verify( st.cnt_remote_frees == cnt );
+        QAK_verify( st.cnt_in_use() == 0 );
+
+        //	The blocks came back to this thread when the other one exited, so no new slab is needed.
+        for (std::size_t ix = 0; ix < cnt; ++ix)
+            v[ix] = pool.allocate();
+        QAK_verify( pool.stats().cnt_slabs == cnt_slabs );
+
+        for (std::size_t ix = 0; ix < cnt; ++ix)
+            pool.deallocate(v[ix]);
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
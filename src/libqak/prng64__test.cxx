@@ -141,5 +141,40 @@ namespace zzz { //==============================================================
 #endif
 	}
 
+	//	Bounded generation stays in range and hits every value with roughly equal frequency.
+	template <class T>
+	void generate_below_test(T bound)
+	{
+		prng_t prng;
+		unsigned cnts[16] = { 0 };
+		unsigned const cnt_iters = 16*1000;
+		for (unsigned n = 0; n < cnt_iters; ++n)
+		{
+			T a = prng.generate_below<T>(bound);
+			QAK_verify(  0 <= a && a < bound  );
+			if (bound <= 16)
+				++cnts[a];
+		}
+		if (bound <= 16)
+		{
+			for (unsigned ix = 0; ix < unsigned(bound); ++ix)
+			{
+				QAK_verify(  cnt_iters/unsigned(bound)*2/3 < cnts[ix] && cnts[ix] < cnt_iters/unsigned(bound)*4/3  );
+			}
+		}
+	}
+
+	QAKtest(generate_below, "generate_below")
+	{
+		generate_below_test<std::uint8_t>(1);
+		generate_below_test<std::uint8_t>(3);
+		generate_below_test<std::int16_t>(7);
+		generate_below_test<std::uint32_t>(16);
+		generate_below_test<int>(200000);
+		generate_below_test<std::uint64_t>(5);
+		generate_below_test<std::uint64_t>(std::uint64_t(3) << 62);
+		generate_below_test<std::int64_t>(std::numeric_limits<std::int64_t>::max());
+	}
+
 } // namespace zzz ====================================================================================================|
 #include "qak/test_app_post.hxx"
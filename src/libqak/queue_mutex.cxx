@@ -0,0 +1,391 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//
+//	queue_mutex.cxx
+
+#include "qak/queue_mutex.hxx"
+
+#include "qak/fail.hxx"
+#include "qak/host_info.hxx"
+#include "qak/imp/spin_wait.hxx"
+#include "qak/mutex.hxx"
+
+#include <cassert>
+
+namespace qak_queue_mutex_imp_ { //====================================================================================|
+
+	using qak::memory_order;
+
+	//	Nodes pass from thread to thread: each acquirer leaves its own node in the queue and goes away with its
+	//	predecessor's. So they're pooled rather than owned. Each thread keeps a cache, which goes to a shared list
+	//	when the thread exits. Never deleted, since a waker may still be notifying a node that has been recycled.
+
+	qak::mutex free_list_mut("qak::queue_mutex nodes");
+	qnode * p_free_list = 0;
+
+	struct node_cache
+	{
+		qnode * p_head = 0;
+
+		~node_cache()
+		{
+			if (!p_head)
+				return;
+
+			qnode * p_last = p_head;
+			while (p_last->p_next_free)
+				p_last = p_last->p_next_free;
+
+			qak::mutex_lock lock(free_list_mut);
+			p_last->p_next_free = p_free_list;
+			p_free_list = p_head;
+			p_head = 0;
+		}
+	};
+
+	thread_local node_cache tls_node_cache;
+
+	qnode * alloc_qnode()
+	{
+		node_cache & nc = tls_node_cache;
+		qnode * p = nc.p_head;
+		if (!p)
+		{
+			{
+				qak::mutex_lock lock(free_list_mut);
+				p = p_free_list;
+				if (p)
+					p_free_list = p->p_next_free;
+			}
+
+			if (!p)
+				p = new qnode();
+		}
+		else
+			nc.p_head = p->p_next_free;
+
+		p->p_next_free = 0;
+		return p;
+	}
+
+	void free_qnode(qnode * p) QAK_noexcept
+	{
+		node_cache & nc = tls_node_cache;
+		p->p_next_free = nc.p_head;
+		nc.p_head = p;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	As with mutex, waiters spin a while before parking, but longer, since a queued thread spins on a line no
+	//	other thread polls. On a single CPU the thread we're waiting on can't run while we spin.
+	unsigned cnt_spins_before_parking()
+	{
+		static unsigned const cnt = qak::spinning_can_help() ? 1000 : 0;
+		return cnt;
+	}
+
+	//	Waits for the predecessor to release the node and returns the state it released it with. We are its only
+	//	successor, so we're the only thread that may mark it parked.
+	std::uint32_t wait_for_release(qnode * p_pred) QAK_noexcept
+	{
+		std::uint32_t st = p_pred->state.load(memory_order::acquire);
+		for (unsigned n = cnt_spins_before_parking(); n && (st == node_locked); --n)
+		{
+			qak::spin_pause();
+			st = p_pred->state.load(memory_order::acquire);
+		}
+
+		if (st == node_locked)
+		{
+			if (p_pred->state.compare_exchange_strong(
+					st, node_locked_parked, memory_order::acquire, memory_order::acquire))
+				st = node_locked_parked;
+
+			while (st == node_locked_parked)
+			{
+				p_pred->state.wait(node_locked_parked, memory_order::relaxed);
+				st = p_pred->state.load(memory_order::acquire);
+			}
+		}
+
+		assert(st == node_released || st == node_released_global);
+		return st;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	The global lock of numa_cohort mode is a plain futex lock, like mutex but with no owner.
+
+	enum : std::uint32_t {
+		global_unlocked = 0,
+		global_locked = 1,
+		global_locked_waiters = 2
+	};
+
+	inline bool try_acquire_global(qak::atomic<std::uint32_t> & gs) QAK_noexcept
+	{
+		std::uint32_t st = global_unlocked;
+		return gs.compare_exchange_strong(st, global_locked, memory_order::acquire, memory_order::relaxed);
+	}
+
+	void acquire_global(qak::atomic<std::uint32_t> & gs) QAK_noexcept
+	{
+		if (try_acquire_global(gs))
+			return;
+
+		for (unsigned n = cnt_spins_before_parking(); n; --n)
+		{
+			qak::spin_pause();
+
+			std::uint32_t st = gs.load(memory_order::relaxed);
+			if (st == global_locked_waiters)
+				break;
+
+			if (st == global_unlocked && try_acquire_global(gs))
+				return;
+		}
+
+		while (gs.exchange(global_locked_waiters, memory_order::acquire) != global_unlocked)
+			gs.wait(global_locked_waiters, memory_order::relaxed);
+	}
+
+	inline void release_global(qak::atomic<std::uint32_t> & gs) QAK_noexcept
+	{
+		if (gs.exchange(global_unlocked, memory_order::release) == global_locked_waiters)
+			gs.notify_one();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	Consecutive holders from the same cohort before the global lock goes back up for grabs.
+	unsigned const max_cohort_handoffs = 64;
+
+} // namespace qak_queue_mutex_imp_
+namespace qak { //=====================================================================================================|
+
+	using namespace qak_queue_mutex_imp_;
+
+	queue_mutex::queue_mutex(queue_mutex_mode mode) :
+		cnt_cohorts_(0),
+		p_cohorts_(0),
+		global_state_(global_unlocked),
+		owner_(invalid_thread_id_value)
+	{
+		//	Cohort mode has its global lock even with one node, so it behaves the same everywhere.
+		unsigned cnt = 1;
+		if (mode == queue_mutex_mode::numa_cohort)
+			cnt = cnt_cohorts_ = host_info::cnt_numa_nodes();
+
+		p_cohorts_ = new padded<cohort>[cnt];
+		for (unsigned ix = 0; ix < cnt; ++ix)
+		{
+			qnode * p = alloc_qnode();
+			p->state.store(node_released, memory_order::relaxed);
+			p_cohorts_[ix]->p_tail.store(p, memory_order::relaxed);
+			p_cohorts_[ix]->cnt_handoffs = 0;
+		}
+	}
+
+	queue_mutex::~queue_mutex()
+	{
+		//	There is no conceivable circumstance in which it's valid to destroy the mutex while any lock is held.
+		assert(owner_.load(memory_order::relaxed) == invalid_thread_id_value);
+		assert(global_state_.load(memory_order::relaxed) == global_unlocked);
+
+		unsigned cnt = cnt_cohorts_ ? cnt_cohorts_ : 1;
+		for (unsigned ix = 0; ix < cnt; ++ix)
+		{
+			qnode * p = p_cohorts_[ix]->p_tail.load(memory_order::relaxed);
+			assert(p->state.load(memory_order::relaxed) == node_released);
+			free_qnode(p);
+		}
+
+		delete [] p_cohorts_;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	queue_mutex::lock_type queue_mutex::lock()
+	{
+		queue_mutex_lock lk((queue_mutex_lock::private_construct_tag()));
+		acquire_(lk);
+		return lk;
+	}
+
+	bool queue_mutex::is_locked_by_this_thread() const
+	{
+		return owner_.load(memory_order::relaxed) == this_thread::get_id();
+	}
+
+	optional<queue_mutex::lock_type> queue_mutex::try_lock()
+	{
+		queue_mutex_lock lk((queue_mutex_lock::private_construct_tag()));
+		if (!try_acquire_(lk))
+			return optional<lock_type>();
+
+		return lk;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	void queue_mutex::acquire_(queue_mutex_lock & lk)
+	{
+		if (is_locked_by_this_thread())
+			fail(); //	Already owns the mutex.
+
+		unsigned cohort_ix = 0;
+		if (cnt_cohorts_)
+			cohort_ix = host_info::numa_node_of_cpu(this_thread::get_cpu_ix()) % cnt_cohorts_;
+
+		qnode * p_node = alloc_qnode();
+		p_node->state.store(node_locked, memory_order::relaxed);
+
+		//	Get in line. The tail's previous node is the thread ahead of us, or a released one if there is none.
+		qnode * p_pred = cohort_for(cohort_ix).p_tail.exchange(p_node, memory_order::acq_rel);
+
+		std::uint32_t st = wait_for_release(p_pred);
+
+		//	Unless our predecessor passed us the global lock, compete for it with the other cohorts' leaders.
+		if (cnt_cohorts_ && st != node_released_global)
+			acquire_global(global_state_);
+
+		assert(owner_.load(memory_order::relaxed) == invalid_thread_id_value);
+		owner_.store(this_thread::get_id(), memory_order::relaxed);
+
+		lk.p_m_ = this;
+		lk.p_node_ = p_node;
+		lk.p_pred_ = p_pred;
+		lk.cohort_ix_ = cohort_ix;
+	}
+
+	bool queue_mutex::try_acquire_(queue_mutex_lock & lk)
+	{
+		if (is_locked_by_this_thread())
+			fail(); //	Already owns the mutex.
+
+		if (cnt_cohorts_ && global_state_.load(memory_order::relaxed) != global_unlocked)
+			return false;
+
+		unsigned cohort_ix = 0;
+		if (cnt_cohorts_)
+			cohort_ix = host_info::numa_node_of_cpu(this_thread::get_cpu_ix()) % cnt_cohorts_;
+
+		atomic<qnode *> & tail = cohort_for(cohort_ix).p_tail;
+
+		//	Free only if the last node in line has been released, i.e., no one holds the lock or is waiting.
+		qnode * p_pred = tail.load(memory_order::acquire);
+		if (p_pred->state.load(memory_order::relaxed) != node_released)
+			return false;
+
+		qnode * p_node = alloc_qnode();
+		p_node->state.store(node_locked, memory_order::relaxed);
+
+		if (!tail.compare_exchange_strong(p_pred, p_node, memory_order::acq_rel, memory_order::relaxed))
+		{
+			free_qnode(p_node);
+			return false;
+		}
+
+		//	We're now p_pred's successor. It was released a moment ago, but may have since been recycled and put back
+		//	in line by another thread, in which case we have a (short) wait. Either way it's correct to wait on it.
+		std::uint32_t st = wait_for_release(p_pred);
+
+		if (cnt_cohorts_ && st != node_released_global)
+		{
+			if (!try_acquire_global(global_state_))
+			{
+				//	Step back out of line. Any successor in our cohort competes for the global lock itself.
+				if (p_node->state.exchange(node_released, memory_order::release) == node_locked_parked)
+					p_node->state.notify_one();
+				free_qnode(p_pred);
+				return false;
+			}
+		}
+
+		assert(owner_.load(memory_order::relaxed) == invalid_thread_id_value);
+		owner_.store(this_thread::get_id(), memory_order::relaxed);
+
+		lk.p_m_ = this;
+		lk.p_node_ = p_node;
+		lk.p_pred_ = p_pred;
+		lk.cohort_ix_ = cohort_ix;
+		return true;
+	}
+
+	void queue_mutex::release_(queue_mutex_lock & lk) QAK_noexcept
+	{
+		assert(owner_.load(memory_order::relaxed) == this_thread::get_id());
+		owner_.store(invalid_thread_id_value, memory_order::relaxed);
+
+		qnode * p_node = lk.p_node_;
+		std::uint32_t st_release = node_released;
+
+		if (cnt_cohorts_)
+		{
+			//	If someone in our cohort is in line behind us, hand them the global lock along with the local one.
+			cohort & coh = cohort_for(lk.cohort_ix_);
+			if (coh.p_tail.load(memory_order::relaxed) != p_node && coh.cnt_handoffs < max_cohort_handoffs)
+			{
+				++coh.cnt_handoffs;
+				st_release = node_released_global;
+			}
+			else
+			{
+				coh.cnt_handoffs = 0;
+				release_global(global_state_);
+			}
+		}
+
+		if (p_node->state.exchange(st_release, memory_order::release) == node_locked_parked)
+			p_node->state.notify_one();
+
+		free_qnode(lk.p_pred_);
+
+		lk.p_m_ = 0;
+		lk.p_node_ = 0;
+		lk.p_pred_ = 0;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	queue_mutex_lock::queue_mutex_lock(queue_mutex & m) : queue_mutex_lock(private_construct_tag())
+	{
+		m.acquire_(*this);
+	}
+
+	queue_mutex_lock::queue_mutex_lock(queue_mutex_lock && that) QAK_noexcept :
+		p_m_(that.p_m_),
+		p_node_(that.p_node_),
+		p_pred_(that.p_pred_),
+		cohort_ix_(that.cohort_ix_)
+	{
+		that.p_m_ = 0;
+		that.p_node_ = 0;
+		that.p_pred_ = 0;
+	}
+
+	queue_mutex_lock::~queue_mutex_lock()
+	{
+		if (p_m_)
+			p_m_->release_(*this);
+	}
+
+} // namespace qak ====================================================================================================|
@@ -0,0 +1,155 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	queue_mutex__bench.cxx
+
+#include "qak/queue_mutex.hxx"
+
+#include "qak/host_info.hxx"
+#include "qak/mutex.hxx"
+#include "qak/stopwatch.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdio> // std::snprintf
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+using qak::queue_mutex;
+using qak::queue_mutex_lock;
+using qak::queue_mutex_mode;
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(uncontended, "Lock and unlock by a single thread.")
+    {
+        std::uint64_t const cnt_iters = 20*1000*1000;
+        std::uint64_t cnt = 0;
+
+        {
+            qak::mutex mut;
+            QAK_bench_loop("qak::mutex_lock", cnt_iters,
+                qak::mutex_lock lock(mut);
+                ++cnt
+            );
+        }
+        {
+            queue_mutex mut;
+            QAK_bench_loop("queue_mutex_lock, fifo", cnt_iters,
+                queue_mutex_lock lock(mut);
+                ++cnt
+            );
+            QAK_bench_loop("queue_mutex::try_lock(), fifo", cnt_iters,
+                if (qak::optional<queue_mutex_lock> opt_lock = mut.try_lock())
+                    ++cnt
+            );
+        }
+        {
+            queue_mutex mut(queue_mutex_mode::numa_cohort);
+            QAK_bench_loop("queue_mutex_lock, numa_cohort", cnt_iters,
+                queue_mutex_lock lock(mut);
+                ++cnt
+            );
+        }
+
+        QAK_verify( cnt == 4*cnt_iters );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    std::uint64_t const cnt_per_thread = 200*1000;
+
+    //	The critical section updates a few cache lines, as real ones tend to, so it matters where they were last.
+    struct shared_data
+    {
+        std::uint64_t cnt = 0;
+        std::uint64_t arr[4*QAK_CACHE_LINE_SIZE/sizeof(std::uint64_t)] = { };
+
+        void update()
+        {
+            ++cnt;
+            for (std::size_t ix = 0; ix < sizeof(arr)/sizeof(arr[0]); ix += QAK_CACHE_LINE_SIZE/sizeof(std::uint64_t))
+                arr[ix] += cnt;
+        }
+    };
+
+    //	Runs cnt_per_thread critical sections on each of 1, 2, 4, ... threads, up to twice cnt_cpus_available(), so
+    //	the last runs have more threads than CPUs. Queue locks hand off in order even to a thread that isn't running,
+    //	which is where they do worst. Returns the total number run.
+    template <class Fn>
+    std::uint64_t bench_sweep(char const * psz_what, Fn cs_fn)
+    {
+        unsigned const cnt_threads_max = 2*qak::host_info::cnt_cpus_available();
+        std::uint64_t cnt_total = 0;
+
+        for (unsigned n = 1; ; n = (n*2 < cnt_threads_max) ? n*2 : cnt_threads_max)
+        {
+            qak::stopwatch sw;
+            qak::vector<qak::thread::RP> threads;
+            for (unsigned th_ix = 0; th_ix < n; ++th_ix)
+                threads.push_back(qak::start_thread([&cs_fn]() {
+                    for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                        cs_fn();
+                }));
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads[ix]->join();
+            std::int64_t elapsed_ns = sw.elapsed_ns();
+            cnt_total += n*cnt_per_thread;
+
+            char sz[80];
+            std::snprintf(sz, sizeof(sz), "%s, %u threads (per-thread time)", psz_what, n);
+            QAK_bench_report(sz, cnt_per_thread, elapsed_ns);
+
+            if (n == cnt_threads_max)
+                break;
+        }
+
+        return cnt_total;
+    }
+
+    QAKtest(contended, "Threads updating shared data under the lock.")
+    {
+        {
+            qak::mutex mut;
+            shared_data data;
+            std::uint64_t cnt_expected = bench_sweep("qak::mutex", [&]() {
+                qak::mutex_lock lock(mut);
+                data.update();
+            });
+            QAK_verify( data.cnt == cnt_expected );
+        }
+
+        for (queue_mutex_mode mode : { queue_mutex_mode::fifo, queue_mutex_mode::numa_cohort })
+        {
+            queue_mutex mut(mode);
+            shared_data data;
+            std::uint64_t cnt_expected = bench_sweep(
+                mode == queue_mutex_mode::fifo ? "queue_mutex, fifo" : "queue_mutex, numa_cohort",
+                [&]() {
+                    queue_mutex_lock lock(mut);
+                    data.update();
+                });
+            QAK_verify( data.cnt == cnt_expected );
+        }
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
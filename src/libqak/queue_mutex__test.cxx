@@ -0,0 +1,168 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	queue_mutex__test.cxx
+
+#include "qak/queue_mutex.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+using qak::queue_mutex;
+using qak::queue_mutex_lock;
+using qak::queue_mutex_mode;
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(basic, "Locking and try_lock from one thread, in both modes.")
+    {
+        for (queue_mutex_mode mode : { queue_mutex_mode::fifo, queue_mutex_mode::numa_cohort })
+        {
+            queue_mutex mut(mode);
+            QAK_verify( mut.mode() == mode );
+            {
+                queue_mutex_lock lock(mut);
+                QAK_verify( lock.is_locking(mut) );
+                QAK_verify( mut.is_locked_by_this_thread() );
+
+                queue_mutex_lock lock2 = std::move(lock);
+                QAK_verify( lock2.is_locking(mut) );
+                QAK_refute( lock.is_locking(mut) );
+            }
+            QAK_refute( mut.is_locked_by_this_thread() );
+            {
+                qak::optional<queue_mutex_lock> opt_lock = mut.try_lock();
+                QAK_verify( opt_lock );
+                QAK_verify( mut.is_locked_by_this_thread() );
+            }
+            QAK_verify( mut.lock().is_locking(mut) );
+            QAK_verify( mut.try_lock() );
+        }
+    }
+
+    QAKtest(non_recursive, "The holder can't lock again.")
+    {
+        queue_mutex mut;
+        queue_mutex_lock lock = mut.lock();
+
+        bool throwed = false;
+        try { mut.lock(); } catch (...) { throwed = true; }
+        QAK_verify( throwed );
+
+        throwed = false;
+        try { mut.try_lock(); } catch (...) { throwed = true; }
+        QAK_verify( throwed );
+
+        QAK_verify( mut.is_locked_by_this_thread() );
+    }
+
+    QAKtest(other_thread, "try_lock from another thread fails while it's held.")
+    {
+        for (queue_mutex_mode mode : { queue_mutex_mode::fifo, queue_mutex_mode::numa_cohort })
+        {
+            queue_mutex mut(mode);
+            {
+                queue_mutex_lock lock(mut);
+                qak::thread::RP th = qak::start_thread_uintptr([&mut]() -> std::uintptr_t {
+                    return !mut.try_lock() && !mut.is_locked_by_this_thread();
+                });
+                QAK_verify( *th->join() == 1 );
+            }
+            qak::thread::RP th = qak::start_thread_uintptr([&mut]() -> std::uintptr_t {
+                return !! mut.try_lock();
+            });
+            QAK_verify( *th->join() == 1 );
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    QAKtest(contended, "Threads incrementing a plain counter under the lock, in both modes.")
+    {
+        unsigned const cnt_threads = 6;
+        unsigned const cnt_per_thread = 20*1000;
+
+        for (queue_mutex_mode mode : { queue_mutex_mode::fifo, queue_mutex_mode::numa_cohort })
+        {
+            queue_mutex mut(mode);
+            std::uint64_t cnt = 0;
+
+            qak::vector<qak::thread::RP> threads;
+            for (unsigned th_ix = 0; th_ix < cnt_threads; ++th_ix)
+                threads.push_back(qak::start_thread([&, th_ix]() {
+                    for (unsigned ix = 0; ix < cnt_per_thread; ++ix)
+                        if ((ix + th_ix) % 4)
+                        {
+                            queue_mutex_lock lock(mut);
+                            ++cnt;
+                        }
+                        else
+                            while (true)
+                                if (qak::optional<queue_mutex_lock> opt_lock = mut.try_lock())
+                                {
+                                    ++cnt;
+                                    break;
+                                }
+                }));
+            for (auto & th : threads)
+                th->join();
+
+            QAK_verify( cnt == cnt_threads*cnt_per_thread );
+        }
+    }
+
+    QAKtest(fifo, "Waiting threads acquire in the order they arrived.")
+    {
+        unsigned const cnt_threads = 4;
+
+        queue_mutex mut;
+        qak::atomic<unsigned> cnt_arrived;
+        qak::vector<unsigned> order;
+
+        qak::vector<qak::thread::RP> threads;
+        {
+            queue_mutex_lock lock(mut);
+            for (unsigned th_ix = 0; th_ix < cnt_threads; ++th_ix)
+            {
+                threads.push_back(qak::start_thread([&, th_ix]() {
+                    ++cnt_arrived;
+                    queue_mutex_lock lock(mut);
+                    order.push_back(th_ix);
+                }));
+
+                //	Give it time to get in line before starting the next.
+                while (cnt_arrived <= th_ix)
+                    qak::this_thread::yield();
+                qak::this_thread::sleep_ms(20);
+            }
+        }
+        for (auto & th : threads)
+            th->join();
+
+        QAK_verify( order.size() == cnt_threads );
+        for (unsigned ix = 0; ix < order.size(); ++ix)
+            QAK_verify( order[ix] == ix );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
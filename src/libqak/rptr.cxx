@@ -21,31 +21,153 @@
 
 #include "qak/rptr.hxx"
 
+#include "qak/atomic.hxx"
+#include "qak/thread.hxx"
+
 namespace qak_rptr_imp_ { // ==========================================================================================|
 
-	void qak_rptr_imp__rpointee_NTB_::tpointee_inc_ref_() const QAK_noexcept
+	//	Cause instantiation of the nontemplate bases in this translation unit.
+	template struct qak_rptr_imp__rpointee_NTB_imp_<atomic_refcnt>;
+	template struct qak_rptr_imp__rpointee_NTB_imp_<single_thread_refcnt>;
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+#ifndef NDEBUG
+
+	std::uintptr_t single_thread_refcnt::current_thread_id_() QAK_noexcept
+	{
+		return static_cast<std::uintptr_t>(qak::this_thread::get_id());
+	}
+
+#endif // ndef NDEBUG
+
+	//=================================================================================================================|
+
+#if QAK_HAS_GNUC_ATOMIC_BUILTINS
+
+	struct biased_owner
 	{
-		qak_rptr_imp__rpointee_NTB_ * nonconst_this = const_cast<qak_rptr_imp__rpointee_NTB_ *>(this);
+		//	As from this_thread::get_id(), for debugging.
+		std::uintptr_t thread_id = 0;
+
+		//	Counters queued by other threads for this one to merge.
+		qak::atomic<biased_refcnt const *> p_queue_head;
+
+		//	Nonzero once the owning thread has exited. After that, whoever queues a counter merges it.
+		qak::atomic<std::uintptr_t> exited;
 
-		++nonconst_this->qak_rptr_imp__refcnt_;
+		void enqueue(biased_refcnt const * p_refcnt, void (* fn_destroy)(void const *), void const * p_obj) QAK_noexcept
+		{
+			p_refcnt->fn_destroy_ = fn_destroy;
+			p_refcnt->p_obj_ = p_obj;
+
+			biased_refcnt const * p_head = p_queue_head.load(qak::memory_order::relaxed);
+			do {
+				p_refcnt->p_queue_next_ = p_head;
+			} while (!p_queue_head.compare_exchange_weak(p_head, p_refcnt));
+		}
+
+		void merge_queued() QAK_noexcept
+		{
+			biased_refcnt const * p = p_queue_head.exchange(0, qak::memory_order::acquire);
+			while (p)
+			{
+				//	The object may be destroyed by the merge, so take what we need from it first.
+				biased_refcnt const * p_next = p->p_queue_next_;
+				void (* fn_destroy)(void const *) = p->fn_destroy_;
+				void const * p_obj = p->p_obj_;
+				if (p->merge_queued_())
+					fn_destroy(p_obj);
+				p = p_next;
+			}
+		}
+	};
+
+	bool biased_refcnt::merge_queued_() const QAK_noexcept
+	{
+		std::intptr_t b = load_biased_();
+		if (0 < b)
+		{
+			store_biased_(-1);
+			__atomic_fetch_add(&shared_, (b << flag_bits) | merged, __ATOMIC_ACQ_REL);
+		}
+
+		std::intptr_t prev = __atomic_fetch_and(&shared_, ~queued, __ATOMIC_ACQ_REL);
+		return !(prev >> flag_bits);
 	}
 
-	//-----------------------------------------------------------------------------------------------------------------|
+	__thread biased_owner * biased_this_thread_owner = 0;
+
+	//	Set once this thread's exit hook has run. Objects constructed after that have no owner, and are counted
+	//	like refcnt_atomic.
+	thread_local bool biased_this_thread_exited = false;
 
-	void qak_rptr_imp__rpointee_NTB_::tpointee_dec_ref_() const QAK_noexcept
+	biased_owner & biased_no_owner()
 	{
-		qak_rptr_imp__rpointee_NTB_ * nonconst_this = const_cast<qak_rptr_imp__rpointee_NTB_ *>(this);
+		static biased_owner * p_owner = new biased_owner;
+		return *p_owner;
+	}
 
-		std::uintptr_t n = --nonconst_this->qak_rptr_imp__refcnt_;
-		if (!n)
-			delete nonconst_this;
+	struct biased_exit_hook
+	{
+		~biased_exit_hook()
+		{
+			biased_owner * p_owner = biased_this_thread_owner;
+			biased_this_thread_owner = 0;
+			biased_this_thread_exited = true;
+
+			//	The exchange orders this thread's last writes to its counters before any other thread's merge.
+			p_owner->exited.exchange(1);
+			p_owner->merge_queued();
+		}
+	};
+
+	thread_local biased_exit_hook biased_exit;
+
+	biased_owner * biased_owner_construct()
+	{
+		biased_owner * p_owner = biased_this_thread_owner;
+		if (p_owner)
+		{
+			if (p_owner->p_queue_head.load(qak::memory_order::relaxed))
+				p_owner->merge_queued();
+		}
+		else if (biased_this_thread_exited)
+			p_owner = &biased_no_owner();
+		else
+		{
+			p_owner = new biased_owner;
+			p_owner->thread_id = static_cast<std::uintptr_t>(qak::this_thread::get_id());
+			static_cast<void>(&biased_exit); // ensures the exit hook is registered for this thread
+			biased_this_thread_owner = p_owner;
+		}
+		return p_owner;
 	}
 
+	void biased_enqueue(biased_owner * p_owner,
+		biased_refcnt const * p_refcnt, void (* fn_destroy)(void const *), void const * p_obj) QAK_noexcept
+	{
+		p_owner->enqueue(p_refcnt, fn_destroy, p_obj);
+
+		if (p_owner->exited.load())
+			p_owner->merge_queued();
+	}
+
+#endif // QAK_HAS_GNUC_ATOMIC_BUILTINS
+
 } // namespace qak_rptr_imp_
 namespace qak { //=====================================================================================================|
 
 	//=================================================================================================================|
 
+	void refcnt_biased_merge_queued() QAK_noexcept
+	{
+#if QAK_HAS_GNUC_ATOMIC_BUILTINS
+		if (qak_rptr_imp_::biased_owner * p_owner = qak_rptr_imp_::biased_this_thread_owner)
+			p_owner->merge_queued();
+#endif
+	}
+
 	//-----------------------------------------------------------------------------------------------------------------|
 
 } // namespace qak ====================================================================================================|
@@ -0,0 +1,218 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	rptr__bench.cxx
+
+#include "qak/rptr.hxx"
+
+#include "qak/host_info.hxx"
+#include "qak/stopwatch.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <utility> // std::move
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    std::uint64_t const cnt_iters = 50*1000*1000;
+
+    struct pointee_atomic : qak::rpointee_base<pointee_atomic> { int i; };
+
+    struct pointee_single_thread : qak::rpointee_base<pointee_single_thread, qak::refcnt_single_thread> { int i; };
+
+    struct pointee_final final : qak::rpointee_final<pointee_final> { int i; };
+
+    struct pointee_biased : qak::rpointee_base<pointee_biased, qak::refcnt_biased> { int i; };
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    template <class T>
+    void bench_copy_destroy(char const * psz_what)
+    {
+        typename T::RP rp(new T);
+        QAK_bench_loop(psz_what, cnt_iters,
+            typename T::RP rp2(rp);
+            QAK_bench_keep(rp2)
+        );
+        QAK_verify(rp.unique());
+    }
+
+    QAKtest(copy_destroy, "Copy construct and destroy.")
+    {
+        bench_copy_destroy<pointee_atomic>("refcnt_atomic copy+destroy");
+        bench_copy_destroy<pointee_single_thread>("refcnt_single_thread copy+destroy");
+        bench_copy_destroy<pointee_final>("rpointee_final copy+destroy");
+        bench_copy_destroy<pointee_biased>("refcnt_biased copy+destroy");
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    template <class T>
+    void bench_copy_assign(char const * psz_what)
+    {
+        typename T::RP rp_a(new T);
+        typename T::RP rp_b(new T);
+        typename T::RP rp;
+        QAK_bench_loop(psz_what, cnt_iters,
+            rp = (bench_ix & 1) ? rp_a : rp_b;
+            QAK_bench_keep(rp)
+        );
+    }
+
+    QAKtest(copy_assign, "Copy assign, alternating between two pointees.")
+    {
+        bench_copy_assign<pointee_atomic>("refcnt_atomic copy assign");
+        bench_copy_assign<pointee_single_thread>("refcnt_single_thread copy assign");
+        bench_copy_assign<pointee_final>("rpointee_final copy assign");
+        bench_copy_assign<pointee_biased>("refcnt_biased copy assign");
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    template <class T>
+    void bench_create_destroy(char const * psz_what)
+    {
+        QAK_bench_loop(psz_what, cnt_iters/10,
+            typename T::RP rp(new T);
+            QAK_bench_keep(rp)
+        );
+    }
+
+    QAKtest(create_destroy, "Allocate a new pointee and destroy it.")
+    {
+        bench_create_destroy<pointee_atomic>("refcnt_atomic new+delete");
+        bench_create_destroy<pointee_single_thread>("refcnt_single_thread new+delete");
+        bench_create_destroy<pointee_final>("rpointee_final new+delete");
+        bench_create_destroy<pointee_biased>("refcnt_biased new+delete");
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    template <class T>
+    void bench_move(char const * psz_what)
+    {
+        typename T::RP rp(new T);
+        QAK_bench_loop(psz_what, cnt_iters,
+            typename T::RP rp2(std::move(rp));
+            rp = std::move(rp2);
+            QAK_bench_keep(rp)
+        );
+        QAK_verify(rp.unique());
+    }
+
+    QAKtest(move, "Move construct and move assign back.")
+    {
+        bench_move<pointee_atomic>("refcnt_atomic move+move assign");
+        bench_move<pointee_single_thread>("refcnt_single_thread move+move assign");
+        bench_move<pointee_final>("rpointee_final move+move assign");
+        bench_move<pointee_biased>("refcnt_biased move+move assign");
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    //	Every thread copies and destroys rptrs to the same pointee, so the refcount cache line bounces.
+    template <class T>
+    void bench_copy_destroy_shared(char const * psz_what)
+    {
+        unsigned const cnt_threads = qak::host_info::cnt_threads_recommended();
+        std::uint64_t const cnt_per_thread = cnt_iters/10;
+
+        for (unsigned n = 1; n <= cnt_threads; n *= 2)
+        {
+            typename T::RP rp(new T);
+
+            qak::stopwatch sw;
+            qak::vector<qak::thread::RP> threads;
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads.push_back(qak::start_thread([&rp, cnt_per_thread]() {
+                    for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                    {
+                        typename T::RP rp2(rp);
+                        QAK_bench_keep(rp2);
+                    }
+                }));
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads[ix]->join();
+            std::int64_t elapsed_ns = sw.elapsed_ns();
+
+            char sz[80];
+            std::snprintf(sz, sizeof(sz), "%s, %u threads (per-thread time)", psz_what, n);
+            QAK_bench_report(sz, cnt_per_thread, elapsed_ns);
+
+            QAK_verify(rp.unique());
+        }
+    }
+
+    QAKtest(copy_destroy_shared, "Copy construct and destroy from many threads sharing one pointee.")
+    {
+        bench_copy_destroy_shared<pointee_atomic>("refcnt_atomic copy+destroy");
+        bench_copy_destroy_shared<pointee_biased>("refcnt_biased copy+destroy");
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    //	The constructing thread copies while other threads copy too: the owner's copies stay non-atomic.
+    template <class T>
+    void bench_owner_and_others(char const * psz_what)
+    {
+        unsigned const cnt_others = qak::host_info::cnt_threads_recommended() - 1;
+        std::uint64_t const cnt_per_thread = cnt_iters/10;
+
+        typename T::RP rp(new T);
+
+        qak::vector<qak::thread::RP> threads;
+        for (unsigned ix = 0; ix < cnt_others; ++ix)
+            threads.push_back(qak::start_thread([&rp, cnt_per_thread]() {
+                for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                {
+                    typename T::RP rp2(rp);
+                    QAK_bench_keep(rp2);
+                }
+            }));
+
+        qak::stopwatch sw;
+        for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+        {
+            typename T::RP rp2(rp);
+            QAK_bench_keep(rp2);
+        }
+        std::int64_t elapsed_ns = sw.elapsed_ns();
+
+        for (unsigned ix = 0; ix < cnt_others; ++ix)
+            threads[ix]->join();
+
+        char sz[80];
+        std::snprintf(sz, sizeof(sz), "%s, owner with %u others (owner time)", psz_what, cnt_others);
+        QAK_bench_report(sz, cnt_per_thread, elapsed_ns);
+
+        QAK_verify(rp.unique());
+    }
+
+    QAKtest(owner_and_others, "Copy construct and destroy on the constructing thread while other threads do too.")
+    {
+        bench_owner_and_others<pointee_atomic>("refcnt_atomic copy+destroy");
+        bench_owner_and_others<pointee_biased>("refcnt_biased copy+destroy");
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -24,6 +24,7 @@
 #include <utility> // std::move
 
 #include "qak/fail.hxx"
+#include "qak/thread.hxx"
 #include "qak/test_app_pre.hxx"
 #include "qak/test_macros.hxx"
 
@@ -317,5 +318,157 @@ namespace zzz { //==============================================================
         QAK_verify( !constructed_b );
     }
 
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    struct test_st_base : qak::rpointee_base<test_st_base, qak::refcnt_single_thread>
+    {
+        bool & rb_;
+
+        test_st_base(bool & rb_in) : rb_(rb_in) { rb_ = true; }
+
+        ~test_st_base() { rb_ = false; }
+    };
+
+    struct test_st_derived : test_st_base
+    {
+        test_st_derived(bool & rb_in) : test_st_base(rb_in) { }
+    };
+
+    QAKtest(refcnt_single_thread, "Single-threaded refcount policy.")
+    {
+        bool constructed = false;
+        {
+            test_st_base::RP rp_a(new test_st_derived(constructed));
+            QAK_verify( constructed );
+            QAK_verify( rp_a.unique() );
+            {
+                test_st_base::RP rp_b(rp_a);
+                QAK_verify( rp_a.use_count() == 2 );
+
+                test_st_base::RP rp_c(std::move(rp_b));
+                QAK_verify( rp_a.use_count() == 2 );
+
+                qak::rptr<test_st_derived> rp_d = qak::static_pointer_cast<test_st_derived>(rp_c);
+                QAK_verify( rp_a.use_count() == 3 );
+            }
+            QAK_verify( rp_a.unique() );
+            QAK_verify( constructed );
+        }
+        QAK_verify( !constructed );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    struct test_final final : qak::rpointee_final<test_final>
+    {
+        bool & rb_;
+
+        test_final(bool & rb_in) : rb_(rb_in) { rb_ = true; }
+
+        ~test_final() { rb_ = false; }
+    };
+
+    struct test_final_st final : qak::rpointee_final<test_final_st, qak::refcnt_single_thread>
+    {
+        int i;
+    };
+
+    QAKtest(rpointee_final, "Non-virtual rpointee_final.")
+    {
+        //	Just the refcount word.
+        QAK_verify( sizeof(qak::rpointee_final<test_final>) == sizeof(std::intptr_t) );
+        QAK_refute( std::is_polymorphic<test_final>::value );
+
+        bool constructed = false;
+        {
+            test_final::RP rp_a(new test_final(constructed));
+            QAK_verify( constructed );
+            QAK_verify( rp_a.unique() );
+            {
+                test_final::RP rp_b(rp_a);
+                QAK_verify( rp_a.use_count() == 2 );
+
+                test_final::RPC rpc(std::move(rp_b));
+                QAK_verify( rp_a.use_count() == 2 );
+                QAK_verify( rpc->rb_ );
+            }
+            QAK_verify( rp_a.unique() );
+        }
+        QAK_verify( !constructed );
+
+        test_final_st::RP rp_st(new test_final_st);
+        test_final_st::RP rp_st2 = rp_st;
+        QAK_verify( rp_st.use_count() == 2 );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    qak::atomic<int> cnt_biased_live;
+
+    struct test_biased : qak::rpointee_base<test_biased, qak::refcnt_biased>
+    {
+        test_biased() { ++cnt_biased_live; }
+        ~test_biased() { --cnt_biased_live; }
+    };
+
+    struct test_biased_final final : qak::rpointee_final<test_biased_final, qak::refcnt_biased>
+    {
+        test_biased_final() { ++cnt_biased_live; }
+        ~test_biased_final() { --cnt_biased_live; }
+    };
+
+    QAKtest(refcnt_biased, "Biased refcount policy.")
+    {
+        //	Owner only.
+        {
+            test_biased::RP rp_a(new test_biased);
+            QAK_verify( rp_a.unique() );
+            test_biased::RP rp_b(rp_a);
+            QAK_verify( rp_a.use_count() == 2 );
+        }
+        QAK_verify( cnt_biased_live == 0 );
+
+        //	Shared with another thread, which releases its own references.
+        {
+            test_biased::RP rp_a(new test_biased);
+            qak::thread::RP th = qak::start_thread([&rp_a]() {
+                for (int n = 0; n < 1000; ++n)
+                {
+                    test_biased::RP rp_b(rp_a);
+                    test_biased::RP rp_c(rp_b);
+                }
+            });
+            QAK_verify( th->join() );
+            QAK_verify( rp_a.unique() );
+        }
+        QAK_verify( cnt_biased_live == 0 );
+
+        //	The last reference made by the owner is released on another thread, so the owner has to merge.
+        {
+            test_biased_final::RP rp_a(new test_biased_final);
+            qak::thread::RP th = qak::start_thread([&rp_a]() { rp_a.reset(); });
+            QAK_verify( th->join() );
+#if QAK_HAS_GNUC_ATOMIC_BUILTINS
+            QAK_verify( cnt_biased_live == 1 );
+#endif
+
+            qak::refcnt_biased_merge_queued();
+            QAK_verify( cnt_biased_live == 0 );
+        }
+
+        //	Constructed on a thread that exits while others still hold references.
+        {
+            test_biased::RP rp_a;
+            qak::thread::RP th = qak::start_thread([&rp_a]() {
+                rp_a.reset(new test_biased);
+                test_biased::RP rp_b(rp_a);
+            });
+            QAK_verify( th->join() );
+            QAK_verify( rp_a.use_count() == 1 );
+            rp_a.reset();
+            QAK_verify( cnt_biased_live == 0 );
+        }
+    }
+
 } // namespace zzz ====================================================================================================|
 #include "qak/test_app_post.hxx"
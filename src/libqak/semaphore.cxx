@@ -0,0 +1,66 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//
+//	semaphore.cxx
+
+#include "qak/semaphore.hxx"
+
+#include "qak/imp/spin_wait.hxx"
+#include "qak/now.hxx"
+
+namespace qak { //=====================================================================================================|
+
+	bool semaphore::try_acquire_for_ns(std::int64_t max_wait_ns)
+	{
+		if (try_acquire())
+			return true;
+
+		std::uint64_t now_ns = read_time_source(time_source::wallclock_ns);
+		return acquire_contended_(now_ns + static_cast<std::uint64_t>(0 < max_wait_ns ? max_wait_ns : 0));
+	}
+
+	bool semaphore::acquire_contended_(std::uint64_t deadline_ns) QAK_noexcept
+	{
+		if (spin_until(100, [this]() { return cnt_.load(memory_order::relaxed) != 0 && try_acquire(); }))
+			return true;
+
+		cnt_waiters_.fetch_add(1, memory_order::seq_cst);
+
+		bool acquired = false;
+		while (!(acquired = try_acquire()))
+		{
+			std::uint32_t cnt = cnt_.load(memory_order::seq_cst);
+			if (cnt)
+				continue;
+
+			if (deadline_ns == no_deadline)
+				cnt_.wait(0, memory_order::relaxed);
+			else if (!cnt_.wait_until(0, deadline_ns, memory_order::relaxed))
+			{
+				acquired = try_acquire();
+				break;
+			}
+		}
+
+		cnt_waiters_.fetch_sub(1, memory_order::relaxed);
+		return acquired;
+	}
+
+} // namespace qak ====================================================================================================|
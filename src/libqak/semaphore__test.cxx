@@ -0,0 +1,118 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	semaphore__test.cxx
+
+#include "qak/semaphore.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/now.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+using qak::semaphore;
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(basic, "Counting permits from one thread.")
+    {
+        semaphore sem(2);
+        QAK_verify( sem.cnt_available() == 2 );
+        QAK_verify( sem.try_acquire() );
+        sem.acquire();
+        QAK_refute( sem.try_acquire() );
+        QAK_verify( sem.cnt_available() == 0 );
+
+        sem.release(3);
+        QAK_verify( sem.cnt_available() == 3 );
+        QAK_verify( sem.try_acquire_for_ns(0) );
+        QAK_verify( sem.try_acquire_until_ns(0) );
+        sem.acquire();
+        QAK_refute( sem.try_acquire() );
+    }
+
+    QAKtest(timeout, "A timed acquire gives up when no permit comes.")
+    {
+        semaphore sem;
+        std::uint64_t t0_ns = qak::read_time_source(qak::time_source::wallclock_ns);
+        QAK_refute( sem.try_acquire_for_ns(20*1000*1000) );
+        std::uint64_t elapsed_ns = qak::read_time_source(qak::time_source::wallclock_ns) - t0_ns;
+        QAK_verify( 20*1000*1000 <= elapsed_ns );
+    }
+
+    QAKtest(other_thread, "A release on one thread wakes an acquire on another.")
+    {
+        semaphore sem_req, sem_resp;
+        qak::thread::RP th = qak::start_thread_uintptr([&]() -> std::uintptr_t {
+            std::uintptr_t cnt = 0;
+            for (unsigned ix = 0; ix < 1000; ++ix)
+            {
+                sem_req.acquire();
+                ++cnt;
+                sem_resp.release();
+            }
+            return cnt;
+        });
+
+        for (unsigned ix = 0; ix < 1000; ++ix)
+        {
+            sem_req.release();
+            sem_resp.acquire();
+        }
+        QAK_verify( *th->join() == 1000 );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    QAKtest(bounded_concurrency, "No more threads than permits are ever inside at once.")
+    {
+        unsigned const cnt_permits = 3;
+        unsigned const cnt_threads = 8;
+        unsigned const cnt_per_thread = 20*1000;
+
+        semaphore sem(cnt_permits);
+        qak::atomic<unsigned> cnt_inside;
+        qak::atomic<unsigned> cnt_inside_max;
+
+        qak::vector<qak::thread::RP> threads;
+        for (unsigned th_ix = 0; th_ix < cnt_threads; ++th_ix)
+            threads.push_back(qak::start_thread([&]() {
+                for (unsigned ix = 0; ix < cnt_per_thread; ++ix)
+                {
+                    sem.acquire();
+                    unsigned n = ++cnt_inside;
+                    unsigned m = cnt_inside_max;
+                    while (m < n && !cnt_inside_max.compare_exchange_weak(m, n))
+                        ;
+                    --cnt_inside;
+                    sem.release();
+                }
+            }));
+        for (auto & th : threads)
+            th->join();
+
+        QAK_verify( cnt_inside_max <= cnt_permits );
+        QAK_verify( sem.cnt_available() == cnt_permits );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,126 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	seqlock__test.cxx
+
+#include "qak/seqlock.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+using qak::seqlock;
+
+namespace zzz { //=====================================================================================================|
+
+    //	Several words, so a torn copy would show.
+    struct quad
+    {
+        std::uint64_t a, b, c, d;
+    };
+
+    //	Not a multiple of the word size.
+    struct odd_size
+    {
+        char sz[11];
+    };
+
+    QAKtest(basic, "Load, store, and update from one thread.")
+    {
+        seqlock<quad> sl;
+        quad q = sl.load();
+        QAK_verify( q.a == 0 && q.b == 0 && q.c == 0 && q.d == 0 );
+
+        sl.store(quad{ 1, 2, 3, 4 });
+        q = sl.load();
+        QAK_verify( q.a == 1 && q.b == 2 && q.c == 3 && q.d == 4 );
+
+        sl.update([](quad & q) { q.d += 10; });
+        QAK_verify( sl.load().d == 14 );
+
+        //	A throwing update leaves the value alone, and the lock usable.
+        bool throwed = false;
+        try { sl.update([](quad & q) { q.a = 99; throw 0; }); } catch (...) { throwed = true; }
+        QAK_verify( throwed );
+        QAK_verify( sl.load().a == 1 );
+        sl.store(quad{ 5, 6, 7, 8 });
+        QAK_verify( sl.load().a == 5 );
+
+        seqlock<odd_size> sl2(odd_size{ "0123456789" });
+        QAK_verify( sl2.load().sz[9] == '9' );
+
+        seqlock<unsigned> sl3(7u);
+        QAK_verify( sl3.load() == 7 );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    QAKtest(no_torn_reads, "Readers racing writers always see a value some writer stored.")
+    {
+        seqlock<quad> sl;
+        qak::atomic<bool> stop(false);
+
+        unsigned const cnt_readers = 3;
+        unsigned const cnt_writers = 2;
+        std::uint64_t const cnt_per_writer = 100*1000;
+
+        qak::vector<qak::thread::RP> readers;
+        for (unsigned th_ix = 0; th_ix < cnt_readers; ++th_ix)
+            readers.push_back(qak::start_thread_uintptr([&]() -> std::uintptr_t {
+                std::uintptr_t cnt_torn = 0;
+                while (!stop)
+                {
+                    quad q = sl.load();
+                    if (q.b != q.a + 1 || q.c != q.a + 2 || q.d != q.a + 3)
+                        if (q.a || q.b || q.c || q.d)
+                            ++cnt_torn;
+                }
+                return cnt_torn;
+            }));
+
+        //	The writers use update, so their increments of a are serialized and none are lost.
+        qak::vector<qak::thread::RP> writers;
+        for (unsigned th_ix = 0; th_ix < cnt_writers; ++th_ix)
+            writers.push_back(qak::start_thread([&]() {
+                for (std::uint64_t ix = 0; ix < cnt_per_writer; ++ix)
+                    sl.update([](quad & q) {
+                        ++q.a;
+                        q.b = q.a + 1;
+                        q.c = q.a + 2;
+                        q.d = q.a + 3;
+                    });
+            }));
+
+        for (auto & th : writers)
+            th->join();
+        stop = true;
+
+        std::uintptr_t cnt_torn = 0;
+        for (auto & th : readers)
+            cnt_torn += *th->join();
+        QAK_verify( cnt_torn == 0 );
+
+        QAK_verify( sl.load().a == cnt_writers*cnt_per_writer );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
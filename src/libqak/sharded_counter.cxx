@@ -0,0 +1,77 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	sharded_counter.cxx
+
+#include "qak/sharded_counter.hxx"
+
+#include "qak/host_info.hxx"
+
+namespace qak_sharded_counter_imp_ { //================================================================================|
+
+	thread_local unsigned tls_shard_ix_plus_1 = 0;
+
+	//	Threads take shard numbers in turn, so up to cnt_shards threads each have a shard to themselves. Every
+	//	counter masks the same number down to its own count of shards.
+	qak::atomic<unsigned> next_shard_ix;
+
+	unsigned assign_shard_ix()
+	{
+		unsigned ix = next_shard_ix.fetch_add(1, qak::memory_order::relaxed);
+		tls_shard_ix_plus_1 = ix + 1;
+		return ix;
+	}
+
+} // namespace qak_sharded_counter_imp_
+namespace qak { //=====================================================================================================|
+
+	sharded_counter::sharded_counter() :
+		shard_ix_mask_(0),
+		p_shards_(0)
+	{
+		unsigned cnt = 1;
+		while (cnt < host_info::cnt_cpus_configured())
+			cnt *= 2;
+
+		shard_ix_mask_ = cnt - 1;
+		p_shards_ = new shard[cnt];
+	}
+
+	sharded_counter::~sharded_counter()
+	{
+		delete [] p_shards_;
+	}
+
+	std::uint64_t sharded_counter::sum() const QAK_noexcept
+	{
+		std::uint64_t total = 0;
+		for (unsigned ix = 0; ix <= shard_ix_mask_; ++ix)
+			total += p_shards_[ix]->load(memory_order::relaxed);
+		return total;
+	}
+
+	std::uint64_t sharded_counter::drain() QAK_noexcept
+	{
+		std::uint64_t total = 0;
+		for (unsigned ix = 0; ix <= shard_ix_mask_; ++ix)
+			total += p_shards_[ix]->exchange(0, memory_order::relaxed);
+		return total;
+	}
+
+} // namespace qak ====================================================================================================|
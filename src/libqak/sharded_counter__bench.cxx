@@ -0,0 +1,97 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	sharded_counter__bench.cxx
+
+
+#include "qak/sharded_counter.hxx"
+
+#include "qak/host_info.hxx"
+#include "qak/padded.hxx"
+#include "qak/stopwatch.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdio> // std::snprintf
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    std::uint64_t const cnt_per_thread = 10*1000*1000;
+
+    //	Runs cnt_per_thread increments on each of 1, 2, 4, ... cnt_cpus_available() threads. inc_fn is passed the
+    //	thread's number. Returns the total number of increments.
+    template <class Fn>
+    std::uint64_t bench_scaling(char const * psz_what, Fn inc_fn)
+    {
+        unsigned const cnt_cpus = qak::host_info::cnt_cpus_available();
+        std::uint64_t cnt_total = 0;
+
+        for (unsigned n = 1; ; n = (n*2 < cnt_cpus) ? n*2 : cnt_cpus)
+        {
+            qak::stopwatch sw;
+            qak::vector<qak::thread::RP> threads;
+            for (unsigned th_ix = 0; th_ix < n; ++th_ix)
+                threads.push_back(qak::start_thread([&inc_fn, th_ix]() {
+                    for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                        inc_fn(th_ix);
+                }));
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads[ix]->join();
+            std::int64_t elapsed_ns = sw.elapsed_ns();
+            cnt_total += n*cnt_per_thread;
+
+            char sz[80];
+            std::snprintf(sz, sizeof(sz), "%s, %u threads (per-thread time)", psz_what, n);
+            QAK_bench_report(sz, cnt_per_thread, elapsed_ns);
+
+            if (n == cnt_cpus)
+                break;
+        }
+
+        return cnt_total;
+    }
+
+    QAKtest(scaling, "Statistics counter increments from many threads.")
+    {
+        //	What callers do today.
+        qak::atomic<std::uint64_t> a;
+        std::uint64_t cnt = bench_scaling("shared qak::atomic", [&a](unsigned) {
+            a.fetch_add(1, qak::memory_order::relaxed);
+        });
+        QAK_verify( a.load() == cnt );
+
+        qak::sharded_counter ctr;
+        cnt = bench_scaling("sharded_counter", [&ctr](unsigned) {
+            ++ctr;
+        });
+        QAK_verify( ctr.sum() == cnt );
+
+        //	The floor: each thread has its own padded counter and nobody reads it.
+        qak::vector<qak::padded<qak::atomic<std::uint64_t>>> own(qak::host_info::cnt_cpus_available());
+        bench_scaling("padded per-thread atomic", [&own](unsigned th_ix) {
+            own[th_ix]->fetch_add(1, qak::memory_order::relaxed);
+        });
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,94 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	sharded_counter__test.cxx
+
+
+#include "qak/sharded_counter.hxx"
+
+#include "qak/padded.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdint> // std::uintptr_t
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(padded, "padded<T> puts each element of an array on its own cache line.")
+    {
+        static_assert(sizeof(qak::padded<char>) == qak::cache_line_size, "");
+        static_assert(alignof(qak::padded<char>) == qak::cache_line_size, "");
+        static_assert(sizeof(qak::padded<char[qak::cache_line_size + 1]>) == 2*qak::cache_line_size, "");
+
+        qak::padded<int> a[2];
+        QAK_verify( reinterpret_cast<std::uintptr_t>(&a[1].value) % qak::cache_line_size == 0 );
+        QAK_verify( *a[0] == 0 );
+
+        qak::padded<qak::atomic<int>> * p = new qak::padded<qak::atomic<int>>(3);
+        QAK_verify( reinterpret_cast<std::uintptr_t>(p) % qak::cache_line_size == 0 );
+        QAK_verify( (*p)->load() == 3 );
+        delete p;
+    }
+
+    QAKtest(basic, "add, sum, and drain.")
+    {
+        qak::sharded_counter ctr;
+        QAK_verify( 1 <= ctr.cnt_shards() );
+        QAK_verify( (ctr.cnt_shards() & (ctr.cnt_shards() - 1)) == 0 );
+        QAK_verify( ctr.sum() == 0 );
+
+        ++ctr;
+        ctr += 10;
+        ctr.add(100);
+        QAK_verify( ctr.sum() == 111 );
+
+        QAK_verify( ctr.drain() == 111 );
+        QAK_verify( ctr.sum() == 0 );
+    }
+
+    QAKtest(threads, "The sum is exact once the adding threads have been joined.")
+    {
+        unsigned const cnt_threads = 8;
+        std::uint64_t const cnt_per_thread = 100*1000;
+
+        qak::sharded_counter ctr;
+        std::uint64_t drained = 0;
+
+        qak::vector<qak::thread::RP> threads;
+        for (unsigned n = 0; n < cnt_threads; ++n)
+            threads.push_back(qak::start_thread([&ctr]() {
+                for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                    ++ctr;
+            }));
+
+        //	Drains while the threads are running lose nothing.
+        for (int n = 0; n < 10; ++n)
+            drained += ctr.drain();
+
+        for (auto & th : threads)
+            th->join();
+
+        QAK_verify( drained + ctr.sum() == cnt_threads*cnt_per_thread );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,174 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	shared_mutex.cxx
+
+#include "qak/shared_mutex.hxx"
+
+#include "qak/fail.hxx"
+#include "qak/host_info.hxx"
+
+#include <cassert>
+#include <utility> // std::move
+
+namespace qak { //=====================================================================================================|
+
+	shared_mutex::shared_mutex() :
+		writer_mut_("qak::shared_mutex writers"),
+		writer_state_(0),
+		shard_ix_mask_(0),
+		p_shards_(0)
+	{
+		unsigned cnt = 1;
+		while (cnt < host_info::cnt_cpus_configured())
+			cnt *= 2;
+
+		shard_ix_mask_ = cnt - 1;
+		p_shards_ = new shard[cnt];
+	}
+
+	shared_mutex::~shared_mutex()
+	{
+		//	There is no conceivable circumstance in which it's valid to destroy the mutex while any lock is held.
+		assert(!writer_state_.load(memory_order::relaxed));
+#ifndef NDEBUG
+		for (unsigned ix = 0; ix <= shard_ix_mask_; ++ix)
+			assert(!p_shards_[ix]->load(memory_order::relaxed));
+#endif
+
+		delete [] p_shards_;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	shared_mutex::unique_lock_type shared_mutex::lock()
+	{
+		mutex_lock writer_lock(writer_mut_);
+		acquire_exclusive_();
+		return unique_lock(unique_lock::private_construct_tag(), std::move(writer_lock), this);
+	}
+
+	optional<shared_mutex::unique_lock_type> shared_mutex::try_lock()
+	{
+		optional<mutex_lock> opt_writer_lock = writer_mut_.try_lock();
+		if (!opt_writer_lock || !try_acquire_exclusive_())
+			return optional<unique_lock>();
+
+		return unique_lock(unique_lock::private_construct_tag(), std::move(*opt_writer_lock), this);
+	}
+
+	bool shared_mutex::is_locked_by_this_thread() const
+	{
+		return writer_mut_.is_locked_by_this_thread();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	void shared_mutex::acquire_shared_contended_(shard & sh)
+	{
+		if (writer_mut_.is_locked_by_this_thread())
+		{
+			release_shared_(sh);
+			fail(); //	Already owns the mutex exclusively.
+		}
+
+		do
+		{
+			//	Step aside for the writer, and wait until it's gone.
+			release_shared_(sh);
+			writer_state_.wait(1, memory_order::seq_cst);
+		}
+		while (!enter_shared_(sh));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	void shared_mutex::acquire_exclusive_() QAK_noexcept
+	{
+		assert(writer_mut_.is_locked_by_this_thread());
+
+		//	From here on, arriving readers step aside. Wait for those already in to leave.
+		writer_state_.store(1, memory_order::seq_cst);
+
+		for (unsigned ix = 0; ix <= shard_ix_mask_; ++ix)
+		{
+			shard & sh = p_shards_[ix];
+			while (std::uint32_t cnt = sh->load(memory_order::seq_cst))
+				sh->wait(cnt, memory_order::seq_cst);
+		}
+	}
+
+	bool shared_mutex::try_acquire_exclusive_() QAK_noexcept
+	{
+		assert(writer_mut_.is_locked_by_this_thread());
+
+		writer_state_.store(1, memory_order::seq_cst);
+
+		for (unsigned ix = 0; ix <= shard_ix_mask_; ++ix)
+			if (p_shards_[ix]->load(memory_order::seq_cst))
+			{
+				//	Readers that saw the flag meanwhile may be waiting for it to clear.
+				release_exclusive_();
+				return false;
+			}
+
+		return true;
+	}
+
+	void shared_mutex::release_exclusive_() QAK_noexcept
+	{
+		assert(writer_mut_.is_locked_by_this_thread());
+
+		writer_state_.store(0, memory_order::seq_cst);
+		writer_state_.notify_all();
+	}
+
+	//=================================================================================================================|
+
+	unique_lock::unique_lock(shared_mutex & m) :
+		writer_lock_(m.writer_mut_),
+		p_m_(&m)
+	{
+		m.acquire_exclusive_();
+	}
+
+	unique_lock::unique_lock(
+		private_construct_tag const &,
+		mutex_lock && writer_lock,
+		shared_mutex * p_m
+	) :
+		writer_lock_(std::move(writer_lock)),
+		p_m_(p_m)
+	{ }
+
+	unique_lock::unique_lock(unique_lock && that) :
+		writer_lock_(std::move(that.writer_lock_)),
+		p_m_(that.p_m_)
+	{
+		that.p_m_ = 0;
+	}
+
+	unique_lock::~unique_lock()
+	{
+		//	writer_lock_ releases the writer mutex after this.
+		if (p_m_)
+			p_m_->release_exclusive_();
+	}
+
+} // namespace qak ====================================================================================================|
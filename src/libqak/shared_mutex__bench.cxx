@@ -0,0 +1,124 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	shared_mutex__bench.cxx
+
+#include "qak/shared_mutex.hxx"
+
+#include "qak/host_info.hxx"
+#include "qak/mutex.hxx"
+#include "qak/stopwatch.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdio> // std::snprintf
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    std::uint64_t const cnt_per_thread = 1000*1000;
+
+    //	The protected data. Readers sum it, writers bump one element.
+    struct data
+    {
+        std::uint64_t vals[8] = { };
+
+        std::uint64_t read() const
+        {
+            std::uint64_t sum = 0;
+            for (auto v : vals)
+                sum += v;
+            return sum;
+        }
+
+        void write(std::uint64_t ix) { ++vals[ix % 8]; }
+    };
+
+    //	Runs cnt_per_thread operations on each of 1, 2, 4, ... cnt_cpus_available() threads, one in every
+    //	write_every of which is a write (none if zero). Returns the total number of writes.
+    template <class ReadFn, class WriteFn>
+    std::uint64_t bench_scaling(char const * psz_what, unsigned write_every, ReadFn read_fn, WriteFn write_fn)
+    {
+        unsigned const cnt_cpus = qak::host_info::cnt_cpus_available();
+        std::uint64_t cnt_writes = 0;
+
+        for (unsigned n = 1; ; n = (n*2 < cnt_cpus) ? n*2 : cnt_cpus)
+        {
+            qak::stopwatch sw;
+            qak::vector<qak::thread::RP> threads;
+            for (unsigned th_ix = 0; th_ix < n; ++th_ix)
+                threads.push_back(qak::start_thread([&]() {
+                    std::uint64_t sum = 0;
+                    for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                        if (write_every && ix % write_every == 0)
+                            write_fn(ix);
+                        else
+                            sum += read_fn();
+                    QAK_bench_keep(sum);
+                }));
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads[ix]->join();
+            std::int64_t elapsed_ns = sw.elapsed_ns();
+            if (write_every)
+                cnt_writes += n*((cnt_per_thread + write_every - 1)/write_every);
+
+            char sz[80];
+            std::snprintf(sz, sizeof(sz), "%s, %u threads (per-thread time)", psz_what, n);
+            QAK_bench_report(sz, cnt_per_thread, elapsed_ns);
+
+            if (n == cnt_cpus)
+                break;
+        }
+
+        return cnt_writes;
+    }
+
+    void bench_ratio(char const * psz_ratio, unsigned write_every)
+    {
+        char sz[80];
+        {
+            qak::mutex mut;
+            data d;
+            std::snprintf(sz, sizeof(sz), "mutex, %s", psz_ratio);
+            std::uint64_t cnt_writes = bench_scaling(sz, write_every,
+                [&]() { qak::mutex_lock lock(mut); return d.read(); },
+                [&](std::uint64_t ix) { qak::mutex_lock lock(mut); d.write(ix); } );
+            QAK_verify( d.read() == cnt_writes );
+        }
+        {
+            qak::shared_mutex mut;
+            data d;
+            std::snprintf(sz, sizeof(sz), "shared_mutex, %s", psz_ratio);
+            std::uint64_t cnt_writes = bench_scaling(sz, write_every,
+                [&]() { qak::shared_lock lock(mut); return d.read(); },
+                [&](std::uint64_t ix) { qak::unique_lock lock(mut); d.write(ix); } );
+            QAK_verify( d.read() == cnt_writes );
+        }
+    }
+
+    QAKtest(read_only,     "No writes.")              { bench_ratio("reads only", 0); }
+    QAKtest(write_1_1000,  "One write per 1000 ops.") { bench_ratio("1 in 1000 writes", 1000); }
+    QAKtest(write_1_100,   "One write per 100 ops.")  { bench_ratio("1 in 100 writes", 100); }
+    QAKtest(write_1_10,    "One write per 10 ops.")   { bench_ratio("1 in 10 writes", 10); }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,175 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	shared_mutex__test.cxx
+
+#include "qak/shared_mutex.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+using qak::shared_mutex;
+using qak::shared_lock;
+using qak::unique_lock;
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(basic, "Exclusive and shared locking from one thread.")
+    {
+        shared_mutex mut;
+        {
+            unique_lock lock(mut);
+            QAK_verify( lock.is_locking(mut) );
+            QAK_verify( mut.is_locked_by_this_thread() );
+        }
+        QAK_refute( mut.is_locked_by_this_thread() );
+        {
+            shared_lock lock1(mut);
+            QAK_verify( lock1.is_locking(mut) );
+            QAK_refute( mut.is_locked_by_this_thread() );
+
+            shared_lock lock2 = std::move(lock1);
+            QAK_verify( lock2.is_locking(mut) );
+            QAK_refute( lock1.is_locking(mut) );
+        }
+        {
+            qak::optional<unique_lock> opt_lock = mut.try_lock();
+            QAK_verify( opt_lock );
+            QAK_verify( mut.is_locked_by_this_thread() );
+        }
+        {
+            qak::optional<shared_lock> opt_lock = mut.try_lock_shared();
+            QAK_verify( opt_lock );
+        }
+        QAK_verify( mut.lock().is_locking(mut) );
+        QAK_verify( mut.lock_shared().is_locking(mut) );
+    }
+
+    QAKtest(non_recursive, "The exclusive holder can't lock again.")
+    {
+        shared_mutex mut;
+        unique_lock lock = mut.lock();
+
+        bool throwed = false;
+        try { mut.lock(); } catch (...) { throwed = true; }
+        QAK_verify( throwed );
+
+        throwed = false;
+        try { mut.try_lock(); } catch (...) { throwed = true; }
+        QAK_verify( throwed );
+
+        throwed = false;
+        try { mut.lock_shared(); } catch (...) { throwed = true; }
+        QAK_verify( throwed );
+
+        QAK_verify( mut.is_locked_by_this_thread() );
+    }
+
+    QAKtest(other_thread, "Shared locks coexist, exclusive ones don't.")
+    {
+        shared_mutex mut;
+        {
+            shared_lock lock(mut);
+            qak::thread::RP th = qak::start_thread_uintptr([&mut]() -> std::uintptr_t {
+                return mut.try_lock_shared() && !mut.try_lock();
+            });
+            QAK_verify( *th->join() == 1 );
+        }
+        {
+            unique_lock lock(mut);
+            qak::thread::RP th = qak::start_thread_uintptr([&mut]() -> std::uintptr_t {
+                return !mut.try_lock_shared() && !mut.try_lock() && !mut.is_locked_by_this_thread();
+            });
+            QAK_verify( *th->join() == 1 );
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    QAKtest(readers_writers, "Readers never see a writer's update half done.")
+    {
+        shared_mutex mut;
+        std::uint64_t a = 0, b = 0;
+        qak::atomic<std::uint64_t> cnt_torn;
+
+        unsigned const cnt_threads = 6;
+        unsigned const cnt_per_thread = 50*1000;
+
+        qak::vector<qak::thread::RP> threads;
+        for (unsigned th_ix = 0; th_ix < cnt_threads; ++th_ix)
+            threads.push_back(qak::start_thread([&, th_ix]() {
+                for (unsigned ix = 0; ix < cnt_per_thread; ++ix)
+                    if (th_ix % 3 == 0 && ix % 8 == 0)
+                    {
+                        unique_lock lock(mut);
+                        ++a;
+                        ++b;
+                    }
+                    else
+                    {
+                        shared_lock lock(mut);
+                        if (a != b)
+                            ++cnt_torn;
+                    }
+            }));
+        for (auto & th : threads)
+            th->join();
+
+        QAK_verify( cnt_torn == 0 );
+        QAK_verify( a == 2*(cnt_per_thread/8) );
+        QAK_verify( a == b );
+    }
+
+    QAKtest(writer_preference, "A writer gets in while readers keep overlapping.")
+    {
+        shared_mutex mut;
+        qak::atomic<bool> stop(false);
+        qak::atomic<unsigned> cnt_readers_started;
+
+        //	Between them, the readers always have the lock held shared.
+        unsigned const cnt_readers = 4;
+        qak::vector<qak::thread::RP> threads;
+        for (unsigned th_ix = 0; th_ix < cnt_readers; ++th_ix)
+            threads.push_back(qak::start_thread([&]() {
+                ++cnt_readers_started;
+                while (!stop)
+                {
+                    shared_lock lock(mut);
+                    qak::this_thread::yield();
+                }
+            }));
+        while (cnt_readers_started < cnt_readers)
+            qak::this_thread::yield();
+
+        {
+            unique_lock lock(mut);
+            QAK_verify( mut.is_locked_by_this_thread() );
+            stop = true;
+        }
+
+        for (auto & th : threads)
+            th->join();
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,95 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2012, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	shuffle__test.cxx
+
+#include "qak/shuffle.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+	using qak::vector;
+
+	QAKtest(shuffle_empty, "Shuffle of empty and single-element vectors.")
+	{
+		qak::prng64 prng;
+
+		vector<int> v;
+		qak::shuffle(v, prng);
+		QAK_verify(v.empty());
+
+		v.push_back(7);
+		qak::shuffle(v, prng);
+		QAK_verify_equal(v.size(), 1);
+		QAK_verify_equal(v[0], 7);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	QAKtest(shuffle_is_permutation, "Shuffle produces a permutation of the original elements.")
+	{
+		qak::prng64 prng;
+
+		unsigned const n = 1000;
+		vector<unsigned> v;
+		for (unsigned ix = 0; ix < n; ++ix)
+			v.push_back(ix);
+
+		qak::shuffle(v, prng);
+
+		vector<bool> seen(n, false);
+		unsigned cnt_fixed = 0;
+		for (unsigned ix = 0; ix < n; ++ix)
+		{
+			QAK_verify(v[ix] < n);
+			QAK_refute(seen[v[ix]]);
+			seen[v[ix]] = true;
+			cnt_fixed += v[ix] == ix;
+		}
+
+		//	The expected count of fixed points is 1.
+		QAK_verify(cnt_fixed < 10);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	QAKtest(shuffle_distribution, "Each element is equally likely to land in each position.")
+	{
+		qak::prng64 prng;
+
+		unsigned const n = 5;
+		unsigned const cnt_iters = 10*1000;
+		unsigned cnts[n][n] = { { 0 } };
+		for (unsigned iter = 0; iter < cnt_iters; ++iter)
+		{
+			int a[n] = { 0, 1, 2, 3, 4 };
+			qak::shuffle(a, a + n, prng);
+			for (unsigned ix = 0; ix < n; ++ix)
+				++cnts[a[ix]][ix];
+		}
+
+		for (unsigned val = 0; val < n; ++val)
+			for (unsigned ix = 0; ix < n; ++ix)
+				QAK_verify(  cnt_iters/n*2/3 < cnts[val][ix] && cnts[val][ix] < cnt_iters/n*4/3  );
+	}
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,71 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//
+//	spin_mutex.cxx
+
+#include "qak/spin_mutex.hxx"
+
+#include "qak/imp/spin_wait.hxx"
+#include "qak/thread.hxx"
+
+namespace qak_spin_mutex_imp_ { //=====================================================================================|
+
+	//	Pauses per round of backoff double up to this.
+	unsigned const max_pauses_per_spin = 64;
+
+} // namespace qak_spin_mutex_imp_
+namespace qak { //=====================================================================================================|
+
+	using namespace qak_spin_mutex_imp_;
+
+	void spin_mutex::acquire_contended_() QAK_noexcept
+	{
+		bool const never_parks = cnt_spins_ == never_park;
+		bool const spins = spinning_can_help();
+
+		unsigned cnt_pauses = 1;
+		for (unsigned n = 0; never_parks || (spins && n < cnt_spins_); ++n)
+		{
+			//	Once backoff is at its maximum, a thread that never parks gives up the CPU between polls instead,
+			//	in case the holder is waiting for it.
+			if (spins && (cnt_pauses < max_pauses_per_spin || !never_parks))
+			{
+				for (unsigned ix = 0; ix < cnt_pauses; ++ix)
+					spin_pause();
+				if (cnt_pauses < max_pauses_per_spin)
+					cnt_pauses *= 2;
+			}
+			else
+				this_thread::yield();
+
+			std::uint32_t st = state_.load(memory_order::relaxed);
+			if (st == state_locked_waiters)
+				break; // others are parked already, get in line
+
+			if (st == state_unlocked && try_acquire_())
+				return;
+		}
+
+		//	As with mutex, marking the state obliges the next thread to release it to wake one of us.
+		while (state_.exchange(state_locked_waiters, memory_order::acquire) != state_unlocked)
+			state_.wait(state_locked_waiters, memory_order::relaxed);
+	}
+
+} // namespace qak ====================================================================================================|
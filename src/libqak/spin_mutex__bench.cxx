@@ -0,0 +1,200 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	spin_mutex__bench.cxx
+
+#include "qak/spin_mutex.hxx"
+
+#include "qak/host_info.hxx"
+#include "qak/mutex.hxx"
+#include "qak/now.hxx"
+#include "qak/stopwatch.hxx"
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include <cstdio> // std::snprintf
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+#include "qak/bench_macros.hxx"
+
+using qak::spin_mutex;
+using qak::spin_mutex_lock;
+
+namespace zzz { //=====================================================================================================|
+
+    //	A chain of dependent arithmetic, for a critical section of a predictable length.
+    inline std::uint64_t burn(unsigned cnt_iters, std::uint64_t x)
+    {
+        for (unsigned ix = 0; ix < cnt_iters; ++ix)
+        {
+            x = x*6364136223846793005u + 1;
+#if QAK_INLINEASM_GCC
+            __asm__ ("" : "+r"(x));
+#endif
+        }
+        return x;
+    }
+
+    //	Iterations of burn per 1000 cycles, going by the cycle counter. Assumes 4 cycles each if there isn't one.
+    unsigned burn_iters_per_kcycle()
+    {
+        unsigned const cnt_iters = 1000*1000;
+        std::uint64_t t0 = qak::read_time_source(qak::time_source::cpu_cycles);
+        QAK_bench_keep(burn(cnt_iters, t0));
+        std::uint64_t cnt_cycles = qak::read_time_source(qak::time_source::cpu_cycles) - t0;
+
+        if (!t0 || !cnt_cycles)
+            return 250;
+        return static_cast<unsigned>(std::uint64_t(cnt_iters)*1000/cnt_cycles);
+    }
+
+    unsigned const cs_cycles[] = { 10, 100, 1000 };
+
+    struct shared_data
+    {
+        std::uint64_t x = 1;
+        std::uint64_t cnt = 0;
+    };
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    QAKtest(uncontended, "Lock and unlock by a single thread around critical sections of various lengths.")
+    {
+        std::uint64_t const cnt_iters = 2*1000*1000;
+        unsigned const iters_per_kcycle = burn_iters_per_kcycle();
+
+        for (unsigned cycles : cs_cycles)
+        {
+            unsigned const cnt_burn = (cycles*iters_per_kcycle + 999)/1000;
+            char sz[80];
+
+            {
+                qak::mutex mut;
+                shared_data data;
+                std::snprintf(sz, sizeof(sz), "qak::mutex, %u-cycle section", cycles);
+                QAK_bench_loop(sz, cnt_iters,
+                    qak::mutex_lock lock(mut);
+                    data.x = burn(cnt_burn, data.x)
+                );
+                QAK_bench_keep(data.x);
+            }
+            {
+                spin_mutex mut;
+                shared_data data;
+                std::snprintf(sz, sizeof(sz), "spin_mutex, %u-cycle section", cycles);
+                QAK_bench_loop(sz, cnt_iters,
+                    spin_mutex_lock lock(mut);
+                    data.x = burn(cnt_burn, data.x)
+                );
+                QAK_bench_keep(data.x);
+            }
+            {
+                spin_mutex mut(spin_mutex::never_park);
+                shared_data data;
+                std::snprintf(sz, sizeof(sz), "spin_mutex never_park, %u-cycle section", cycles);
+                QAK_bench_loop(sz, cnt_iters,
+                    spin_mutex_lock lock(mut);
+                    data.x = burn(cnt_burn, data.x)
+                );
+                QAK_bench_keep(data.x);
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    std::uint64_t const cnt_per_thread = 500*1000;
+
+    //	Runs cnt_per_thread critical sections on each of 1, 2, 4, ... cnt_cpus_available() threads.
+    //	Returns the total number run.
+    template <class Fn>
+    std::uint64_t bench_scaling(char const * psz_what, unsigned cycles, Fn cs_fn)
+    {
+        unsigned const cnt_cpus = qak::host_info::cnt_cpus_available();
+        std::uint64_t cnt_total = 0;
+
+        for (unsigned n = 1; ; n = (n*2 < cnt_cpus) ? n*2 : cnt_cpus)
+        {
+            qak::stopwatch sw;
+            qak::vector<qak::thread::RP> threads;
+            for (unsigned th_ix = 0; th_ix < n; ++th_ix)
+                threads.push_back(qak::start_thread([&cs_fn]() {
+                    for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                        cs_fn();
+                }));
+            for (unsigned ix = 0; ix < n; ++ix)
+                threads[ix]->join();
+            std::int64_t elapsed_ns = sw.elapsed_ns();
+            cnt_total += n*cnt_per_thread;
+
+            char sz[80];
+            std::snprintf(sz, sizeof(sz), "%s, %u-cycle, %u threads (per-thread)", psz_what, cycles, n);
+            QAK_bench_report(sz, cnt_per_thread, elapsed_ns);
+
+            if (n == cnt_cpus)
+                break;
+        }
+
+        return cnt_total;
+    }
+
+    QAKtest(contended, "Threads running critical sections of various lengths.")
+    {
+        unsigned const iters_per_kcycle = burn_iters_per_kcycle();
+
+        for (unsigned cycles : cs_cycles)
+        {
+            unsigned const cnt_burn = (cycles*iters_per_kcycle + 999)/1000;
+
+            {
+                qak::mutex mut;
+                shared_data data;
+                std::uint64_t cnt_expected = bench_scaling("qak::mutex", cycles, [&]() {
+                    qak::mutex_lock lock(mut);
+                    data.x = burn(cnt_burn, data.x);
+                    ++data.cnt;
+                });
+                QAK_verify( data.cnt == cnt_expected );
+            }
+            {
+                spin_mutex mut;
+                shared_data data;
+                std::uint64_t cnt_expected = bench_scaling("spin_mutex", cycles, [&]() {
+                    spin_mutex_lock lock(mut);
+                    data.x = burn(cnt_burn, data.x);
+                    ++data.cnt;
+                });
+                QAK_verify( data.cnt == cnt_expected );
+            }
+            {
+                spin_mutex mut(spin_mutex::never_park);
+                shared_data data;
+                std::uint64_t cnt_expected = bench_scaling("spin_mutex never_park", cycles, [&]() {
+                    spin_mutex_lock lock(mut);
+                    data.x = burn(cnt_burn, data.x);
+                    ++data.cnt;
+                });
+                QAK_verify( data.cnt == cnt_expected );
+            }
+        }
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -0,0 +1,92 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	spin_mutex__test.cxx
+
+#include "qak/spin_mutex.hxx"
+
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+using qak::spin_mutex;
+using qak::spin_mutex_lock;
+
+namespace zzz { //=====================================================================================================|
+
+    QAKtest(basic, "Locking and try_lock.")
+    {
+        spin_mutex mut;
+        QAK_refute( mut.is_locked() );
+        {
+            spin_mutex_lock lock(mut);
+            QAK_verify( lock.is_locking(mut) );
+            QAK_verify( mut.is_locked() );
+            QAK_refute( mut.try_lock() );
+
+            spin_mutex_lock lock2 = std::move(lock);
+            QAK_verify( lock2.is_locking(mut) );
+            QAK_refute( lock.is_locking(mut) );
+
+            qak::thread::RP th = qak::start_thread_uintptr([&mut]() -> std::uintptr_t {
+                return ! mut.try_lock();
+            });
+            QAK_verify( *th->join() == 1 );
+        }
+        QAK_refute( mut.is_locked() );
+        {
+            qak::optional<spin_mutex_lock> opt_lock = mut.try_lock();
+            QAK_verify( opt_lock );
+            QAK_verify( mut.is_locked() );
+        }
+        QAK_verify( mut.lock().is_locking(mut) );
+        QAK_refute( mut.is_locked() );
+    }
+
+    QAKtest(contended, "Threads incrementing a plain counter under the lock, parking early, late, and never.")
+    {
+        unsigned const cnt_threads = 6;
+        unsigned const cnt_per_thread = 50*1000;
+
+        for (unsigned cnt_spins : { 0u, spin_mutex::default_cnt_spins, spin_mutex::never_park })
+        {
+            spin_mutex mut(cnt_spins);
+            std::uint64_t cnt = 0;
+
+            qak::vector<qak::thread::RP> threads;
+            for (unsigned th_ix = 0; th_ix < cnt_threads; ++th_ix)
+                threads.push_back(qak::start_thread([&]() {
+                    for (unsigned ix = 0; ix < cnt_per_thread; ++ix)
+                    {
+                        spin_mutex_lock lock(mut);
+                        ++cnt;
+                    }
+                }));
+            for (auto & th : threads)
+                th->join();
+
+            QAK_verify( cnt == cnt_threads*cnt_per_thread );
+            QAK_refute( mut.is_locked() );
+        }
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
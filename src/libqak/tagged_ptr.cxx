@@ -0,0 +1,138 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	tagged_ptr.cxx
+
+#include "qak/tagged_ptr.hxx"
+
+#include "qak/mutex.hxx"
+
+#if QAK_CPU_x64 && QAK_INLINEASM_GCC
+#	include <cpuid.h> // __get_cpuid, bit_CMPXCHG16B
+#	define IMPL_CMPXCHG16B 1
+#endif
+
+namespace qak_tagged_ptr_imp_ { //=====================================================================================|
+
+	static_assert(sizeof(dw_stor) == 2*sizeof(void *), "");
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+#if IMPL_CMPXCHG16B
+
+	bool detect_cmpxchg16b()
+	{
+		unsigned a = 0, b = 0, c = 0, d = 0;
+		return __get_cpuid(1, &a, &b, &c, &d) && (c & bit_CMPXCHG16B);
+	}
+
+	bool have_cmpxchg16b() QAK_noexcept
+	{
+		static bool const b = detect_cmpxchg16b();
+		return b;
+	}
+
+	//	Lock-prefixed, so a full barrier. On failure, exp receives the current value.
+	inline bool cmpxchg16b(dw_stor & stor, dw_stor & exp, dw_stor des) QAK_noexcept
+	{
+		bool b;
+		__asm__ __volatile__ (
+			"lock cmpxchg16b %1\n\t"
+			"sete %0"
+			: "=q" (b), "+m" (stor), "+a" (exp.lo), "+d" (exp.hi)
+			: "b" (des.lo), "c" (des.hi)
+			: "cc", "memory" );
+		return b;
+	}
+
+#else
+
+	bool have_cmpxchg16b() QAK_noexcept { return false; }
+
+#endif
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	//	The fallback. Each dw_stor maps to one of these by address. Never destroyed, since they may be needed from
+	//	thread_local or static destructors.
+
+	std::size_t const cnt_stripes = 64;
+
+	qak::mutex & stripe_for(dw_stor const & stor)
+	{
+		static qak::mutex * p_muts = new qak::mutex[cnt_stripes];
+		std::uintptr_t u = reinterpret_cast<std::uintptr_t>(&stor)/sizeof(dw_stor);
+		return p_muts[(u ^ (u >> 6)) % cnt_stripes];
+	}
+
+	//=================================================================================================================|
+
+	bool dw_is_lock_free() QAK_noexcept
+	{
+		return have_cmpxchg16b();
+	}
+
+	dw_stor dw_load(dw_stor const & stor) QAK_noexcept
+	{
+#if IMPL_CMPXCHG16B
+		if (have_cmpxchg16b())
+		{
+			//	There's no 16-byte atomic load. A CAS of zero for zero either leaves the value alone or rewrites
+			//	the zero that's already there, and fails with the current value otherwise.
+			dw_stor exp = { 0, 0 };
+			cmpxchg16b(const_cast<dw_stor &>(stor), exp, exp);
+			return exp;
+		}
+#endif
+		qak::mutex_lock lock(stripe_for(stor));
+		return stor;
+	}
+
+	void dw_store(dw_stor & stor, dw_stor val) QAK_noexcept
+	{
+#if IMPL_CMPXCHG16B
+		if (have_cmpxchg16b())
+		{
+			dw_stor exp = { 0, 0 };
+			while (!cmpxchg16b(stor, exp, val))
+				;
+			return;
+		}
+#endif
+		qak::mutex_lock lock(stripe_for(stor));
+		stor = val;
+	}
+
+	bool dw_compare_exchange(dw_stor & stor, dw_stor & exp, dw_stor des) QAK_noexcept
+	{
+#if IMPL_CMPXCHG16B
+		if (have_cmpxchg16b())
+			return cmpxchg16b(stor, exp, des);
+#endif
+		qak::mutex_lock lock(stripe_for(stor));
+		if (stor.lo == exp.lo && stor.hi == exp.hi)
+		{
+			stor = des;
+			return true;
+		}
+		exp = stor;
+		return false;
+	}
+
+} // namespace qak_tagged_ptr_imp_ ====================================================================================|
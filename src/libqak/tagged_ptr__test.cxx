@@ -0,0 +1,157 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	tagged_ptr__test.cxx
+
+#include "qak/tagged_ptr.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/host_info.hxx"
+#include "qak/thread_group.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    struct node
+    {
+        node * p_next = 0;
+        std::uint64_t cnt_popped = 0;
+    };
+
+    QAKtest(basic, "load, store, and compare_exchange.")
+    {
+        node a, b;
+
+        qak::atomic_tagged_ptr<node> atp;
+        QAK_verify( atp.load() == qak::tagged_ptr<node>() );
+
+        atp.store(qak::tagged_ptr<node>(&a, 5));
+        QAK_verify( atp.load().ptr == &a );
+        QAK_verify( atp.load().tag == 5 );
+
+        qak::tagged_ptr<node> exp = atp.load();
+        QAK_verify( atp.compare_exchange(exp, exp.next(&b)) );
+        QAK_verify( atp.load() == qak::tagged_ptr<node>(&b, 6) );
+
+        //	A failed compare_exchange reports the current value.
+        exp = qak::tagged_ptr<node>(&a, 5);
+        QAK_refute( atp.compare_exchange(exp, exp.next(0)) );
+        QAK_verify( exp == qak::tagged_ptr<node>(&b, 6) );
+
+        qak::atomic_tagged_ptr<node> atp2(qak::tagged_ptr<node>(&a, ~std::uintptr_t(0)));
+        QAK_verify( atp2.load().tag == ~std::uintptr_t(0) );
+        QAK_verify( atp2.load().next(&a).tag == 0 );
+
+        //	Whichever it is, it's the same for every object.
+        QAK_verify( atp.is_lock_free() == atp2.is_lock_free() );
+    }
+
+    QAKtest(aba, "A matching pointer with a stale tag doesn't compare equal.")
+    {
+        node a, b;
+
+        qak::atomic_tagged_ptr<node> head(qak::tagged_ptr<node>(&a, 0));
+        qak::tagged_ptr<node> stale = head.load();
+
+        //	Pop a, push b, push a back. The head pointer is a again.
+        qak::tagged_ptr<node> cur = head.load();
+        QAK_verify( head.compare_exchange(cur, cur.next(0)) );
+        cur = head.load();
+        QAK_verify( head.compare_exchange(cur, cur.next(&b)) );
+        cur = head.load();
+        QAK_verify( head.compare_exchange(cur, cur.next(&a)) );
+        QAK_verify( head.load().ptr == stale.ptr );
+
+        QAK_refute( head.compare_exchange(stale, stale.next(&b)) );
+        QAK_verify( head.load() == qak::tagged_ptr<node>(&a, 3) );
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    //	A Treiber stack. Nodes are never freed, only recycled, which is the case where ABA bites.
+    struct stack
+    {
+        qak::atomic_tagged_ptr<node> head;
+
+        void push(node * p)
+        {
+            qak::tagged_ptr<node> cur = head.load();
+            do
+                p->p_next = cur.ptr;
+            while (!head.compare_exchange(cur, cur.next(p)));
+        }
+
+        node * pop()
+        {
+            qak::tagged_ptr<node> cur = head.load();
+            while (cur.ptr && !head.compare_exchange(cur, cur.next(cur.ptr->p_next)))
+                ;
+            return cur.ptr;
+        }
+    };
+
+    QAKtest(treiber_stack, "Threads of a thread_group popping and pushing back nodes of a shared stack.")
+    {
+        std::size_t const cnt_nodes = 16;
+        std::uint64_t const cnt_per_thread = 200*1000;
+
+        std::size_t cnt_threads = qak::host_info::cnt_threads_recommended();
+        if (cnt_threads < 4)
+            cnt_threads = 4;
+
+        qak::vector<node> nodes(cnt_nodes);
+        stack stk;
+        for (auto & n : nodes)
+            stk.push(&n);
+
+        qak::atomic<std::uint64_t> cnt_empty;
+
+        qak::thread_group::RP rp_tg(new qak::thread_group(
+            [&](std::size_t, qak::thread_group::provide_thread_stop_fn_t provide_stop_fn) {
+                provide_stop_fn([]() { });
+                for (std::uint64_t ix = 0; ix < cnt_per_thread; ++ix)
+                {
+                    //	Hold two at once, so the head moves a lot under a thread that's about to CAS.
+                    node * p1 = stk.pop();
+                    node * p2 = stk.pop();
+                    if (p1) { ++p1->cnt_popped; stk.push(p1); } else ++cnt_empty;
+                    if (p2) { ++p2->cnt_popped; stk.push(p2); } else ++cnt_empty;
+                }
+            },
+            cnt_threads));
+        rp_tg->join();
+
+        //	Every node is back on the stack exactly once, and every pop was of a node no one else had.
+        std::size_t cnt_found = 0;
+        std::uint64_t cnt_pops = 0;
+        while (node * p = stk.pop())
+        {
+            ++cnt_found;
+            cnt_pops += p->cnt_popped;
+            QAK_verify( cnt_found <= cnt_nodes );
+        }
+        QAK_verify( cnt_found == cnt_nodes );
+        QAK_verify( cnt_pops + cnt_empty == 2*cnt_threads*cnt_per_thread );
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
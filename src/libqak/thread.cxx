@@ -27,6 +27,8 @@
 #include "qak/host_info.hxx"
 #include "qak/fail.hxx"
 #include "qak/min_max.hxx"
+#include "qak/mutex.hxx"
+#include "qak/now.hxx"
 //#include "qak/threadls.hxx"
 #include "qak/imp/pthread.hxx"
 
@@ -41,9 +43,13 @@
 #if QAK_API_POSIX
 #	include <cstdlib> // std::malloc
 #	include <errno.h>
-#	include <sched.h> // sched_yield, sched_setaffinity
+#	include <sched.h> // sched_yield, sched_setaffinity, sched_getcpu
 #	include <unistd.h> // sysconf
 #	include <time.h> // clock_nanosleep
+#	if QAK_LINUX
+#		include <linux/mempolicy.h> // MPOL_BIND
+#		include <sys/syscall.h> // SYS_set_mempolicy
+#	endif
 #elif QAK_API_WIN32
 #	include "../platforms/win32/win32_lite.hxx"
 #	include <process.h> // _beginthreadex
@@ -164,6 +170,16 @@ namespace qak { //==============================================================
         qak::atomic<unsigned> exit_method;
         qak::atomic<thread_handle_t> ahth;
 
+        //	The thread_options the new thread applies to itself.
+        std::string name;
+        optional<unsigned> opt_numa_node;
+
+#if QAK_THREAD_PTHREAD
+        //	Serializes the pthread_join() call, which must happen exactly once for a joinable thread.
+        qak::mutex mutable reap_mutex;
+        bool mutable reaped;
+#endif
+
         thread_imp() :
             started_by_start_routine(true),
             p_thread_fn_ui(0),
@@ -171,6 +187,10 @@ namespace qak { //==============================================================
             exit_code(0),
             exit_method(not_known_to_have_exited),
             ahth(invalid_thread_handle_value)
+#if QAK_THREAD_PTHREAD
+          , reap_mutex(),
+            reaped(false)
+#endif
         { }
 
         explicit thread_imp(thread_handle_t th_h) :
@@ -180,6 +200,10 @@ namespace qak { //==============================================================
             exit_code(0),
             exit_method(not_known_to_have_exited),
             ahth(th_h)
+#if QAK_THREAD_PTHREAD
+          , reap_mutex(),
+            reaped(false)
+#endif
         { }
 
         ~thread_imp()
@@ -187,6 +211,13 @@ namespace qak { //==============================================================
             delete p_thread_fn_ui;   p_thread_fn_ui = 0;
             delete p_thread_fn_void; p_thread_fn_void = 0;
 
+#if QAK_THREAD_PTHREAD
+            //	Nobody joined the thread, so let the system reclaim it when it exits.
+            //	This may be running on the thread itself, which is fine.
+            if (started_by_start_routine && !reaped && invalid_thread_handle_value != ahth)
+                (void)::pthread_detach(ahth);
+#endif
+
 #if QAK_API_WIN32
             if (invalid_thread_handle_value != ahth)
             {
@@ -198,10 +229,16 @@ namespace qak { //==============================================================
 #endif
         }
 
-        void start();
+        void start(thread_options const & opts);
 
         void try_assign_ahth(thread_handle_t h);
         unsigned start_routine();
+        void apply_options_in_thread();
+
+#if QAK_THREAD_PTHREAD
+        //	Calls pthread_join() if it hasn't been called already. Blocks until the thread terminates.
+        void reap() const;
+#endif
 
         virtual qak::optional<qak::optional<std::uintptr_t>> join_timeout_v(qak::optional<std::int64_t> opt_timeout_ns) const;
     };
@@ -211,28 +248,28 @@ namespace qak { //==============================================================
 
     //-----------------------------------------------------------------------------------------------------------------|
 
-    thread::RP start_thread(std::function<void()> thread_fn)
+    thread::RP start_thread(std::function<void()> thread_fn, thread_options const & opts)
     {
         thread_imp * p_thread_imp = new thread_imp;
         thread::RP rp_thread(p_thread_imp);
 
         p_thread_imp->p_thread_fn_void = new std::function<void()>(thread_fn);
 
-        p_thread_imp->start();
+        p_thread_imp->start(opts);
 
         return rp_thread;
     }
 
     //-----------------------------------------------------------------------------------------------------------------|
 
-    thread::RP start_thread_uintptr(std::function<std::uintptr_t()> thread_fn)
+    thread::RP start_thread_uintptr(std::function<std::uintptr_t()> thread_fn, thread_options const & opts)
     {
         thread_imp * p_thread_imp = new thread_imp;
         thread::RP rp_thread(p_thread_imp);
 
         p_thread_imp->p_thread_fn_ui = new std::function<std::uintptr_t()>(thread_fn);
 
-        p_thread_imp->start();
+        p_thread_imp->start(opts);
 
         return rp_thread;
     }
@@ -294,6 +331,9 @@ namespace qak { //==============================================================
 
         pthread_attr_t * get_ptr() { return &attr; }
 
+        //	Sets the attributes that pthread_create applies. The options have been validated.
+        void apply(thread_options const & opts);
+
         pthread_attr_t attr;
 
         ptattr(ptattr const &) = delete;
@@ -301,10 +341,100 @@ namespace qak { //==============================================================
         ptattr & operator = (ptattr const &) = delete;
         ptattr & operator = (ptattr &&) = delete;
     };
+
+    static int pthread_sched_policy(thread_sched_policy policy)
+    {
+        switch (policy)
+        {
+        case thread_sched_policy::normal:      return SCHED_OTHER;
+#if QAK_LINUX
+        case thread_sched_policy::batch:       return SCHED_BATCH;
+        case thread_sched_policy::idle:        return SCHED_IDLE;
+#endif
+        case thread_sched_policy::fifo:        return SCHED_FIFO;
+        case thread_sched_policy::round_robin: return SCHED_RR;
+        default:                               break;
+        }
+        return fail_expr<int>();
+    }
+
+    void ptattr::apply(thread_options const & opts)
+    {
+        if (opts.opt_stack_size)
+        {
+            std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            std::size_t sz = qak::max<std::size_t>(*opts.opt_stack_size, PTHREAD_STACK_MIN);
+            sz = (sz + page_size - 1)/page_size*page_size;
+            fail_unless(!::pthread_attr_setstacksize(&attr, sz));
+        }
+
+        if (opts.opt_guard_size)
+            fail_unless(!::pthread_attr_setguardsize(&attr, *opts.opt_guard_size));
+
+        if (opts.sched_policy != thread_sched_policy::inherit)
+        {
+            int policy = pthread_sched_policy(opts.sched_policy);
+
+            sched_param param = { };
+            param.sched_priority = opts.sched_priority;
+            fail_unless(   !::pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED)
+                        && !::pthread_attr_setschedpolicy(&attr, policy)
+                        && !::pthread_attr_setschedparam(&attr, &param) );
+        }
+
+#if QAK_LINUX
+        if (!opts.cpu_ixs.empty())
+        {
+            unsigned cnt_cpus = host_info::cnt_cpus_configured();
+            size_t sz = CPU_ALLOC_SIZE(cnt_cpus);
+            cpu_set_t * p_cpuset = CPU_ALLOC(cnt_cpus);
+            fail_unless(p_cpuset);
+
+            CPU_ZERO_S(sz, p_cpuset);
+            for (unsigned cpu_ix : opts.cpu_ixs)
+                CPU_SET_S(cpu_ix, sz, p_cpuset);
+
+            bool ok = !::pthread_attr_setaffinity_np(&attr, sz, p_cpuset);
+            CPU_FREE(p_cpuset);
+            fail_unless(ok);
+        }
+#endif
+    }
+
 #endif // of if QAK_THREAD_PTHREAD
 
-    void thread_imp::start()
+    void thread_options::validate() const
     {
+        if (opt_numa_node)
+            fail_unless(*opt_numa_node < host_info::cnt_numa_nodes());
+
+#if QAK_LINUX
+        for (unsigned cpu_ix : cpu_ixs)
+            fail_unless(cpu_ix < host_info::cnt_cpus_configured());
+#else
+        //	CPU pinning is Linux-only.
+        fail_unless(cpu_ixs.empty());
+#endif
+
+#if QAK_THREAD_PTHREAD
+        if (sched_policy != thread_sched_policy::inherit)
+        {
+            int policy = pthread_sched_policy(sched_policy);
+            fail_unless(   sched_get_priority_min(policy) <= sched_priority
+                        && sched_priority <= sched_get_priority_max(policy) );
+        }
+#endif
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
+    void thread_imp::start(thread_options const & opts)
+    {
+        opts.validate();
+
+        name = opts.name;
+        opt_numa_node = opts.opt_numa_node;
+
         thread::RP rp_this(this);
 
         //	Manually bump the refcnt on the thread_imp object. The thread (if started) will reduce it.
@@ -315,6 +445,16 @@ namespace qak { //==============================================================
 #if QAK_THREAD_PTHREAD
 
         ptattr attr;
+        try
+        {
+            attr.apply(opts);
+        }
+        catch (...)
+        {
+            rp_this.unsafe__dec_refcnt();
+            throw;
+        }
+
         int err = ::pthread_create(
             &th_h,                // pthread_t * restrict thread
             attr.get_ptr(),       // const pthread_attr_t * restrict attr
@@ -349,10 +489,11 @@ namespace qak { //==============================================================
 #elif QAK_API_WIN32
 
         // MSDN: "_beginthreadex returns 0 on an error, in which case errno and _doserrno are set"
+        //? name, scheduling, CPUs, and NUMA node.
         unsigned threadId = 0;
         th_h = static_cast<thread_handle_t>(_beginthreadex(
             0,            // void *security
-            0,            // unsigned stack_size
+            opts.opt_stack_size ? static_cast<unsigned>(*opts.opt_stack_size) : 0, // unsigned stack_size
             thread_start_routine, // unsigned ( __stdcall *start_address )( void * )
             this,         // void *arglist
             0,            // unsigned initflag
@@ -384,11 +525,47 @@ namespace qak { //==============================================================
 
 #if QAK_THREAD_PTHREAD
 
-        QAK_unused(opt_timeout_ns);
+        //	Pthreads has no portable join timeout. But start_routine() sets exit_method just before the thread
+        //	returns, so we can wait on that and only call pthread_join() once it won't block for long.
+
+        bool is_self = ::pthread_equal(::pthread_self(), ahth);
 
-        // Pthreads has no join timeout. :-P
-        // So probably we need to arrange for the thread to hold a lock on a mutex on which we can wait.
-        qak::fail_todo(); // port me
+        // If the calling thread is trying to join itself, don't wait around for the termination.
+        if (is_self)
+            opt_timeout_ns = 0;
+
+        bool wait_forever = !opt_timeout_ns;
+
+        if (wait_forever)
+        {
+            //	We can't wait for the termination of a thread we didn't start.
+            fail_unless(started_by_start_routine);
+
+            reap();
+        }
+        else if (not_known_to_have_exited == exit_method)
+        {
+            std::int64_t timeout_ns = qak::max<std::int64_t>(0, qak::min<std::int64_t>(*opt_timeout_ns, thread::max_timeout_ns()));
+            std::uint64_t t_deadline = read_time_source(time_source::wallclock_ns) + timeout_ns;
+
+            exit_method.wait_until(not_known_to_have_exited, t_deadline);
+        }
+
+        if (not_known_to_have_exited != exit_method && started_by_start_routine && !is_self)
+            reap();
+
+        switch (exit_method)
+        {
+        case not_known_to_have_exited:
+            assert(!rv);
+            break;
+        case exited_normally:
+            rv = qak::optional<uintptr_t>(exit_code);
+            break;
+        case exited_via_exception:
+            rv = qak::optional<uintptr_t>();
+            break;
+        }
 
 #elif QAK_API_WIN32
 
@@ -462,6 +639,27 @@ namespace qak { //==============================================================
         return rv;
     }
 
+#if QAK_THREAD_PTHREAD
+
+    void thread_imp::reap() const
+    {
+        assert(started_by_start_routine);
+
+        mutex_lock lock(reap_mutex);
+
+        if (!reaped)
+        {
+            int err = ::pthread_join(ahth, 0);
+            fail_unless(!err);
+
+            reaped = true;
+        }
+
+        assert(not_known_to_have_exited != exit_method);
+    }
+
+#endif // of QAK_THREAD_PTHREAD
+
     //	Assigns th_h to ahth iff it holds the invalid handle value. Otherwise, closes th_h.
     void thread_imp::try_assign_ahth(thread_handle_t th_h)
     {
@@ -548,6 +746,8 @@ namespace qak { //==============================================================
                 try_assign_ahth(th_h);
             }
 
+            apply_options_in_thread();
+
             //	Make our thread handle accessible via thread local storage.
             s_threadlocal_thread_imp_rp = rp_thread;
 
@@ -590,6 +790,9 @@ namespace qak { //==============================================================
                 }
             }
 
+            //	Wake any timed joiners.
+            this->exit_method.notify_all();
+
             //	Remove our handle from the thread local storage key.
             s_threadlocal_thread_imp_rp.reset();
 
@@ -784,11 +987,56 @@ namespace qak { //==============================================================
 
     //-----------------------------------------------------------------------------------------------------------------|
 
+    //	The thread_options that can only be applied by the thread itself, before it calls the thread fn. Errors
+    //	here have no one to go to, which is why start() checked the node.
+    void thread_imp::apply_options_in_thread()
+    {
+#if QAK_LINUX
+        if (!name.empty())
+        {
+            //	The kernel's limit, with the terminator, is 16.
+            std::string name_15(name, 0, 15);
+            (void)::pthread_setname_np(::pthread_self(), name_15.c_str());
+        }
+
+        if (opt_numa_node)
+        {
+            unsigned os_node_id = host_info::numa_node_os_id(*opt_numa_node);
+            std::size_t const bits_per_word = bitsizeof<unsigned long>();
+            vector<unsigned long> nodemask(os_node_id/bits_per_word + 1, 0);
+            nodemask[os_node_id/bits_per_word] = 1ul << os_node_id%bits_per_word;
+
+            //	maxnode counts one more bit than the mask has, for historical reasons.
+            (void)::syscall(SYS_set_mempolicy, MPOL_BIND, nodemask.data(), nodemask.size()*bits_per_word + 1);
+        }
+#endif
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------|
+
     void this_thread::set_affinity(unsigned cpu_ix)
     {
         this_thread::get()->set_cpu_affinity(cpu_ix);
     }
 
+    unsigned this_thread::get_cpu_ix() QAK_noexcept
+    {
+#if QAK_LINUX
+
+        int cpu_ix = ::sched_getcpu();
+        return cpu_ix < 0 ? 0 : static_cast<unsigned>(cpu_ix);
+
+#elif QAK_API_WIN32
+
+        return win32::GetCurrentProcessorNumber();
+
+#else
+
+        return 0;
+
+#endif
+    }
+
     void thread::set_cpu_affinity(unsigned cpu_ix)
     {
         unsigned cnt_avail = host_info::cnt_cpus_available();
@@ -27,6 +27,16 @@
 #include "qak/stopwatch.hxx"
 #include "qak/mutex.hxx"
 
+#include <stdexcept> // std::runtime_error
+#include <string>
+
+#if QAK_LINUX
+#	include <linux/mempolicy.h> // MPOL_BIND
+#	include <pthread.h>
+#	include <sys/syscall.h> // SYS_get_mempolicy
+#	include <unistd.h> // syscall
+#endif
+
 #include "qak/test_app_pre.hxx"
 #include "qak/test_macros.hxx"
 
@@ -179,5 +189,82 @@ namespace zzz { //==============================================================
 //#		th->join();
 //#	}
 
+#if QAK_LINUX
+
+	QAKtest(options, "A thread started with thread_options sees them applied.")
+	{
+		//	CPUs we may not use would be rejected, so use the one we're on.
+		unsigned cpu_ix_here = qak::this_thread::get_cpu_ix();
+
+		qak::thread_options opts;
+		opts.name = "qak-thread-test-name";
+		opts.opt_stack_size = 256*1024;
+		opts.opt_guard_size = 0;
+		opts.cpu_ixs.push_back(cpu_ix_here);
+		opts.opt_numa_node = qak::host_info::numa_node_of_cpu(cpu_ix_here);
+
+		char sz_name[16] = { };
+		std::size_t stack_size = 0;
+		std::size_t guard_size = 1;
+		unsigned cpu_ix = ~0u;
+		int mempolicy = -1;
+		long err_mempolicy = 0;
+		qak::start_thread([&]() {
+				::pthread_getname_np(::pthread_self(), sz_name, sizeof(sz_name));
+
+				pthread_attr_t attr;
+				if (!::pthread_getattr_np(::pthread_self(), &attr))
+				{
+					::pthread_attr_getstacksize(&attr, &stack_size);
+					::pthread_attr_getguardsize(&attr, &guard_size);
+					::pthread_attr_destroy(&attr);
+				}
+
+				cpu_ix = qak::this_thread::get_cpu_ix();
+				err_mempolicy = ::syscall(SYS_get_mempolicy, &mempolicy, 0, 0, 0, 0);
+			},
+			opts )->join();
+
+		QAK_verify( std::string(sz_name) == "qak-thread-test" );
+		QAK_verify( 256*1024 <= stack_size && stack_size < 1024*1024 );
+		QAK_verify( guard_size == 0 );
+		QAK_verify( cpu_ix == cpu_ix_here );
+
+		//	Containers may deny the memory policy calls.
+		QAK_verify( err_mempolicy || mempolicy == MPOL_BIND );
+	}
+
+#endif // QAK_LINUX
+
+	QAKtest(options_rejected, "Out of range thread_options make start_thread throw rather than start a thread.")
+	{
+		auto start_throws = [](qak::thread_options const & opts) {
+			try
+			{
+				qak::start_thread([]() { }, opts)->join();
+			}
+			catch (std::runtime_error const &)
+			{
+				return true;
+			}
+			return false;
+		};
+
+		qak::thread_options opts_cpu;
+		opts_cpu.cpu_ixs.push_back(qak::host_info::cnt_cpus_configured());
+		QAK_verify( start_throws(opts_cpu) );
+
+		qak::thread_options opts_priority;
+		opts_priority.sched_policy = qak::thread_sched_policy::normal;
+		opts_priority.sched_priority = 50;
+		QAK_verify( start_throws(opts_priority) );
+
+		qak::thread_options opts_numa;
+		opts_numa.opt_numa_node = qak::host_info::cnt_numa_nodes();
+		QAK_verify( start_throws(opts_numa) );
+
+		QAK_refute( start_throws(qak::thread_options()) );
+	}
+
 } // namespace zzz ====================================================================================================|
 #include "qak/test_app_post.hxx"
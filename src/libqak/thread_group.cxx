@@ -22,11 +22,12 @@
 #include "qak/thread_group.hxx"
 
 #include "qak/atomic.hxx"
+#include "qak/condition.hxx"
 #include "qak/fail.hxx"
 #include "qak/host_info.hxx"
-#include "qak/min_max.hxx"
 #include "qak/mutex.hxx"
 #include "qak/now.hxx"
+#include "qak/pool.hxx"
 #include "qak/rptr.hxx"
 #include "qak/thread.hxx"
 #include "qak/vector.hxx"
@@ -49,6 +50,7 @@ namespace qak { //==============================================================
     struct thread_group_data : rpointee_base<thread_group_data>
     {
         thread_fn_t const fn_;
+        thread_options const opts_;
 
         //	The count of threads we want running.
         atomic<size_t> target_cnt_threads_;
@@ -62,6 +64,9 @@ namespace qak { //==============================================================
         //	Hold a lock on this mutex when accessing the members which follow it.
         mutex mut_;
 
+        //	Notified, under mut_, whenever a thread becomes stoppable, exits, or is joined. timed_join waits on it.
+        condition state_changed_;
+
         enum struct thread_state {
             not_started,
             starting,
@@ -76,9 +81,11 @@ namespace qak { //==============================================================
         //	Mapping of thread_id to cpu_ix and stop_fn.
         //	We could make this some kind of actual map data structure, but it likely wouldn't be
         //	any faster given the relatively small number of elements it is expected to contain.
-        struct thread_info : rpointee_base<thread_info>
+        //	The thread itself moves its state from starting to started without taking mut_. Other transitions are
+        //	made holding mut_.
+        struct thread_info : rpointee_base<thread_info>, rpointee_pooled<thread_info>
         {
-            thread_state state;
+            atomic<thread_state> state;
             thread::RP rp_thread;
             size_t cpu_ix;
             optional<thread_stop_fn_t> stop_fn;
@@ -98,12 +105,15 @@ namespace qak { //==============================================================
 
         thread_group_data(
             thread_fn_t const & fn,
-            size_t target_cnt
+            size_t target_cnt,
+            thread_options const & opts
         ) :
             fn_(fn),
+            opts_(opts),
             target_cnt_threads_(target_cnt),
             cnt_threads_requested_(0),
-            cnt_threads_not_yet_joined_(0)
+            cnt_threads_not_yet_joined_(0),
+            mut_("qak::thread_group")
         { }
 
         //	Implements the thread_group::timed_join method.
@@ -134,16 +144,28 @@ namespace qak { //==============================================================
 
     thread_group::thread_group(
         thread_fn_t fn,
-        size_t cnt // = 0
+        size_t cnt, // = 0
+        thread_options const & opts // = thread_options()
     ) :
         pv_(0)
     {
-        rptr<thread_group_data> p_tgd(new thread_group_data(fn, cnt));
+        opts.validate();
+
+        rptr<thread_group_data> p_tgd(new thread_group_data(fn, cnt, opts));
+
+        try
+        {
+            p_tgd->start_or_stop();
+        }
+        catch (...)
+        {
+            //	Without a thread_group to join them, the threads already started would never be.
+            p_tgd->timed_join(-1);
+            throw;
+        }
 
         p_tgd.unsafe__inc_refcnt();
         pv_ = p_tgd.get();
-
-        p_tgd->start_or_stop();
     }
 
     //-----------------------------------------------------------------------------------------------------------------|
@@ -249,34 +271,36 @@ namespace qak { //==============================================================
 
     bool thread_group_data::timed_join(int64_t max_wait_ns)
     {
-        int64_t cnt_waits = 0;
-
         bool forever = max_wait_ns < 0;
         uint64_t until = forever ? 0 : read_time_source(time_source::wallclock_ns) + max_wait_ns;
         for (;;)
         {
             target_cnt_threads_ = 0;
 
-            {
-                mutex_lock lock(mut_);
-                clean_out_exited_threads(lock);
+            join_exiting_threads();
 
-                if (threadinfos_.empty())
-                    return true;                                   // all done
+            mutex_lock lock(mut_);
+            clean_out_exited_threads(lock);
 
-                stop_some_threads(lock, threadinfos_.size());
-            }
+            if (threadinfos_.empty())
+                return true;                                       // all done
 
-            if (!forever && until <= read_time_source(time_source::wallclock_ns))
-                break;                                             // time's up
+            stop_some_threads(lock, threadinfos_.size());
 
-            //	Do some more waiting.
-            join_exiting_threads();
+            //	Block until some thread changes state, unless one is already waiting to be joined. The transitions
+            //	are made holding mut_, so none can slip in between this look and the wait.
+            bool any_exiting = false;
+            for (auto & rp_threadinfo : threadinfos_)
+                if (rp_threadinfo && rp_threadinfo->state == thread_state::exiting)
+                    any_exiting = true;
 
-            //	Sleep for increasing intervals from 1 us to 1 ms.
-            ++cnt_waits;
-            this_thread::sleep_ns(
-                qak::min<int64_t>(cnt_waits, 100*1000)*10 );
+            if (!any_exiting)
+            {
+                if (forever)
+                    state_changed_.wait(lock);
+                else if (!state_changed_.wait_until_ns(lock, until))
+                    break;                                         // time's up
+            }
         }
 
         return false;
@@ -295,17 +319,21 @@ namespace qak { //==============================================================
 
                 for (auto & rp_threadinfo : threadinfos_)
                 {
-                    if (rp_threadinfo && rp_threadinfo->state == thread_state::exiting)
+                    if (!rp_threadinfo)
+                        continue;
+
+                    thread_info & ti = *rp_threadinfo;
+                    if (ti.state == thread_state::exiting)
                     {
                         assert(cnt_threads_not_yet_joined_);
-                        fail_unless(rp_threadinfo->rp_thread);
+                        fail_unless(ti.rp_thread);
 
-                        bool callerThreadExiting = this_thread::is_same(rp_threadinfo->rp_thread);
+                        bool callerThreadExiting = this_thread::is_same(ti.rp_thread);
                         assert(!callerThreadExiting); // how would this happen anyway?
                         if (!callerThreadExiting)
                         {
                             rp_ti_to_join = rp_threadinfo;
-                            rp_threadinfo->state = thread_state::joining;
+                            ti.state = thread_state::joining;
                             break;
                         }
                     }
@@ -321,6 +349,7 @@ namespace qak { //==============================================================
                 assert(rp_ti_to_join->state == thread_state::joining);
                 rp_ti_to_join->state = thread_state::joined;
                 --cnt_threads_not_yet_joined_;
+                state_changed_.notify_all();
             }
         }
         while (rp_ti_to_join);
@@ -500,7 +529,10 @@ namespace qak { //==============================================================
                 rp_threadinfo->stop_fn = stop_fn;
 
                 if (rp_threadinfo->state == thread_state::started)
+                {
                     rp_threadinfo->state = thread_state::stoppable;
+                    rp_tgd->state_changed_.notify_all();
+                }
             };
 
         //	Start the new thread.
@@ -510,30 +542,37 @@ namespace qak { //==============================================================
         ++cnt_threads_requested_;
         ++cnt_threads_not_yet_joined_;
 
-        rp_threadinfo->rp_thread = qak::start_thread(
-            [rp_tgd, rp_threadinfo, provide_thread_stop_fn]() -> void
-            {
+        try
+        {
+            rp_threadinfo->rp_thread = qak::start_thread(
+                [rp_tgd, rp_threadinfo, provide_thread_stop_fn]() -> void
                 {
-                    mutex_lock lock(rp_tgd->mut_);
-
                     assert(rp_threadinfo->state == thread_state::starting);
                     rp_threadinfo->state = thread_state::started;
 
 #if 0
                     //	Set thread affinity.
                     this_thread::set_affinity(rp_threadinfo->cpu_ix);
-
 #endif
-                    rp_threadinfo->state = thread_state::started;
-                }
 
-                rp_tgd->fn_(rp_threadinfo->cpu_ix, provide_thread_stop_fn);
+                    rp_tgd->fn_(rp_threadinfo->cpu_ix, provide_thread_stop_fn);
 
-                {
                     mutex_lock lock(rp_tgd->mut_);
                     rp_threadinfo->state = thread_state::exiting;
-                }
-            });
+                    rp_tgd->state_changed_.notify_all();
+                },
+                opts_);
+        }
+        catch (...)
+        {
+            //	No thread, so take back its entry. Otherwise join would wait forever for it to exit.
+            //	We've held mut_ throughout, so it's still the last.
+            assert(threadinfos_.back() == rp_threadinfo);
+            threadinfos_.pop_back();
+            --cnt_threads_requested_;
+            --cnt_threads_not_yet_joined_;
+            throw;
+        }
     }
 
     //-----------------------------------------------------------------------------------------------------------------|
@@ -602,16 +641,15 @@ namespace qak { //==============================================================
     {
         QAK_unused(lock); assert(lock.is_locking(mut_));
 
-        thread_state ts = rp_threadinfo->state;
-        if (thread_state::stoppable <= ts && ts < thread_state::stop_requested)
+        if (rp_threadinfo->state == thread_state::stoppable)
         {
+            rp_threadinfo->state = thread_state::stop_requested;
+
             //	Call the thread's stop_fn.
             assert(rp_threadinfo->stop_fn);
             (*rp_threadinfo->stop_fn)();
 
             --cnt_threads_requested_;
-
-            ts = thread_state::stop_requested;
         }
     }
 
@@ -27,6 +27,13 @@
 #include "qak/stopwatch.hxx"
 #include "qak/thread.hxx"
 
+#include <stdexcept> // std::runtime_error
+#include <string>
+
+#if QAK_LINUX
+#   include <pthread.h>
+#endif
+
 #include "qak/test_app_pre.hxx"
 #include "qak/test_macros.hxx"
 
@@ -85,7 +92,8 @@ namespace zzz { //==============================================================
             qak::this_thread::sleep_ns(ns);
             total_slept += ns;
 
-            QAK_verify( total_slept < std::int64_t(1)*1000*1000*1000 );
+            //	Only catches a hang. Starting the threads can take a while on a loaded machine with few CPUs.
+            QAK_verify( total_slept < std::int64_t(30)*1000*1000*1000 );
         }
 
         qak::this_thread::sleep_ns(10*1000); // 10 us
@@ -96,20 +104,104 @@ namespace zzz { //==============================================================
         //	void join()
         tg.join();
 
-        //	Took 12 ms on Intel Core i7.
-        QAK_verify( sw.elapsed_s() < 1.2 );
+        //	Took 12 ms on Intel Core i7. Again, this only catches a hang.
+        QAK_verify( sw.elapsed_s() < 60.0 );
     }
 
-#if 0
-    QAKtest(set_target_cpu_coverage)
+    QAKtest(timed_join)
     {
-        //	void set_target_cpu_coverage(float coverage)
-        //?
+        //	Threads that ignore the stop request until released.
+        qak::atomic<int> released;
+        qak::thread_group::RP ptg(new qak::thread_group(
+            [&released](std::size_t, qak::thread_group::provide_thread_stop_fn_t provide_thread_stop_fn) {
+                provide_thread_stop_fn([]() { });
+                released.wait(0);
+            },
+            4));
+
+        //	bool timed_join(std::int64_t max_wait_ns);
+        QAK_refute( ptg->timed_join(1*1000*1000) ); // 1 ms
+
+        released = 1;
+        released.notify_all();
+
+        //	Joining is woken by the threads exiting rather than polling for it.
+        qak::stopwatch sw;
+        QAK_verify( ptg->timed_join(std::int64_t(10)*1000*1000*1000) ); // 10 s
+        QAK_verify( sw.elapsed_s() < 1.0 );
     }
 
-    QAKtest(timed_join)
+    QAKtest(options, "Every thread of the group is started with the group's thread_options.")
     {
-        //	bool timed_join(std::int64_t max_wait_ns);
+        qak::thread_options opts;
+        opts.opt_stack_size = 128*1024;
+        opts.name = "qak-tg-test";
+
+        qak::atomic<int> cnt_started;
+        qak::atomic<int> cnt_named;
+        qak::thread_group::RP ptg(new qak::thread_group(
+            [&](std::size_t, qak::thread_group::provide_thread_stop_fn_t provide_thread_stop_fn) {
+                provide_thread_stop_fn([]() { });
+                ++cnt_started;
+#if QAK_LINUX
+                char sz_name[16] = { };
+                ::pthread_getname_np(::pthread_self(), sz_name, sizeof(sz_name));
+                if (std::string(sz_name) == "qak-tg-test")
+                    ++cnt_named;
+#else
+                ++cnt_named;
+#endif
+            },
+            3,
+            opts));
+        ptg->join();
+
+        QAK_verify( cnt_started.load() == 3 );
+        QAK_verify( cnt_named.load() == 3 );
+    }
+
+    QAKtest(options_rejected, "Out of range thread_options make the constructor throw, even with no threads to start.")
+    {
+        qak::thread_options opts;
+        opts.cpu_ixs.push_back(qak::host_info::cnt_cpus_configured());
+
+        for (std::size_t cnt : { 0, 2 })
+        {
+            bool threw = false;
+            try
+            {
+                qak::thread_group::RP ptg(new qak::thread_group(thfn, cnt, opts));
+            }
+            catch (std::runtime_error const &)
+            {
+                threw = true;
+            }
+            QAK_verify( threw );
+        }
+    }
+
+    QAKtest(start_fails, "A thread that fails to start leaves nothing behind to join.")
+    {
+        //	Passes validation, but there's no room for the stack.
+        qak::thread_options opts;
+        opts.opt_stack_size = std::size_t(1) << (sizeof(std::size_t)*8 - 2);
+
+        bool threw = false;
+        try
+        {
+            qak::thread_group::RP ptg(new qak::thread_group(thfn, 2, opts));
+        }
+        catch (std::runtime_error const &)
+        {
+            threw = true;
+        }
+        QAK_verify( threw );
+    }
+
+#if 0
+    QAKtest(set_target_cpu_coverage)
+    {
+        //	void set_target_cpu_coverage(float coverage)
         //?
     }
 
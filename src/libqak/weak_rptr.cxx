@@ -0,0 +1,144 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	weak_rptr.cxx
+
+#include "qak/weak_rptr.hxx"
+
+#include "qak/atomic.hxx"
+#include "qak/mutex.hxx"
+#include "qak/padded.hxx"
+
+#include <cstdint> // std::uintptr_t
+#include <unordered_map>
+
+namespace qak_rptr_imp_ { // ==========================================================================================|
+
+	//	Control block shared by the weak_rptrs to one object.
+	//	The object itself holds one weak reference, which it gives up when it expires.
+	struct weak_ctl
+	{
+		qak::mutex mut;
+
+		//	Protected by mut.
+		bool alive = true;
+
+		qak::atomic<std::intptr_t> cnt_weak;
+	};
+
+	namespace {
+
+		//	Maps the address of an object's reference counter to its control block.
+		//	Only objects that have had a weak_rptr made to them appear here.
+		struct weak_ctl_table
+		{
+			qak::mutex mut;
+			std::unordered_map<void const *, weak_ctl *> map;
+		};
+
+		//	The table is split by address, so weak references to unrelated objects rarely share a lock.
+		std::size_t const cnt_weak_ctl_shards = 64;
+
+		weak_ctl_table & the_weak_ctl_table(void const * p_refcnt)
+		{
+			static qak::padded<weak_ctl_table> tbls[cnt_weak_ctl_shards];
+
+			std::uintptr_t u = reinterpret_cast<std::uintptr_t>(p_refcnt);
+			u ^= u >> 6 ^ u >> 12;
+			return *tbls[(u >> 3) % cnt_weak_ctl_shards];
+		}
+
+	} // namespace
+
+	//-----------------------------------------------------------------------------------------------------------------|
+
+	weak_ctl * weak_ctl_acquire(void const * p_refcnt)
+	{
+		weak_ctl_table & tbl = the_weak_ctl_table(p_refcnt);
+		qak::mutex_lock lock(tbl.mut);
+
+		auto it = tbl.map.find(p_refcnt);
+		if (it != tbl.map.end())
+		{
+			++it->second->cnt_weak;
+			return it->second;
+		}
+
+		//	Nothing is left behind if either allocation throws.
+		weak_ctl * p_ctl = new weak_ctl;
+		p_ctl->cnt_weak = 2; // one held by the object, one for the caller
+		try
+		{
+			tbl.map.emplace(p_refcnt, p_ctl);
+		}
+		catch (...)
+		{
+			delete p_ctl;
+			throw;
+		}
+		return p_ctl;
+	}
+
+	void weak_ctl_expire(void const * p_refcnt) QAK_noexcept
+	{
+		weak_ctl * p_ctl = 0;
+		{
+			weak_ctl_table & tbl = the_weak_ctl_table(p_refcnt);
+			qak::mutex_lock lock(tbl.mut);
+
+			auto it = tbl.map.find(p_refcnt);
+			assert(it != tbl.map.end());
+			p_ctl = it->second;
+			tbl.map.erase(it);
+		}
+
+		{
+			qak::mutex_lock lock(p_ctl->mut);
+			p_ctl->alive = false;
+		}
+
+		weak_ctl_release(p_ctl);
+	}
+
+	void weak_ctl_add_ref(weak_ctl * p_ctl) QAK_noexcept
+	{
+		++p_ctl->cnt_weak;
+	}
+
+	void weak_ctl_release(weak_ctl * p_ctl) QAK_noexcept
+	{
+		if (!--p_ctl->cnt_weak)
+			delete p_ctl;
+	}
+
+	bool weak_ctl_try_lock(weak_ctl * p_ctl, bool (* try_inc_fn)(void const *), void const * p) QAK_noexcept
+	{
+		//	The object is not deleted until its final dec() has cleared 'alive' under this mutex, so while
+		//	'alive' is set here, p is safe to use.
+		qak::mutex_lock lock(p_ctl->mut);
+		return p_ctl->alive && try_inc_fn(p);
+	}
+
+	bool weak_ctl_expired(weak_ctl * p_ctl) QAK_noexcept
+	{
+		qak::mutex_lock lock(p_ctl->mut);
+		return !p_ctl->alive;
+	}
+
+} // namespace qak_rptr_imp_
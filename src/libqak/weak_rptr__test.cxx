@@ -0,0 +1,160 @@
+// vim: set ts=4 sw=4 tw=120:
+//=====================================================================================================================|
+//
+//	Copyright (c) 2013, Marsh Ray
+//
+//	Permission to use, copy, modify, and/or distribute this software for any
+//	purpose with or without fee is hereby granted, provided that the above
+//	copyright notice and this permission notice appear in all copies.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//	WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//	MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//	ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//	WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//	ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT
+//	OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+//=====================================================================================================================|
+//
+//	weak_rptr__test.cxx
+
+#include "qak/weak_rptr.hxx"
+
+#include "qak/thread.hxx"
+#include "qak/vector.hxx"
+
+#include "qak/test_app_pre.hxx"
+#include "qak/test_macros.hxx"
+
+namespace zzz { //=====================================================================================================|
+
+    struct test_base : qak::rpointee_base<test_base>
+    {
+        bool & rb_;
+
+        test_base(bool & rb_in) : rb_(rb_in) { rb_ = true; }
+
+        ~test_base() { rb_ = false; }
+    };
+
+    struct test_derived : test_base
+    {
+        test_derived(bool & rb_in) : test_base(rb_in) { }
+    };
+
+    struct test_final final : qak::rpointee_final<test_final>
+    {
+        int i = 0;
+    };
+
+    struct test_st final : qak::rpointee_final<test_st, qak::refcnt_single_thread>
+    {
+        int i = 0;
+    };
+
+    QAKtest(basic, "weak_rptr basic operations.")
+    {
+        qak::weak_rptr<test_base> wp_empty;
+        QAK_verify( wp_empty.expired() );
+        QAK_verify( !wp_empty.lock() );
+
+        bool constructed = false;
+        qak::weak_rptr<test_base> wp_b;
+        {
+            qak::rptr<test_derived> rp(new test_derived(constructed));
+            QAK_verify( constructed );
+
+            qak::weak_rptr<test_derived> wp_d(rp);
+            QAK_verify( rp.unique() );
+            QAK_verify( !wp_d.expired() );
+
+            wp_b = wp_d;
+            {
+                test_base::RP rp_b = wp_b.lock();
+                QAK_verify( rp_b );
+                QAK_verify( rp_b.get() == rp.get() );
+                QAK_verify( rp.use_count() == 2 );
+            }
+            QAK_verify( rp.unique() );
+
+            qak::weak_rptr<test_base> wp_moved(std::move(wp_d));
+            QAK_verify( wp_d.expired() );
+            QAK_verify( wp_moved.lock().get() == rp.get() );
+
+            wp_moved.reset();
+            QAK_verify( wp_moved.expired() );
+            QAK_verify( !wp_b.expired() );
+        }
+        QAK_verify( !constructed );
+        QAK_verify( wp_b.expired() );
+        QAK_verify( !wp_b.lock() );
+    }
+
+    QAKtest(no_weak_cost, "Objects without weak refs keep a single-word count.")
+    {
+        QAK_verify( sizeof(qak::rpointee_final<test_final>) == sizeof(std::intptr_t) );
+
+        test_final::RP rp(new test_final);
+        {
+            qak::weak_rptr<test_final> wp(rp);
+            QAK_verify( rp.use_count() == 1 );
+            QAK_verify( wp.lock()->i == 0 );
+        }
+
+        //	The weak flag does not show up in the count.
+        QAK_verify( rp.use_count() == 1 );
+        test_final::RP rp2 = rp;
+        QAK_verify( rp.use_count() == 2 );
+
+        test_st::RP rp_st(new test_st);
+        qak::weak_rptr<test_st> wp_st(rp_st);
+        QAK_verify( wp_st.lock().get() == rp_st.get() );
+        rp_st.reset();
+        QAK_verify( wp_st.expired() );
+    }
+
+    QAKtest(reused_address, "A new object at the address of an expired one.")
+    {
+        //	Allocate in a loop so the allocator is likely to hand back the same address.
+        for (int n = 0; n < 100; ++n)
+        {
+            test_final::RP rp(new test_final);
+            qak::weak_rptr<test_final> wp_a(rp);
+            rp.reset();
+            QAK_verify( wp_a.expired() );
+
+            rp.reset(new test_final);
+            qak::weak_rptr<test_final> wp_b(rp);
+            QAK_verify( wp_a.expired() );
+            QAK_verify( !wp_a.lock() );
+            QAK_verify( wp_b.lock() == rp );
+        }
+    }
+
+    QAKtest(lock_vs_release, "lock() racing with the final release.")
+    {
+        for (int n = 0; n < 200; ++n)
+        {
+            test_final::RP rp(new test_final);
+            qak::weak_rptr<test_final> wp(rp);
+
+            qak::thread::RP th = qak::start_thread([&wp]()
+            {
+                for (;;)
+                {
+                    test_final::RP rp_locked = wp.lock();
+                    if (!rp_locked)
+                        break;
+                    ++rp_locked->i;
+                }
+            });
+
+            rp.reset();
+            QAK_verify( th->join() );
+            QAK_verify( wp.expired() );
+        }
+    }
+
+} // namespace zzz ====================================================================================================|
+#include "qak/test_app_post.hxx"
@@ -185,6 +185,7 @@ extern "C" {
 
 	//	Threads
 	win32::HANDLE STDCALL GetCurrentThread();
+	win32::DWORD STDCALL GetCurrentProcessorNumber();
 	win32::DWORD STDCALL GetCurrentThreadId();
 	win32::BOOL STDCALL GetExitCodeThread(win32::HANDLE hth, win32::DWORD * pExitCode);
 	win32::BOOL STDCALL GetThreadTimes(
@@ -3,21 +3,38 @@ TEMPLATE = subdirs
 SUBDIRS += \
     qak \
     atomic__test \
+    atomic_rptr__test \
+    barrier__test \
     bitsizeof__test \
+    condition__test \
+    executor__test \
     fail__test \
     hash__test \
     host_info__test \
+    latch__test \
     min_max__test \
     mutex__test \
+    mutex_profiling__test \
     now__test \
     optional__test \
+    parallel__test \
     permutation__test \
+    pool__test \
     prng64__test \
+    queue_mutex__test \
     rotate_sequence__test \
     rptr__test \
+    semaphore__test \
+    seqlock__test \
+    sharded_counter__test \
+    shared_mutex__test \
+    shuffle__test \
+    spin_mutex__test \
     stopwatch__test \
+    tagged_ptr__test \
     test_app__test \
     thread_group__test \
     thread__test \
     ucs__test \
-    vector__test
+    vector__test \
+    weak_rptr__test
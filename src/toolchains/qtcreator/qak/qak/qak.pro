@@ -31,17 +31,31 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
     ../../../../libqak/atomic.cxx \
+    ../../../../libqak/barrier.cxx \
+    ../../../../libqak/condition.cxx \
+    ../../../../libqak/epoch.cxx \
+    ../../../../libqak/executor.cxx \
     ../../../../libqak/host_info.cxx \
+    ../../../../libqak/latch.cxx \
     ../../../../libqak/mutex.cxx \
+    ../../../../libqak/mutex_profiling.cxx \
     ../../../../libqak/now.cxx \
     ../../../../libqak/permutation.cxx \
+    ../../../../libqak/pool.cxx \
+    ../../../../libqak/queue_mutex.cxx \
     ../../../../libqak/rotate_sequence.cxx \
     ../../../../libqak/rptr.cxx \
+    ../../../../libqak/semaphore.cxx \
+    ../../../../libqak/sharded_counter.cxx \
+    ../../../../libqak/shared_mutex.cxx \
+    ../../../../libqak/spin_mutex.cxx \
     ../../../../libqak/static_data.cxx \
     ../../../../libqak/stopwatch.cxx \
+    ../../../../libqak/tagged_ptr.cxx \
     ../../../../libqak/thread.cxx \
     ../../../../libqak/thread_group.cxx \
-    ../../../../libqak/ucs.cxx
+    ../../../../libqak/ucs.cxx \
+    ../../../../libqak/weak_rptr.cxx
 # Also:
 #    ../../../../libqak/threadls.cxx port me
 
@@ -51,25 +65,44 @@ HEADERS += \
     ../../../../include/qak/abs.hxx \
     ../../../../include/qak/alignof.hxx \
     ../../../../include/qak/atomic.hxx \
+    ../../../../include/qak/atomic_rptr.hxx \
+    ../../../../include/qak/barrier.hxx \
+    ../../../../include/qak/bench_macros.hxx \
     ../../../../include/qak/bitsizeof.hxx \
+    ../../../../include/qak/condition.hxx \
     ../../../../include/qak/config.hxx \
+    ../../../../include/qak/epoch.hxx \
+    ../../../../include/qak/executor.hxx \
     ../../../../include/qak/fail.hxx \
     ../../../../include/qak/hash.hxx \
     ../../../../include/qak/host_info.hxx \
     ../../../../include/qak/io.hxx \
     ../../../../include/qak/is_memcpyable.hxx \
+    ../../../../include/qak/latch.hxx \
     ../../../../include/qak/macros.hxx \
     ../../../../include/qak/min_max.hxx \
     ../../../../include/qak/mutex.hxx \
+    ../../../../include/qak/mutex_profiling.hxx \
     ../../../../include/qak/now.hxx \
     ../../../../include/qak/optional.hxx \
+    ../../../../include/qak/padded.hxx \
+    ../../../../include/qak/parallel.hxx \
     ../../../../include/qak/permutation.hxx \
+    ../../../../include/qak/pool.hxx \
     ../../../../include/qak/prng64.hxx \
+    ../../../../include/qak/queue_mutex.hxx \
     ../../../../include/qak/rotate_sequence_vector.hxx \
     ../../../../include/qak/rotate_sequence.hxx \
     ../../../../include/qak/rptr.hxx \
+    ../../../../include/qak/semaphore.hxx \
+    ../../../../include/qak/seqlock.hxx \
+    ../../../../include/qak/sharded_counter.hxx \
+    ../../../../include/qak/shared_mutex.hxx \
+    ../../../../include/qak/shuffle.hxx \
+    ../../../../include/qak/spin_mutex.hxx \
     ../../../../include/qak/static_data.hxx \
     ../../../../include/qak/stopwatch.hxx \
+    ../../../../include/qak/tagged_ptr.hxx \
     ../../../../include/qak/test_app_post.hxx \
     ../../../../include/qak/test_app_pre.hxx \
     ../../../../include/qak/test_macros.hxx \
@@ -78,8 +111,10 @@ HEADERS += \
     ../../../../include/qak/threadls.hxx \
     ../../../../include/qak/ucs.hxx \
     ../../../../include/qak/vector.hxx \
+    ../../../../include/qak/weak_rptr.hxx \
     ../../../../include/qak/zz_imp_pthread.hxx \
     ../../../../include/qak/imp/pthread.hxx \
+    ../../../../include/qak/imp/spin_wait.hxx \
     ../../../../include/qak/io/io.hxx \
     ../../../../include/qak/workarounds/alignof_operator.hxx
 